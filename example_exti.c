@@ -171,7 +171,7 @@ int main(void)
     lite_button_register_combos(KEY_COMBO_SCREENSHOT, &combo2_cfg, combo_callback, NULL);
 
     /* 与轮询相比，需要多注册定时器回调这一步骤 */
-    btn_timer_cb_t cb;
+    btn_timer_cb_t cb = {0};
     cb.creat = app_button_creat;
     cb.start = app_button_start;
     cb.stop = app_button_stop;
@@ -5,9 +5,31 @@
  * Provides simple button handling for embedded systems:
  *   - Single press / release events
  *   - Debounce filtering
+ *   - Per key adaptive debounce learned from the observed bounce(option)
+ *   - Zero latency press with a lockout window, selectable per key(option)
+ *   - Per key sample periods on a hashed timer wheel(option)
+ *   - EXTI keys parked on a hierarchical wheel of timeouts(option)
  *   - Multi-click detection(option)
  *   - Long press and repeat press(option)
  *   - Combo key support (simultaneous & sequential)(option)
+ *   - Batched port sampling with vertical counter debounce(option)
+ *   - Keyboard matrix scanning with anti-ghosting(option)
+ *   - Resistor ladder keys on one ADC channel(option)
+ *   - Lock-free event queue for deferred callback dispatch(option)
+ *   - Batched event delivery, one callback per poll(option)
+ *   - Per key event subscription masks(option)
+ *   - Tickless EXTI timer armed to the next deadline(option)
+ *   - Lock-free EXTI to poll handoff on C11 atomics(option)
+ *   - Timestamp timing engine on a microsecond clock(option)
+ *   - Key sequence recognition automaton(option)
+ *   - Independent button contexts with caller provided storage
+ *   - Key and combo slots handed out at run time from the context(option)
+ *   - Run-length encoded input trace recording and replay(option)
+ *   - Snapshot and restore of the key state across deep sleep(option)
+ *   - Per key bounce, latency and callback time instrumentation(option)
+ *   - Compact per key state with narrow counters and packed flags(option)
+ *   - Poll mode state machine limited to the active keys
+ *   - Input keys fed with pushed levels instead of a GPIO read
  *
  * @author  HughWu
  * @date    2025-08-16
@@ -28,13 +50,173 @@
 extern "C" {
 #endif
 
+#if BTN_POOL_FUN_ENABLE
+#define BTN_NUM              BTN_POOL_KEY_NUM
+#define BTN_COMBO_NUM        BTN_POOL_COMBO_NUM
+#else
 #define BTN_NUM              KEY_MAX
 #define BTN_COMBO_NUM        KEY_COMBO_MAX
+#endif
+#define BTN_SEQ_NUM          KEY_SEQ_MAX
 #define BTN_DEBOUNCE_THR     (BTN_DEBOUNCE_MS / BTN_POLL_PERIOD_MS)
-#define BTN_MULTI_GAP_THR    (BTN_MULTI_GAP_MS / BTN_POLL_PERIOD_MS)
-#define BTN_COMBO_GAP_THR    (BTN_COMBO_GAP_MS / BTN_POLL_PERIOD_MS)
 
-#define BTN_COMBO_KEY_NUM    (3)
+/* Time base: poll ticks, or microseconds in timestamp mode */
+#if BTN_TIMESTAMP_FUN_ENABLE
+    #define BTN_TICK_MAX         UINT32_MAX
+    #define BTN_MS_TO_TICK(ms)   ((btn_tick_t)(ms) * 1000U)
+    #define BTN_TICK_TO_MS(t)    (((t) + 999U) / 1000U)
+#else
+    #define BTN_TICK_MAX         SIZE_MAX
+    #define BTN_MS_TO_TICK(ms)   ((ms) / BTN_POLL_PERIOD_MS)
+    #define BTN_TICK_TO_MS(t)    ((t) * BTN_POLL_PERIOD_MS)
+#endif
+#define BTN_POLL_TICKS       BTN_MS_TO_TICK(BTN_POLL_PERIOD_MS)
+#define BTN_DEBOUNCE_TIME    BTN_MS_TO_TICK(BTN_DEBOUNCE_MS)
+#define BTN_DEBOUNCE_MIN_THR BTN_MS_TO_TICK(BTN_DEBOUNCE_MIN_MS)
+#define BTN_DEBOUNCE_MAX_THR BTN_MS_TO_TICK(BTN_DEBOUNCE_MAX_MS)
+#define BTN_LOCKOUT_THR      BTN_MS_TO_TICK(BTN_LOCKOUT_MS)
+#define BTN_MULTI_GAP_THR    BTN_MS_TO_TICK(BTN_MULTI_GAP_MS)
+#define BTN_COMBO_GAP_THR    BTN_MS_TO_TICK(BTN_COMBO_GAP_MS)
+#define BTN_SEQ_STEP_THR     BTN_MS_TO_TICK(BTN_SEQ_STEP_MS)
+
+#define BTN_COMBO_KEY_NUM    BTN_COMBO_KEY_MAX
+
+#define BTN_BATCH_FUN_ENABLE (BTN_PORT_FUN_ENABLE || BTN_MATRIX_FUN_ENABLE || BTN_ADC_FUN_ENABLE)
+
+#if BTN_DEB_ADAPT_FUN_ENABLE && ((BTN_DEBOUNCE_LEARN_CNT < 1) || (BTN_DEBOUNCE_LEARN_CNT > 15))
+    #error "BTN_DEBOUNCE_LEARN_CNT must be 1 ~ 15"
+#endif
+#if BTN_DEB_ADAPT_FUN_ENABLE && (BTN_DEBOUNCE_MIN_MS > BTN_DEBOUNCE_MAX_MS)
+    #error "BTN_DEBOUNCE_MIN_MS must not exceed BTN_DEBOUNCE_MAX_MS"
+#endif
+
+#if BTN_COMBO_FUN_ENABLE && ((BTN_COMBO_KEY_MAX < 2) || (BTN_COMBO_KEY_MAX > 255))
+    #error "BTN_COMBO_KEY_MAX must be 2 ~ 255"
+#endif
+
+#if BTN_ADC_FUN_ENABLE && (BTN_ADC_BAND_MAX > 255)
+    #error "BTN_ADC_BAND_MAX must not exceed 255"
+#endif
+#if BTN_MATRIX_FUN_ENABLE && (BTN_MATRIX_COLS > 32)
+    #error "BTN_MATRIX_COLS must not exceed 32"
+#endif
+
+#if BTN_EVT_QUEUE_FUN_ENABLE && ((BTN_EVT_QUEUE_SIZE & (BTN_EVT_QUEUE_SIZE - 1)) != 0)
+    #error "BTN_EVT_QUEUE_SIZE must be a power of 2"
+#endif
+#if BTN_WHEEL_FUN_ENABLE && ((BTN_WHEEL_SLOTS & (BTN_WHEEL_SLOTS - 1)) != 0)
+    #error "BTN_WHEEL_SLOTS must be a power of 2"
+#endif
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE && ((BTN_TMO_LEVELS < 1) || (BTN_TMO_LEVELS > 6))
+    #error "BTN_TMO_LEVELS must be 1 ~ 6"
+#endif
+#if BTN_TRACE_FUN_ENABLE && ((BTN_TRACE_BUF_SIZE & (BTN_TRACE_BUF_SIZE - 1)) != 0)
+    #error "BTN_TRACE_BUF_SIZE must be a power of 2"
+#endif
+
+/* Trace records: tag byte, type in bits 0-1, repeat count in bits 2-7 */
+#define BTN_TRACE_VERSION      (1)
+#define BTN_TRACE_POLL         (0x01)
+#define BTN_TRACE_REPEAT       (0x02)
+#define BTN_TRACE_EXTI         (0x03)
+#define BTN_TRACE_TYPE_MASK    (0x03)
+#define BTN_TRACE_REPEAT_MAX   (0x3F)
+#define BTN_TRACE_VARINT_MAX   ((sizeof(size_t) * 8 + 6) / 7)
+#define BTN_TRACE_REC_MAX      (1 + BTN_TRACE_VARINT_MAX * (1 + BTN_MASK_WORDS))
+/* read out blob: start state header, then the ring content */
+#define BTN_TRACE_BLOB_MAX     (BTN_TRACE_BUF_SIZE + BTN_TRACE_REC_MAX + BTN_TRACE_VARINT_MAX)
+
+/* Snapshot blob: version, setup checksum (2 bytes), the saved keys mask,
+ * per saved key a flag byte and its stamps as varints, then the sequence
+ * automaton state */
+#define BTN_SNAPSHOT_VERSION   (1)
+#define BTN_SNAP_ACTIVE        (0x01)
+#define BTN_SNAP_PRESS         (0x02)  /* press not taken by a combo yet */
+#define BTN_SNAP_LP            (0x04)
+#define BTN_SNAP_MC            (0x08)
+#define BTN_SNAP_LOCK          (0x10)
+#define BTN_SNAP_CLICK_SHIFT   (5)     /* click count in bits 5-7 */
+#define BTN_SNAPSHOT_MAX       (3 + BTN_TRACE_VARINT_MAX * (BTN_MASK_WORDS + 2) + \
+                                BTN_NUM * (1 + 5 * BTN_TRACE_VARINT_MAX))
+
+/* Stats snapshot attempts before giving up on a consistent copy */
+#define BTN_STATS_READ_TRY     (4)
+
+#if (BTN_SEQ_NODE_MAX <= 0xFF)
+    typedef uint8_t btn_seq_node_t;
+#else
+    typedef uint16_t btn_seq_node_t;
+#endif
+
+#if BTN_POOL_FUN_ENABLE && ((BTN_POOL_KEY_NUM < 1) || (BTN_POOL_KEY_NUM > 65535) || \
+                            (BTN_POOL_COMBO_NUM < 1) || (BTN_POOL_COMBO_NUM > 65535))
+    #error "BTN_POOL_KEY_NUM and BTN_POOL_COMBO_NUM must be 1 ~ 65535"
+#endif
+#if BTN_TICKLESS_FUN_ENABLE && !BTN_EXTI_FUN_ENABLE
+    #error "BTN_TICKLESS_FUN_ENABLE needs BTN_EXTI_FUN_ENABLE"
+#endif
+#if BTN_WHEEL_FUN_ENABLE && BTN_EXTI_FUN_ENABLE
+    #error "BTN_WHEEL_FUN_ENABLE needs poll mode, BTN_EXTI_FUN_ENABLE 0"
+#endif
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE && (!BTN_EXTI_FUN_ENABLE || BTN_TIMESTAMP_FUN_ENABLE)
+    #error "BTN_TIMEOUT_WHEEL_FUN_ENABLE needs BTN_EXTI_FUN_ENABLE without BTN_TIMESTAMP_FUN_ENABLE"
+#endif
+#if BTN_ATOMIC_FUN_ENABLE
+    #if !BTN_EXTI_FUN_ENABLE
+        #error "BTN_ATOMIC_FUN_ENABLE needs BTN_EXTI_FUN_ENABLE"
+    #endif
+    /* both write per key edge stamps from the EXTI handler */
+    #if BTN_TIMESTAMP_FUN_ENABLE || BTN_TRACE_FUN_ENABLE
+        #error "BTN_ATOMIC_FUN_ENABLE excludes BTN_TIMESTAMP_FUN_ENABLE and BTN_TRACE_FUN_ENABLE"
+    #endif
+    #if !defined(__STDC_VERSION__) || (__STDC_VERSION__ < 201112L) || defined(__STDC_NO_ATOMICS__)
+        #error "BTN_ATOMIC_FUN_ENABLE needs C11 atomics"
+    #endif
+    #include <stdatomic.h>
+#endif
+
+/* Key bitset: one bit per key, sized from BTN_NUM */
+#define BTN_MASK_WORD_BITS   (32)
+#define BTN_MASK_WORDS       ((BTN_NUM + BTN_MASK_WORD_BITS - 1) / BTN_MASK_WORD_BITS)
+#define BTN_MASK_WORD(n)     ((size_t)(n) / BTN_MASK_WORD_BITS)
+#define BTN_MASK_BIT(n)      BIT((size_t)(n) % BTN_MASK_WORD_BITS)
+
+#if BTN_POOL_FUN_ENABLE
+/* Handles of a full pool, out of range for every function taking an id */
+#define BTN_KEY_INVALID      ((key_id_e)BTN_NUM)
+#define BTN_COMBO_INVALID    ((key_combo_id_e)BTN_COMBO_NUM)
+#define BTN_COMBO_POOL_WORDS ((BTN_COMBO_NUM + BTN_MASK_WORD_BITS - 1) / BTN_MASK_WORD_BITS)
+#endif
+
+/* Vertical counter: samples needed to switch state and bit planes to hold them */
+#define BTN_VC_TARGET        (BTN_DEBOUNCE_THR + 1)
+#if BTN_MATRIX_FUN_ENABLE
+/* A matrix image holds for a full scan, its keys count whole scans of polls */
+#define BTN_MATRIX_SCAN_POLLS \
+        ((BTN_MATRIX_ROWS + BTN_MATRIX_ROWS_PER_POLL - 1) / BTN_MATRIX_ROWS_PER_POLL)
+#define BTN_VC_MX_TARGET \
+        (((BTN_DEBOUNCE_THR + BTN_MATRIX_SCAN_POLLS - 1) / BTN_MATRIX_SCAN_POLLS + 1) * BTN_MATRIX_SCAN_POLLS)
+#define BTN_VC_SPAN          BTN_VC_MX_TARGET
+#else
+#define BTN_VC_SPAN          BTN_VC_TARGET
+#endif
+#if (BTN_VC_SPAN < 2)
+    #define BTN_VC_BITS        (1)
+#elif (BTN_VC_SPAN < 4)
+    #define BTN_VC_BITS        (2)
+#elif (BTN_VC_SPAN < 8)
+    #define BTN_VC_BITS        (3)
+#elif (BTN_VC_SPAN < 16)
+    #define BTN_VC_BITS        (4)
+#elif (BTN_VC_SPAN < 32)
+    #define BTN_VC_BITS        (5)
+#elif (BTN_VC_SPAN < 64)
+    #define BTN_VC_BITS        (6)
+#elif (BTN_VC_SPAN < 128)
+    #define BTN_VC_BITS        (7)
+#else
+    #define BTN_VC_BITS        (8)
+#endif
 
 #if (BTN_ACTIVE_LEVEL == BTN_LEVEL_LOW)
     #define BTN_IDLE_LEVEL     BTN_LEVEL_HIGH
@@ -44,15 +226,179 @@ extern "C" {
 
 #define BIT(n) (1U << (n))
 #define ABS_DIFF(a, b)   (( (a) > (b) ) ? ((a) - (b)) : ((b) - (a)))
-#define MAX3_DIFF(a, b, c)   \
-        ( ((ABS_DIFF(a, b)) > (ABS_DIFF(a, c))) ? \
-        ( ((ABS_DIFF(a, b)) > (ABS_DIFF(b, c))) ? ABS_DIFF(a, b) : ABS_DIFF(b, c) ) : \
-        ( ((ABS_DIFF(a, c)) > (ABS_DIFF(b, c))) ? ABS_DIFF(a, c) : ABS_DIFF(b, c) ) )
 #define HAS_MULTI_BITS(x)   (((x) & ((x) - 1)) != 0)
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define GET_INTERVAL(cur, prev) \
-        ((cur) >= (prev) ? ((cur) - (prev)) : (SIZE_MAX - (prev) + (cur)))
+        ((cur) >= (prev) ? ((cur) - (prev)) : (BTN_TICK_MAX - (prev) + (cur)))
+#define TICK_REACHED(now, deadline) \
+        ((btn_tick_t)((now) - (deadline)) <= (BTN_TICK_MAX >> 1))
+/* Per key stamps may be narrower than btn_tick_t and wrap at their own width */
+#define STAMP_MAX(type)      ((type)~(type)0)
+#define STAMP_SINCE(type, now, stamp) \
+        ((type)((type)(now) - (stamp)))
+#define STAMP_REACHED(type, now, deadline) \
+        (STAMP_SINCE(type, now, deadline) <= (STAMP_MAX(type) >> 1))
+#if defined(__GNUC__) || defined(__clang__)
+    #define BTN_CTZ(x)      ((size_t)__builtin_ctz(x))
+#else
+    static inline size_t BTN_CTZ(uint32_t x)
+    {
+        size_t n = 0;
+        while ((x & 1U) == 0) { x >>= 1; n++; }
+        return n;
+    }
+#endif
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+typedef uint32_t btn_tick_t;
+#else
+typedef size_t btn_tick_t;
+#endif
+
+/*
+ * Compact layout: per key counters and stamps only as wide as the longest
+ * interval compared against them, flags packed into bitfields. Stamps are
+ * compared modulo their width, so the interval must fit in half of it.
+ * Microsecond stamps of the timestamp mode keep the full width.
+ */
+#if BTN_COMPACT_FUN_ENABLE
+    #define BTN_BITS(n)          : n
+    #define BTN_LONGPRESS_MAX_THR  BTN_MS_TO_TICK(BTN_LONGPRESS_MAX_MS)
+#else
+    #define BTN_BITS(n)
+#endif
+
+#if BTN_COMPACT_FUN_ENABLE && BTN_TIMESTAMP_FUN_ENABLE
+    typedef uint8_t btn_deb_cnt_t;
+    typedef btn_tick_t btn_lp_tick_t;
+    typedef btn_tick_t btn_gap_tick_t;
+#elif BTN_COMPACT_FUN_ENABLE
+    #if BTN_DEB_ADAPT_FUN_ENABLE
+        #define BTN_DEBOUNCE_CNT_MAX  MAX(BTN_DEBOUNCE_THR, BTN_DEBOUNCE_MAX_THR)
+    #else
+        #define BTN_DEBOUNCE_CNT_MAX  BTN_DEBOUNCE_THR
+    #endif
+    #if (BTN_DEBOUNCE_CNT_MAX < 0xFF)
+        typedef uint8_t btn_deb_cnt_t;
+    #elif (BTN_DEBOUNCE_CNT_MAX < 0xFFFF)
+        typedef uint16_t btn_deb_cnt_t;
+    #else
+        typedef uint32_t btn_deb_cnt_t;
+    #endif
+    #if (BTN_LONGPRESS_MAX_THR <= 0x7F)
+        typedef uint8_t btn_lp_tick_t;
+    #elif (BTN_LONGPRESS_MAX_THR <= 0x7FFF)
+        typedef uint16_t btn_lp_tick_t;
+    #else
+        typedef uint32_t btn_lp_tick_t;
+    #endif
+    /* the window is closed one tick past the gap */
+    #if (BTN_MULTI_GAP_THR < 0x7F)
+        typedef uint8_t btn_gap_tick_t;
+    #elif (BTN_MULTI_GAP_THR < 0x7FFF)
+        typedef uint16_t btn_gap_tick_t;
+    #else
+        typedef uint32_t btn_gap_tick_t;
+    #endif
+#else
+    typedef size_t btn_deb_cnt_t;
+    typedef btn_tick_t btn_lp_tick_t;
+    typedef btn_tick_t btn_gap_tick_t;
+#endif
+
+/* learned debounce window: polls like deb_cnt, or us in timestamp mode */
+#if BTN_TIMESTAMP_FUN_ENABLE
+    typedef btn_tick_t btn_deb_thr_t;
+#else
+    typedef btn_deb_cnt_t btn_deb_thr_t;
+#endif
+
+typedef struct {
+    uint32_t w[BTN_MASK_WORDS];
+} btn_mask_t;
+
+static inline void btn_mask_set(btn_mask_t *m, size_t n)
+{
+    m->w[BTN_MASK_WORD(n)] |= BTN_MASK_BIT(n);
+}
+
+static inline void btn_mask_clr(btn_mask_t *m, size_t n)
+{
+    m->w[BTN_MASK_WORD(n)] &= ~BTN_MASK_BIT(n);
+}
+
+static inline bool btn_mask_test(const btn_mask_t *m, size_t n)
+{
+    return (m->w[BTN_MASK_WORD(n)] & BTN_MASK_BIT(n)) != 0;
+}
+
+static inline bool btn_mask_is_zero(const btn_mask_t *m)
+{
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        if (m->w[w] != 0) return false;
+    }
+    return true;
+}
+
+#if BTN_ATOMIC_FUN_ENABLE
+/* Key bitset shared with EXTI handlers, each word updated on its own */
+typedef struct {
+    _Atomic uint32_t w[BTN_MASK_WORDS];
+} btn_atomic_mask_t;
+
+static inline void btn_atomic_mask_set(btn_atomic_mask_t *m, size_t n)
+{
+    atomic_fetch_or(&m->w[BTN_MASK_WORD(n)], BTN_MASK_BIT(n));
+}
+
+static inline void btn_atomic_mask_clr(btn_atomic_mask_t *m, size_t n)
+{
+    atomic_fetch_and(&m->w[BTN_MASK_WORD(n)], ~BTN_MASK_BIT(n));
+}
+
+static inline bool btn_atomic_mask_test(btn_atomic_mask_t *m, size_t n)
+{
+    return (atomic_load(&m->w[BTN_MASK_WORD(n)]) & BTN_MASK_BIT(n)) != 0;
+}
+#endif
+
+static inline bool btn_mask_eq(const btn_mask_t *a, const btn_mask_t *b)
+{
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        if (a->w[w] != b->w[w]) return false;
+    }
+    return true;
+}
+
+/* a &= ~b */
+static inline void btn_mask_clr_mask(btn_mask_t *a, const btn_mask_t *b)
+{
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        a->w[w] &= ~b->w[w];
+    }
+}
+
+/* orders masks as wide integers, the highest word first */
+static inline int btn_mask_cmp(const btn_mask_t *a, const btn_mask_t *b)
+{
+    for (size_t w = BTN_MASK_WORDS; w-- > 0;) {
+        if (a->w[w] != b->w[w]) return (a->w[w] < b->w[w]) ? -1 : 1;
+    }
+    return 0;
+}
+
+static inline bool btn_mask_has_multi_bits(const btn_mask_t *m)
+{
+    bool found = false;
+
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        if (m->w[w] == 0) continue;
+        if (found || HAS_MULTI_BITS(m->w[w])) return true;
+        found = true;
+    }
+    return false;
+}
 
 typedef enum {
     BTN_LEVEL_LOW = 0,
@@ -67,27 +413,61 @@ typedef enum {
     BTN_EVT_DOUBLE,
     BTN_EVT_TRIPLE,
     BTN_EVT_COMBO,
+    BTN_EVT_SEQUENCE,
 } btn_evt_e;
 
+/* Event subscription bits (event mask mode) */
+#define BTN_EVT_BIT(evt)     BIT(evt)
+#define BTN_EVT_MASK_MULTI   (BTN_EVT_BIT(BTN_EVT_DOUBLE) | BTN_EVT_BIT(BTN_EVT_TRIPLE))
+#define BTN_EVT_MASK_ALL     (BTN_EVT_BIT(BTN_EVT_PRESS) | BTN_EVT_BIT(BTN_EVT_RELEASE) | \
+                              BTN_EVT_BIT(BTN_EVT_LONG) | BTN_EVT_MASK_MULTI)
+
 typedef btn_level_e (*btn_gpio_lv_f)(void);
+typedef uint32_t (*btn_port_lv_f)(void);
+typedef uint16_t (*btn_adc_read_f)(void);
+typedef void (*btn_matrix_row_f)(uint8_t row, bool drive);
+typedef uint32_t (*btn_matrix_col_f)(void);
 typedef void (*btn_cb_f)(btn_evt_e evt, void *user);
 typedef void (*btn_combo_cb_f)(key_combo_id_e, void *para);
+typedef void (*btn_seq_cb_f)(key_seq_id_e, void *para);
 
 typedef void (*btn_timer_callback_cb_f)(void);
 typedef void (*btn_timer_creat_cb_f)(btn_timer_callback_cb_f cb);
+typedef void (*btn_timer_arg_callback_cb_f)(void *arg);
+typedef void (*btn_timer_creat_arg_cb_f)(btn_timer_arg_callback_cb_f cb, void *arg);
 typedef void (*btn_timer_start_cb_f)(uint32_t ms);
 typedef void (*btn_timer_stop_cb_f)(void);
+typedef uint32_t (*btn_timer_elapsed_cb_f)(void);
+typedef uint32_t (*btn_clock_us_f)(void);
+typedef uint32_t (*btn_stats_clock_f)(void);
 
+/*
+ * Tickless mode: start() arms a one-shot timer, elapsed() (optional) returns
+ * the ms gone by since the last start() so an early re-arm keeps time.
+ * creat_arg() (optional) is used instead of creat() when set, the timer must
+ * pass arg back to cb, this is how a timer gets bound to its own context.
+ */
 typedef struct {
     btn_timer_creat_cb_f creat;
     btn_timer_start_cb_f start;
     btn_timer_stop_cb_f stop;
+#if BTN_TICKLESS_FUN_ENABLE
+    btn_timer_elapsed_cb_f elapsed;
+#endif
+    btn_timer_creat_arg_cb_f creat_arg;
 } btn_timer_cb_t;
 
 typedef struct {
     btn_timer_cb_t cb;
     bool run_flag;
-    uint32_t exti_tick;
+    btn_tick_t exti_tick;
+#if BTN_TICKLESS_FUN_ENABLE
+    btn_tick_t due;
+    btn_tick_t start;           /* tick the pending one-shot was started at */
+#endif
+#if BTN_ATOMIC_FUN_ENABLE
+    atomic_uint lock;           /* owner flag and the requests left for it */
+#endif
 } btn_timer_t;
 
 typedef enum {
@@ -96,6 +476,7 @@ typedef enum {
     BTN_COMBO_SEQUENTIAL,
 } btn_combo_type_e;
 
+/* names for the common key counts, any count of 2 ~ BTN_COMBO_KEY_NUM is valid */
 typedef enum {
     BTN_DOUBLE_KEY_CNT = 2,
     BTN_TRIPLE_KEY_CNT = 3,
@@ -103,7 +484,7 @@ typedef enum {
 
 typedef struct {
     key_id_e keys[BTN_COMBO_KEY_NUM];
-    btn_combo_num_e num;
+    uint8_t num;                /* number of keys, 2 ~ BTN_COMBO_KEY_NUM */
     btn_combo_type_e type;
 } btn_combo_cfg_t;
 
@@ -111,46 +492,405 @@ typedef struct {
     btn_combo_cb_f cb;
     void *para;
     btn_combo_cfg_t cfg;
-    uint32_t keys_mask;
+    btn_mask_t keys_mask;
 } btn_combo_t;
 
+typedef struct {
+    key_id_e keys[BTN_SEQ_KEY_MAX];
+    uint8_t num;
+} btn_seq_cfg_t;
+
+typedef struct {
+    btn_seq_cb_f cb;
+    void *para;
+    btn_seq_cfg_t cfg;
+} btn_seq_t;
+
+/* Aho-Corasick automaton over key presses, node 0 is the root */
+typedef struct {
+    btn_seq_node_t next[BTN_SEQ_NODE_MAX][BTN_NUM];
+    btn_seq_node_t out_link[BTN_SEQ_NODE_MAX];
+    uint16_t out_id[BTN_SEQ_NODE_MAX];
+    size_t node_num;
+    btn_seq_node_t state;
+    btn_tick_t last_tick;
+} btn_seq_fsm_t;
+
 typedef enum {
     BTN_SINGLE_CLICK = 1,
     BTN_DOUBLE_CLICK = 2,
     BTN_TRIPLE_CLICK = 3,
 } btn_click_e;
 
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+typedef enum {
+    BTN_DEB_INTEGRATE = 0,  /* press and release wait out the debounce window */
+    BTN_DEB_LOCKOUT,        /* press at once, then the key is ignored for BTN_LOCKOUT_MS */
+} btn_deb_mode_e;
+#endif
+
+/* clicks are counted up to here, any count above triple reports nothing */
+#define BTN_CLICK_MAX        (7)
+
 typedef struct {
     uint32_t longpress_ms;
     uint32_t longpress_repeat_ms;
+#if BTN_EVT_MASK_FUN_ENABLE
+    uint8_t evt_mask;       /* BTN_EVT_BIT() of the events wanted, 0 for all */
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    uint8_t deb_mode;       /* btn_deb_mode_e */
+#endif
+#if BTN_WHEEL_FUN_ENABLE
+    uint32_t poll_ms;       /* sample period, a multiple of the poll period, 0 for every poll */
+#endif
 } btn_cfg_t;
 
 typedef struct {
-    size_t lp_thr;
-    size_t lp_rpt_thr;
+    btn_lp_tick_t lp_thr;
+    btn_lp_tick_t lp_rpt_thr;
+#if BTN_EVT_MASK_FUN_ENABLE
+    uint8_t evt_mask;
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    uint8_t deb_mode;
+#endif
+#if BTN_WHEEL_FUN_ENABLE
+    uint16_t poll_div;      /* polls per sample */
+#endif
 } btn_inner_cfg_t;
 
+/* Per key configuration, read when an event is reported */
 typedef struct {
-    btn_gpio_lv_f gpio_cb;
     btn_cb_f cb;
     void *cb_para;
     btn_inner_cfg_t cfg;
+#if BTN_PORT_FUN_ENABLE || BTN_ADC_FUN_ENABLE
+    uint8_t port;           /* port or ADC ladder index */
+    uint8_t pin;            /* pin or ladder position */
+#endif
+} btn_dev_cfg_t;
 
-    size_t deb_cnt;
-    size_t lp_cnt;
-    size_t prs_tick;
-    size_t rel_tick;
-    size_t click_cnt;
-    btn_level_e state;
+/* Per key state, visited by every poll */
+typedef struct {
+#if BTN_COMBO_FUN_ENABLE
+    btn_tick_t prs_tick;
+#endif
+#if BTN_TIMESTAMP_FUN_ENABLE
+    btn_tick_t deb_tick;
+    volatile btn_tick_t edge_first;
+    volatile btn_tick_t edge_last;
+    volatile bool edge_on;          /* written from EXTI, kept out of the bitfields */
+#endif
+    btn_lp_tick_t lp_tick;
+#if BTN_MULTICLICK_FUN_ENABLE
+    btn_gap_tick_t rel_tick;
+#endif
+    btn_deb_cnt_t deb_cnt;
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    btn_tick_t bnc_tick;            /* first differing sample or edge of the burst measured */
+    btn_deb_thr_t deb_thr;          /* learned window, replaces ctx->deb_thr */
+    uint8_t deb_clean BTN_BITS(4);  /* clean switches toward the next shrink */
+    uint8_t bnc_on BTN_BITS(1);     /* bnc_tick set */
+#endif
+#if BTN_WHEEL_FUN_ENABLE
+    uint32_t whl_due;               /* wheel position of the next sample */
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    btn_tick_t lock_tick;           /* lockout press, the window runs from it */
+    uint8_t lock_on BTN_BITS(1);    /* level ignored until lock_tick + lock_thr */
+#endif
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    btn_tick_t tmo_tick;            /* timeout the key is parked until */
+    uint8_t tmo_slot;               /* level * BTN_TMO_SLOTS + slot + 1, 0 for none */
+#endif
+    uint8_t state BTN_BITS(1);      /* btn_level_e */
+    uint8_t used BTN_BITS(1);       /* a callback is registered */
+    uint8_t lp_on BTN_BITS(1);
+    uint8_t mc_on BTN_BITS(1);      /* multi-click window still open */
+    uint8_t click_cnt BTN_BITS(3);  /* up to BTN_CLICK_MAX */
 } btn_dev_t;
 
+typedef struct {
+    btn_port_lv_f port_cb;
+    btn_mask_t keys_mask;
+    uint32_t pins_mask;
+    int16_t shift;
+    bool linear;
+} btn_port_t;
+
+/*
+ * One band of a resistor ladder: readings above the previous band up to
+ * max. pins holds the ladder positions pressed in the band (bit n for
+ * position n, several for a ladder that encodes key pairs), 0 for none.
+ */
+typedef struct {
+    uint16_t max;
+    uint32_t pins;
+} btn_adc_band_t;
+
+typedef struct {
+    btn_adc_read_f read_cb;
+    const btn_adc_band_t *band;
+    uint8_t band_num;
+    uint8_t cur;                            /* band of the last reading */
+    btn_mask_t keys_mask;
+    btn_mask_t band_keys[BTN_ADC_BAND_MAX]; /* keys pressed per band */
+} btn_adc_t;
+
+typedef struct {
+    btn_mask_t keys_mask;
+    btn_mask_t state;
+    btn_mask_t cnt[BTN_VC_BITS];
+} btn_vc_t;
+
+/* Hashed timer wheel: a key waits in the slot of its next sample position */
+typedef struct {
+    btn_mask_t slot[BTN_WHEEL_SLOTS];
+    uint32_t pos;               /* polls so far */
+} btn_wheel_t;
+
+/*
+ * Hierarchical timing wheel of key timeouts: level 0 holds one tick per
+ * slot, each level above BTN_TMO_SLOTS times more. A timeout waits on the
+ * lowest level whose current rotation it falls in and moves down as the
+ * wheel turns into its slot.
+ */
+#define BTN_TMO_BITS         (5)
+#define BTN_TMO_SLOTS        (1U << BTN_TMO_BITS)
+
+typedef struct {
+    btn_mask_t slot[BTN_TMO_LEVELS][BTN_TMO_SLOTS];
+    uint32_t busy[BTN_TMO_LEVELS];  /* slots holding keys, bit per slot */
+    btn_tick_t now;                 /* tick the wheel has turned to */
+} btn_tmo_wheel_t;
+
+/* id is a key, combo (BTN_EVT_COMBO) or sequence (BTN_EVT_SEQUENCE) id */
+typedef struct {
+    uint32_t tick;
+    uint16_t id;
+    uint8_t evt;
+} btn_evt_rec_t;
+
+typedef void (*btn_evt_batch_cb_f)(const btn_evt_rec_t *evt, size_t num, void *para);
+
+typedef struct {
+    btn_evt_rec_t buf[BTN_EVT_QUEUE_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t overflow;
+} btn_evt_queue_t;
+
+/* Trace decoder state, the tick and the sample a repeat record stands for */
+typedef struct {
+    btn_tick_t tick;
+    btn_tick_t delta;
+    btn_mask_t lv;
+} btn_trace_pos_t;
+
+typedef struct {
+    uint8_t type;
+    size_t arg;             /* repeat count or key id */
+    size_t val;             /* tick delta or zigzag EXTI tick offset */
+    btn_mask_t lv;
+} btn_trace_rec_t;
+
+typedef struct {
+    uint8_t buf[BTN_TRACE_BUF_SIZE];
+    size_t head;            /* free running write offset */
+    size_t tail;            /* oldest record kept */
+    size_t last;            /* newest record */
+    btn_trace_pos_t base;   /* decoder state at tail */
+    btn_trace_pos_t cur;    /* decoder state at head */
+    btn_mask_t lv;          /* keys sampled active in the running poll */
+    uint32_t dropped;
+    bool on;
+    bool replay;
+} btn_trace_t;
+
+/* Per key counters, times are in stats clock counts */
+typedef struct {
+    uint32_t bounce;                        /* debounce restarts */
+    uint32_t lat_hist[BTN_STATS_LAT_BINS];  /* first differing sample or edge to press/release */
+    uint32_t cb_cnt;
+    uint32_t cb_max;
+    uint64_t cb_sum;
+} btn_key_stats_t;
+
+typedef struct {
+    uint32_t poll_cnt;
+    uint32_t poll_min;
+    uint32_t poll_max;
+    uint64_t poll_sum;          /* mean is poll_sum / poll_cnt */
+    uint32_t tmr_start;         /* EXTI timer starts and stops */
+    uint32_t tmr_stop;
+    uint32_t combo_lookup;      /* combo index searches */
+    uint32_t combo_scan;        /* index entries tried by them */
+    btn_key_stats_t key[BTN_NUM];
+} btn_stats_t;
+
+typedef struct {
+    btn_matrix_row_f row_drive;
+    btn_matrix_col_f col_read;
+} btn_matrix_cb_t;
+
+typedef struct {
+    btn_matrix_cb_t cb;
+    uint32_t scan[BTN_MATRIX_ROWS];
+    uint32_t rows[BTN_MATRIX_ROWS];
+    uint16_t map[BTN_MATRIX_ROWS][BTN_MATRIX_COLS];
+    btn_mask_t keys_mask;
+    btn_mask_t raw;
+    uint8_t next_row;
+    bool ghost;
+} btn_matrix_t;
+
+/*
+ * One independent button set: its keys, combos, timer and poll period.
+ * Storage is provided by the caller, contexts share nothing with each other.
+ */
+typedef struct {
+    uint32_t poll_period_ms;
+    btn_tick_t poll_ticks;
+    btn_tick_t deb_thr;         /* polls, or us in timestamp mode */
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    btn_tick_t deb_min;         /* bounds of the learned per key windows */
+    btn_tick_t deb_max;
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    btn_tick_t lock_thr;
+#endif
+    btn_tick_t multi_gap_thr;
+    btn_tick_t combo_gap_thr;
+    btn_tick_t seq_step_thr;
+    uint8_t vc_target;
+#if BTN_MATRIX_FUN_ENABLE
+    uint8_t vc_mx_target;       /* polls of whole matrix scans */
+#endif
+
+    btn_tick_t tmr_tick;
+    btn_mask_t press_mask;
+    btn_dev_t list[BTN_NUM];
+    btn_gpio_lv_f gpio[BTN_NUM];
+    btn_dev_cfg_t dev_cfg[BTN_NUM];
+    btn_mask_t input_mask;      /* keys whose level is pushed */
+#if BTN_ATOMIC_FUN_ENABLE
+    btn_atomic_mask_t input_lv; /* and the ones pushed active */
+#else
+    btn_mask_t input_lv;        /* and the ones pushed active */
+#endif
+#if BTN_POOL_FUN_ENABLE
+    btn_mask_t pool_mask;       /* key slots handed out, until given back */
+    uint16_t key_live[BTN_NUM]; /* keys set up, in id order */
+    uint16_t key_live_num;
+    uint16_t key_words;         /* mask words up to the last key set up, the walks stop there */
+#endif
+#if BTN_BATCH_FUN_ENABLE
+    btn_vc_t vc;
+#endif
+#if BTN_PORT_FUN_ENABLE
+    btn_port_t port_list[BTN_PORT_NUM];
+#endif
+#if BTN_MATRIX_FUN_ENABLE
+    btn_matrix_t matrix;
+#endif
+#if BTN_ADC_FUN_ENABLE
+    btn_adc_t adc_list[BTN_ADC_NUM];
+#endif
+#if BTN_COMBO_FUN_ENABLE
+    size_t combo_num;
+    btn_combo_t combo_list[BTN_COMBO_NUM];
+    /* registered combo ids sorted by key mask, then by id */
+    uint16_t combo_index[BTN_COMBO_NUM];
+    bool press_dirty;
+#if BTN_POOL_FUN_ENABLE
+    uint32_t combo_pool[BTN_COMBO_POOL_WORDS];  /* combo slots handed out */
+#endif
+#endif
+#if BTN_SEQ_FUN_ENABLE
+    btn_seq_t seq_list[BTN_SEQ_NUM];
+    btn_seq_fsm_t seq_fsm;
+#endif
+#if BTN_EXTI_FUN_ENABLE
+    btn_mask_t exti_mask;
+#if BTN_ATOMIC_FUN_ENABLE
+    btn_atomic_mask_t exti_pend;    /* keys triggered since a poll last took them */
+#endif
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    btn_mask_t exti_new;        /* keys triggered since the last poll */
+    btn_mask_t tmo_park;        /* keys skipped until an edge or their timeout */
+    btn_tmo_wheel_t tmo;
+#endif
+    btn_timer_t timer;
+#else
+    btn_mask_t gpio_mask;       /* keys read through a GPIO callback or pushed */
+    btn_mask_t active_mask;     /* keys debouncing, pressed or in a multi-click window */
+#if BTN_WHEEL_FUN_ENABLE
+    btn_wheel_t wheel;
+#endif
+#endif
+#if BTN_TIMESTAMP_FUN_ENABLE
+    btn_clock_us_f clock;
+#endif
+#if BTN_EVT_QUEUE_FUN_ENABLE
+    btn_evt_queue_t evt_queue;
+#endif
+#if BTN_EVT_BATCH_FUN_ENABLE
+    btn_evt_batch_cb_f evt_batch_cb;
+    void *evt_batch_para;
+    btn_evt_rec_t *evt_batch;   /* stack buffer of the running poll, NULL outside one */
+    size_t evt_batch_num;
+#endif
+#if BTN_TRACE_FUN_ENABLE
+    btn_trace_t trace;
+#endif
+#if BTN_STATS_FUN_ENABLE
+    btn_stats_t stats;
+    btn_stats_clock_f stats_clock;
+    volatile uint32_t stats_seq;        /* odd while a poll updates stats */
+    btn_tick_t stats_burst[BTN_NUM];    /* first differing sample of a pending switch */
+    btn_mask_t stats_burst_on;
+#endif
+} lite_button_ctx_t;
+
 /*==============================================================================
  * API functions
+ *
+ * The plain functions work on a built-in default context, polled every
+ * BTN_POLL_PERIOD_MS. Each has a _ctx version taking a context set up with
+ * lite_button_ctx_init(), so several button sets can run side by side.
  *============================================================================*/
 
+/**
+ * @brief Initialize a button context
+ *
+ * Must be called before any other _ctx function on this context.
+ * With port, matrix or ADC keys, or the compact layout, the period must not be
+ * shorter than BTN_POLL_PERIOD_MS, which sizes the vertical counters and
+ * the narrow per key counters; longer intervals are clipped to fit them.
+ *
+ * @param ctx            Caller provided context storage
+ * @param poll_period_ms Poll period of this context, 0 for BTN_POLL_PERIOD_MS
+ */
+void lite_button_ctx_init(lite_button_ctx_t *ctx, uint32_t poll_period_ms);
+
 /**
  * @brief Initialize a button
  *
+ * In event mask mode cfg->evt_mask selects the events reported for the
+ * key. Without LONG the long press is not timed, without DOUBLE and
+ * TRIPLE clicks are not counted and every release is reported at once.
+ *
+ * In wheel mode a GPIO or input key is sampled every cfg->poll_ms, rounded
+ * down to a multiple of the poll period. Its debounce takes at least two
+ * samples, long press and the multi-click gap are resolved to its period.
+ *
+ * In lockout mode cfg->deb_mode BTN_DEB_LOCKOUT reports the press of a GPIO
+ * or input key on its first active sample, or at its first edge in
+ * timestamp mode, with long press and multi-click timed from there. The
+ * key is not looked at again for BTN_LOCKOUT_MS, its release is debounced
+ * as usual. A single glitch is taken for a press.
+ *
  * @param id   Button ID (from key_id_e)
  * @param gpio GPIO read function
  * @param cfg  User configuration
@@ -159,6 +899,351 @@ typedef struct {
  */
 void lite_button_init(key_id_e id, btn_gpio_lv_f gpio_cb,
                       const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+void lite_button_init_ctx(lite_button_ctx_t *ctx, key_id_e id, btn_gpio_lv_f gpio_cb,
+                          const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+
+/**
+ * @brief Initialize a button whose level is pushed by an event source
+ *
+ * For inputs that arrive as events (an OS input device, a message) rather
+ * than a readable pin. The key starts released.
+ *
+ * @param id   Button ID (from key_id_e)
+ * @param cfg  User configuration
+ * @param cb   Callback function
+ * @param para User parameter passed to callback
+ */
+void lite_button_init_input(key_id_e id, const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+void lite_button_init_input_ctx(lite_button_ctx_t *ctx, key_id_e id,
+                                const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+
+/**
+ * @brief Push the level of an input key
+ *
+ * The level is debounced like a GPIO sample. In EXTI mode a change is
+ * also an EXTI trigger, see lite_button_exti_trigger().
+ *
+ * @param id Button ID of a key set up with lite_button_init_input()
+ * @param lv New level
+ */
+void lite_button_input_set(key_id_e id, btn_level_e lv);
+void lite_button_input_set_ctx(lite_button_ctx_t *ctx, key_id_e id, btn_level_e lv);
+
+#if BTN_POOL_FUN_ENABLE
+/**
+ * @brief Take a free key slot
+ *
+ * For keys found at run time, an I/O expander detected at boot. The lowest
+ * free slot is handed out, so the keys in use stay packed at the front of
+ * the context's tables. Set the key up on the returned id with any of the
+ * lite_button_init functions, as a fixed id.
+ *
+ * @return Key ID, BTN_KEY_INVALID when all BTN_NUM slots are taken
+ */
+key_id_e lite_button_key_alloc(void);
+key_id_e lite_button_key_alloc_ctx(lite_button_ctx_t *ctx);
+
+/**
+ * @brief Remove a key and give its slot back
+ *
+ * Fixed ids can be removed as well. The key stops reporting at once, a
+ * press in progress ends without a release. Combos and sequences on the
+ * key are unregistered, their slots stay taken. Call it from the poll
+ * context or with polling stopped.
+ *
+ * @param id Button ID
+ */
+void lite_button_key_free(key_id_e id);
+void lite_button_key_free_ctx(lite_button_ctx_t *ctx, key_id_e id);
+#endif
+
+#if BTN_DEB_ADAPT_FUN_ENABLE
+/**
+ * @brief Get the debounce window a key has learned so far
+ *
+ * @param id Button ID
+ * @return Window in ms (rounded up in timestamp mode), 0 for an invalid id
+ */
+uint32_t lite_button_debounce_get(key_id_e id);
+uint32_t lite_button_debounce_get_ctx(const lite_button_ctx_t *ctx, key_id_e id);
+#endif
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+/**
+ * @brief Register the monotonic clock of the timestamp engine
+ *
+ * Debounce, long press, multi-click and combo gaps are measured in real
+ * time from this clock instead of counting polls.
+ *
+ * @param clock Free running microsecond counter, wraps at 2^32
+ */
+void lite_button_register_clock(btn_clock_us_f clock);
+void lite_button_register_clock_ctx(lite_button_ctx_t *ctx, btn_clock_us_f clock);
+#endif
+
+#if BTN_PORT_FUN_ENABLE
+/**
+ * @brief Register a GPIO port read as a whole word
+ *
+ * @param port    Port index (0 ~ BTN_PORT_NUM - 1)
+ * @param port_cb Port read function, bit n holds the level of pin n
+ */
+void lite_button_register_port(uint8_t port, btn_port_lv_f port_cb);
+void lite_button_register_port_ctx(lite_button_ctx_t *ctx, uint8_t port, btn_port_lv_f port_cb);
+
+/**
+ * @brief Initialize a button sampled through a registered port
+ *
+ * All port keys are debounced together with vertical counters, events are
+ * still reported through the per-key callback.
+ *
+ * @param id   Button ID (from key_id_e)
+ * @param port Port index the key is wired to
+ * @param pin  Pin (bit) index inside the port word
+ * @param cfg  User configuration
+ * @param cb   Callback function
+ * @param para User parameter passed to callback
+ */
+void lite_button_init_port(key_id_e id, uint8_t port, uint8_t pin,
+                           const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+void lite_button_init_port_ctx(lite_button_ctx_t *ctx, key_id_e id, uint8_t port, uint8_t pin,
+                               const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+#endif
+
+#if BTN_MATRIX_FUN_ENABLE
+/**
+ * @brief Register keyboard matrix scan functions
+ *
+ * @param cb   Row drive and column read functions, column bit n holds the
+ *             level of column n while a row is driven
+ */
+void lite_button_register_matrix(const btn_matrix_cb_t *cb);
+void lite_button_register_matrix_ctx(lite_button_ctx_t *ctx, const btn_matrix_cb_t *cb);
+
+/**
+ * @brief Initialize a button sitting on a keyboard matrix cross point
+ *
+ * @param id   Button ID (from key_id_e)
+ * @param row  Matrix row (0 ~ BTN_MATRIX_ROWS - 1)
+ * @param col  Matrix column (0 ~ BTN_MATRIX_COLS - 1)
+ * @param cfg  User configuration
+ * @param cb   Callback function
+ * @param para User parameter passed to callback
+ */
+void lite_button_init_matrix(key_id_e id, uint8_t row, uint8_t col,
+                             const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+void lite_button_init_matrix_ctx(lite_button_ctx_t *ctx, key_id_e id, uint8_t row, uint8_t col,
+                                 const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+
+/**
+ * @brief Check whether the last complete scan held a ghost pattern
+ *
+ * New presses on the affected rows are blocked until the pattern clears.
+ */
+bool lite_button_matrix_ghost_get(void);
+bool lite_button_matrix_ghost_get_ctx(const lite_button_ctx_t *ctx);
+#endif
+
+#if BTN_ADC_FUN_ENABLE
+/**
+ * @brief Register a resistor ladder read through one ADC channel
+ *
+ * Every poll takes one conversion and looks it up in the band table. A
+ * reading stays in the band of the previous one while it is within
+ * BTN_ADC_HYST counts of it, so noise on a band edge does not flip keys.
+ * Readings above the last band press nothing.
+ *
+ * @param adc     Ladder index (0 ~ BTN_ADC_NUM - 1)
+ * @param read_cb Conversion function
+ * @param band    Band table sorted by max, strictly ascending, kept by reference
+ * @param num     Number of bands (1 ~ BTN_ADC_BAND_MAX), an invalid table is ignored
+ */
+void lite_button_register_adc(uint8_t adc, btn_adc_read_f read_cb,
+                              const btn_adc_band_t *band, size_t num);
+void lite_button_register_adc_ctx(lite_button_ctx_t *ctx, uint8_t adc, btn_adc_read_f read_cb,
+                                  const btn_adc_band_t *band, size_t num);
+
+/**
+ * @brief Initialize a button sitting on a resistor ladder
+ *
+ * The decoded levels are debounced together with the port and matrix
+ * keys, events are still reported through the per-key callback.
+ *
+ * @param id   Button ID (from key_id_e)
+ * @param adc  Ladder index the key is wired to
+ * @param pin  Ladder position, bit index in btn_adc_band_t.pins
+ * @param cfg  User configuration
+ * @param cb   Callback function
+ * @param para User parameter passed to callback
+ */
+void lite_button_init_adc(key_id_e id, uint8_t adc, uint8_t pin,
+                          const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+void lite_button_init_adc_ctx(lite_button_ctx_t *ctx, key_id_e id, uint8_t adc, uint8_t pin,
+                              const btn_cfg_t *cfg, btn_cb_f cb, void *para);
+#endif
+
+#if BTN_EVT_QUEUE_FUN_ENABLE
+/**
+ * @brief Drain the event queue and run the user callbacks
+ *
+ * The state machine only queues events in queue mode, call this from the
+ * main loop or an RTOS task. Single consumer only.
+ *
+ * @return Number of events dispatched
+ */
+size_t lite_button_dispatch(void);
+size_t lite_button_dispatch_ctx(lite_button_ctx_t *ctx);
+
+/**
+ * @brief Get the number of events dropped because the queue was full
+ */
+uint32_t lite_button_evt_overflow_get(void);
+uint32_t lite_button_evt_overflow_get_ctx(const lite_button_ctx_t *ctx);
+#endif
+
+#if BTN_EVT_BATCH_FUN_ENABLE
+/**
+ * @brief Register a callback taking all events of a poll at once
+ *
+ * Events are collected while a poll runs and handed over in one call at
+ * its end, in the order they were detected, instead of one per-key, combo
+ * or sequence callback each. Those callbacks still enable their key,
+ * combo or sequence but are no longer called. In queue mode
+ * lite_button_dispatch() hands the queued events over the same way.
+ *
+ * @param cb   Batch callback, NULL to go back to the per-event callbacks
+ * @param para User parameter passed to the callback
+ */
+void lite_button_register_evt_batch(btn_evt_batch_cb_f cb, void *para);
+void lite_button_register_evt_batch_ctx(lite_button_ctx_t *ctx, btn_evt_batch_cb_f cb, void *para);
+#endif
+
+#if BTN_TRACE_FUN_ENABLE
+/**
+ * @brief Start recording raw samples and EXTI edges
+ *
+ * Every poll appends the levels it sampled, runs of identical polls are
+ * folded into one byte. When the ring is full the oldest records are
+ * dropped and folded into the trace start state.
+ */
+void lite_button_trace_start(void);
+void lite_button_trace_start_ctx(lite_button_ctx_t *ctx);
+
+/**
+ * @brief Stop recording, the trace is kept until the next start
+ */
+void lite_button_trace_stop(void);
+void lite_button_trace_stop_ctx(lite_button_ctx_t *ctx);
+
+/**
+ * @brief Copy the trace out as one self-contained blob
+ *
+ * Stop the trace first, or call this from the poll context.
+ *
+ * @param out  Output buffer
+ * @param size Output buffer size, BTN_TRACE_BLOB_MAX always fits
+ * @return Blob length, 0 if it does not fit
+ */
+size_t lite_button_trace_read(uint8_t *out, size_t size);
+size_t lite_button_trace_read_ctx(const lite_button_ctx_t *ctx, uint8_t *out, size_t size);
+
+/**
+ * @brief Get the number of records dropped because the ring was full
+ */
+uint32_t lite_button_trace_dropped_get(void);
+uint32_t lite_button_trace_dropped_get_ctx(const lite_button_ctx_t *ctx);
+
+/**
+ * @brief Feed a trace back through the state machine at full speed
+ *
+ * Register the same keys, combos and sequences as on the device first,
+ * GPIO, timer and clock callbacks are not called. Keys start idle, so the
+ * replay is exact when the trace holds the whole run from its start; once
+ * records were dropped, events around the new start may differ.
+ *
+ * @param trace Blob from lite_button_trace_read()
+ * @param len   Blob length
+ * @return true if the whole blob was decoded
+ */
+bool lite_button_replay(const uint8_t *trace, size_t len);
+bool lite_button_replay_ctx(lite_button_ctx_t *ctx, const uint8_t *trace, size_t len);
+#endif
+
+#if BTN_SNAPSHOT_FUN_ENABLE
+/**
+ * @brief Save the key state, before deep sleep
+ *
+ * Only keys pressed, in a multi-click window or with a learned debounce
+ * window are saved, an idle set takes a few bytes. Stamps are kept
+ * relative to the last poll, to the clock in timestamp mode. Call it from
+ * the poll context or with polling stopped.
+ *
+ * @param out  Output buffer
+ * @param size Output buffer size, BTN_SNAPSHOT_MAX always fits
+ * @return Snapshot length, 0 if it does not fit
+ */
+size_t lite_button_snapshot(uint8_t *out, size_t size);
+size_t lite_button_snapshot_ctx(const lite_button_ctx_t *ctx, uint8_t *out, size_t size);
+
+/**
+ * @brief Resume the key state saved by lite_button_snapshot()
+ *
+ * Set up the same keys, combos and sequences first, callbacks can not be
+ * saved; a snapshot taken under another setup is refused. Call it before
+ * the timer or any EXTI handler runs. Saved keys are polled again at once.
+ *
+ * @param snap     Snapshot
+ * @param len      Snapshot length
+ * @param slept_ms Time since the snapshot, stamps and windows move on by it
+ * @return true if restored, false leaves the context as it was
+ */
+bool lite_button_restore(const uint8_t *snap, size_t len, uint32_t slept_ms);
+bool lite_button_restore_ctx(lite_button_ctx_t *ctx, const uint8_t *snap, size_t len, uint32_t slept_ms);
+
+/**
+ * @brief Report the press of a key whose edge woke the device up
+ *
+ * The edge came before the library could see it, so the key counts as
+ * pressed at once and its release is debounced by the polls as usual.
+ * Call it after lite_button_restore() or a cold set up, before the timer
+ * runs.
+ *
+ * @param id Key ID
+ */
+void lite_button_wake(key_id_e id);
+void lite_button_wake_ctx(lite_button_ctx_t *ctx, key_id_e id);
+#endif
+
+#if BTN_STATS_FUN_ENABLE
+/**
+ * @brief Register the counter poll and callback times are measured with
+ *
+ * Any free running 32-bit counter will do, a cycle counter for instance,
+ * times are reported in its units. Without one only counts are kept.
+ */
+void lite_button_register_stats_clock(btn_stats_clock_f clock);
+void lite_button_register_stats_clock_ctx(lite_button_ctx_t *ctx, btn_stats_clock_f clock);
+
+/**
+ * @brief Copy the instrumentation counters out while polling goes on
+ *
+ * The copy is retried when a poll updated the counters meanwhile. Timer
+ * counts from lite_button_exti_trigger() and callback times from
+ * lite_button_dispatch() are single word updates outside this check.
+ *
+ * @param out Snapshot
+ * @return true if the copy is consistent, false after BTN_STATS_READ_TRY
+ *         polls got in the way (always so from inside a poll callback)
+ */
+bool lite_button_stats_get(btn_stats_t *out);
+bool lite_button_stats_get_ctx(const lite_button_ctx_t *ctx, btn_stats_t *out);
+
+/**
+ * @brief Clear the counters, from the poll context or with polling stopped
+ */
+void lite_button_stats_reset(void);
+void lite_button_stats_reset_ctx(lite_button_ctx_t *ctx);
+#endif
 
 #if BTN_COMBO_FUN_ENABLE
 /**
@@ -170,22 +1255,71 @@ void lite_button_init(key_id_e id, btn_gpio_lv_f gpio_cb,
  * @param para User parameter passed to callback
  */
 void lite_button_register_combos(key_combo_id_e id, const btn_combo_cfg_t *cfg, btn_combo_cb_f cb, void *para);
+void lite_button_register_combos_ctx(lite_button_ctx_t *ctx, key_combo_id_e id, const btn_combo_cfg_t *cfg,
+                                     btn_combo_cb_f cb, void *para);
+
+#if BTN_POOL_FUN_ENABLE
+/**
+ * @brief Take a free combo slot, register the combo on the returned id
+ *
+ * @return Combo key ID, BTN_COMBO_INVALID when all BTN_COMBO_NUM slots are taken
+ */
+key_combo_id_e lite_button_combo_alloc(void);
+key_combo_id_e lite_button_combo_alloc_ctx(lite_button_ctx_t *ctx);
+
+/**
+ * @brief Unregister a combo and give its slot back
+ *
+ * @param id Combo key ID
+ */
+void lite_button_combo_free(key_combo_id_e id);
+void lite_button_combo_free_ctx(lite_button_ctx_t *ctx, key_combo_id_e id);
+#endif
+#endif
+
+#if BTN_SEQ_FUN_ENABLE
+/**
+ * @brief Register a key sequence (keys pressed one after another)
+ *
+ * All sequences are compiled into one automaton advanced on every press,
+ * the cost per press does not depend on the number of sequences. A gap
+ * longer than BTN_SEQ_STEP_MS between two presses restarts matching.
+ * A sequence that does not fit in BTN_SEQ_NODE_MAX states is dropped.
+ *
+ * @param id   Sequence ID (from key_seq_id_e)
+ * @param cfg  Sequence configuration
+ * @param cb   Callback function, NULL to unregister
+ * @param para User parameter passed to callback
+ */
+void lite_button_register_seq(key_seq_id_e id, const btn_seq_cfg_t *cfg, btn_seq_cb_f cb, void *para);
+void lite_button_register_seq_ctx(lite_button_ctx_t *ctx, key_seq_id_e id, const btn_seq_cfg_t *cfg,
+                                  btn_seq_cb_f cb, void *para);
 #endif
 
 #if BTN_EXTI_FUN_ENABLE
 /**
  * @brief Register timer
  *
+ * A context other than the default one needs cb->creat_arg, or a timer of
+ * the caller's own that calls lite_button_poll_handle_ctx().
+ *
  * @param cb   Timer callback function
  */
 void lite_button_register_timer(btn_timer_cb_t *cb);
+void lite_button_register_timer_ctx(lite_button_ctx_t *ctx, btn_timer_cb_t *cb);
 
 /**
  * @brief EXIT call
  *
+ * With BTN_ATOMIC_FUN_ENABLE it may run on any core or thread at the same
+ * time as the poll: the key is published with an atomic or, and the timer
+ * is started by whichever caller owns it at that moment. A poll that comes
+ * due while an EXTI handler owns the timer is run by that handler.
+ *
  * @param cb   EXIT irq handle call function
  */
 void lite_button_exti_trigger(key_id_e i);
+void lite_button_exti_trigger_ctx(lite_button_ctx_t *ctx, key_id_e i);
 #else 
 
 /**
@@ -194,6 +1328,11 @@ void lite_button_exti_trigger(key_id_e i);
 void lite_button_poll_handle(void);
 #endif
 
+/**
+ * @brief Poll handler of a context, run from its timer in EXTI mode
+ */
+void lite_button_poll_handle_ctx(lite_button_ctx_t *ctx);
+
 #ifdef __cplusplus
 }
 #endif
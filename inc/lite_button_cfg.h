@@ -9,7 +9,9 @@
  *   - Enable/disable optional features
  *   - User Keys 
  *
- * @note Modify this file to adapt the library to your project.
+ * @note Modify this file to adapt the library to your project. Timing and
+ *       feature options can also be overridden from the compiler command
+ *       line (-D), as the host simulation build does.
  */
 
 #ifndef __LITE_BUTTON_CONFIG_H__
@@ -29,20 +31,209 @@ extern "C" {
 #define BTN_ACTIVE_LEVEL     BTN_LEVEL_LOW
 
 /** Button polling period in milliseconds */
+#ifndef BTN_POLL_PERIOD_MS
 #define BTN_POLL_PERIOD_MS   (20)
+#endif
 
 /** Button debounce time in milliseconds */
+#ifndef BTN_DEBOUNCE_MS
 #define BTN_DEBOUNCE_MS      (20)
+#endif
+/** Lockout window (ms) of zero latency keys, from their press on */
+#ifndef BTN_LOCKOUT_MS
+#define BTN_LOCKOUT_MS       (BTN_DEBOUNCE_MS)
+#endif
+/** Adaptive debounce bounds (ms), every key starts at BTN_DEBOUNCE_MS */
+#ifndef BTN_DEBOUNCE_MIN_MS
+#define BTN_DEBOUNCE_MIN_MS  (BTN_DEBOUNCE_MS / 4)
+#endif
+#ifndef BTN_DEBOUNCE_MAX_MS
+#define BTN_DEBOUNCE_MAX_MS  (BTN_DEBOUNCE_MS * 2)
+#endif
+/** Clean switches in a row before a key's learned debounce shrinks a step (1 ~ 15) */
+#define BTN_DEBOUNCE_LEARN_CNT  (4)
 /** Maximum interval for multi-click detection (ms) */
+#ifndef BTN_MULTI_GAP_MS
 #define BTN_MULTI_GAP_MS     (400)
+#endif
 /** Maximum interval between combo keys (ms) */
+#ifndef BTN_COMBO_GAP_MS
 #define BTN_COMBO_GAP_MS     (150)
+#endif
+/** Maximum number of keys in one combo (2 ~ KEY_MAX) */
+#ifndef BTN_COMBO_KEY_MAX
+#define BTN_COMBO_KEY_MAX    (3)
+#endif
 
 /** Feature enable flags (0)-Disable (1)-Enable*/
+#ifndef BTN_LONGPRESS_FUN_ENABLE
 #define BTN_LONGPRESS_FUN_ENABLE     (1)
+#endif
+#ifndef BTN_MULTICLICK_FUN_ENABLE
 #define BTN_MULTICLICK_FUN_ENABLE    (1)
+#endif
+#ifndef BTN_COMBO_FUN_ENABLE
 #define BTN_COMBO_FUN_ENABLE         (1)
+#endif
+#ifndef BTN_EXTI_FUN_ENABLE
 #define BTN_EXTI_FUN_ENABLE          (1)
+#endif
+#ifndef BTN_PORT_FUN_ENABLE
+#define BTN_PORT_FUN_ENABLE          (0)
+#endif
+#ifndef BTN_MATRIX_FUN_ENABLE
+#define BTN_MATRIX_FUN_ENABLE        (0)
+#endif
+/** Per key debounce window learned from the bounce seen on each switch,
+ *  GPIO and input keys only, port, matrix and ADC keys keep the shared
+ *  vertical counter */
+#ifndef BTN_DEB_ADAPT_FUN_ENABLE
+#define BTN_DEB_ADAPT_FUN_ENABLE     (0)
+#endif
+/** Keys set up with BTN_DEB_LOCKOUT report the press on the first active
+ *  sample or edge, then ignore the key for BTN_LOCKOUT_MS; the release is
+ *  still integrated. GPIO and input keys only */
+#ifndef BTN_DEB_LOCKOUT_FUN_ENABLE
+#define BTN_DEB_LOCKOUT_FUN_ENABLE   (0)
+#endif
+/** Poll mode only, GPIO and input keys are sampled at periods of their own
+ *  (cfg->poll_ms), scheduled on a hashed timer wheel */
+#ifndef BTN_WHEEL_FUN_ENABLE
+#define BTN_WHEEL_FUN_ENABLE         (0)
+#endif
+/** EXTI mode without timestamps, a settled key is skipped by the polls
+ *  until an edge or its long press, repeat or multi-click gap timeout comes
+ *  off a hierarchical timing wheel. The key EXTI must fire on both edges, a
+ *  held key waits for its release edge. Poll and timestamp modes keep their
+ *  own scheduling, combo windows are checked on press edges and take no slot */
+#ifndef BTN_TIMEOUT_WHEEL_FUN_ENABLE
+#define BTN_TIMEOUT_WHEEL_FUN_ENABLE (0)
+#endif
+/** Resistor ladder keys, one ADC conversion per poll decodes a whole ladder */
+#ifndef BTN_ADC_FUN_ENABLE
+#define BTN_ADC_FUN_ENABLE           (0)
+#endif
+#ifndef BTN_EVT_QUEUE_FUN_ENABLE
+#define BTN_EVT_QUEUE_FUN_ENABLE     (0)
+#endif
+/** EXTI mode only, the timer is a one-shot armed to the next deadline and
+ *  the key EXTI must fire on both edges */
+#ifndef BTN_TICKLESS_FUN_ENABLE
+#define BTN_TICKLESS_FUN_ENABLE      (0)
+#endif
+/** EXTI mode only, EXTI handlers hand keys and timer requests over with
+ *  C11 atomics instead of BTN_HW_INTERRUPT_DISABLE(), needs a C11 compiler */
+#ifndef BTN_ATOMIC_FUN_ENABLE
+#define BTN_ATOMIC_FUN_ENABLE        (0)
+#endif
+/** Time keys from a microsecond clock instead of poll ticks */
+#ifndef BTN_TIMESTAMP_FUN_ENABLE
+#define BTN_TIMESTAMP_FUN_ENABLE     (0)
+#endif
+#ifndef BTN_SEQ_FUN_ENABLE
+#define BTN_SEQ_FUN_ENABLE           (0)
+#endif
+/** Per key event subscription, unsubscribed long press and multi-click
+ *  tracking is skipped for that key */
+#ifndef BTN_EVT_MASK_FUN_ENABLE
+#define BTN_EVT_MASK_FUN_ENABLE      (0)
+#endif
+/** Hand all events of a poll to one callback as an array */
+#ifndef BTN_EVT_BATCH_FUN_ENABLE
+#define BTN_EVT_BATCH_FUN_ENABLE     (0)
+#endif
+/** Record raw samples and EXTI edges into a trace ring for replay */
+#ifndef BTN_TRACE_FUN_ENABLE
+#define BTN_TRACE_FUN_ENABLE         (0)
+#endif
+/** Save the key state into a few bytes before deep sleep and resume it,
+ *  with the press that woke the device up */
+#ifndef BTN_SNAPSHOT_FUN_ENABLE
+#define BTN_SNAPSHOT_FUN_ENABLE      (0)
+#endif
+/** Key and combo slots taken and given back at run time, the tables are
+ *  sized from BTN_POOL_KEY_NUM and BTN_POOL_COMBO_NUM instead of the ids,
+ *  the polls walk the masks up to the word of the last key set up */
+#ifndef BTN_POOL_FUN_ENABLE
+#define BTN_POOL_FUN_ENABLE          (0)
+#endif
+/** Narrow per key counters sized from the timing options, packed flags */
+#ifndef BTN_COMPACT_FUN_ENABLE
+#define BTN_COMPACT_FUN_ENABLE       (0)
+#endif
+/** Count bounces, detection latency, callback and poll time (instrumentation) */
+#ifndef BTN_STATS_FUN_ENABLE
+#define BTN_STATS_FUN_ENABLE         (0)
+#endif
+
+/** Longest long press or repeat time (compact mode), longer ones are clipped */
+#define BTN_LONGPRESS_MAX_MS         (10000)
+
+/** Key and combo slots per context (pool mode), at least KEY_MAX and
+ *  KEY_COMBO_MAX: the fixed ids keep the low slots */
+#ifndef BTN_POOL_KEY_NUM
+#define BTN_POOL_KEY_NUM             (16)
+#endif
+#ifndef BTN_POOL_COMBO_NUM
+#define BTN_POOL_COMBO_NUM           (8)
+#endif
+
+/** Number of GPIO ports sampled as a whole word (port mode) */
+#define BTN_PORT_NUM                 (2)
+
+/** Resistor ladders (ADC mode), bands per ladder and the noise margin in
+ *  ADC counts a reading must leave its band by before it switches band */
+#define BTN_ADC_NUM                  (1)
+#define BTN_ADC_BAND_MAX             (16)
+#ifndef BTN_ADC_HYST
+#define BTN_ADC_HYST                 (16)
+#endif
+
+/** Keyboard matrix size (matrix mode), columns are read as one word (<= 32) */
+#ifndef BTN_MATRIX_ROWS
+#define BTN_MATRIX_ROWS              (8)
+#endif
+#ifndef BTN_MATRIX_COLS
+#define BTN_MATRIX_COLS              (8)
+#endif
+/** Rows scanned per poll, a full scan spans ROWS / ROWS_PER_POLL polls */
+#ifndef BTN_MATRIX_ROWS_PER_POLL
+#define BTN_MATRIX_ROWS_PER_POLL     (8)
+#endif
+
+/** Key sequences (sequence mode): keys per sequence, automaton states
+ *  (at most the sum of all sequence lengths + 1) and max gap between presses */
+#define BTN_SEQ_KEY_MAX              (8)
+#ifndef BTN_SEQ_NODE_MAX
+#define BTN_SEQ_NODE_MAX             (32)
+#endif
+#define BTN_SEQ_STEP_MS              (1000)
+
+/** Timer wheel slots (wheel mode), must be a power of 2; keys with longer
+ *  periods (in polls) come round and are passed over until due */
+#define BTN_WHEEL_SLOTS              (16)
+
+/** Timing wheel levels of 32 slots (timeout wheel mode, 1 ~ 6), they reach
+ *  32^LEVELS ticks; a later timeout comes round early and is put back */
+#ifndef BTN_TMO_LEVELS
+#define BTN_TMO_LEVELS               (3)
+#endif
+
+/** Event queue depth (queue mode), must be a power of 2 */
+#define BTN_EVT_QUEUE_SIZE           (16)
+
+/** Events collected on the stack per batch callback (event batch mode), a
+ *  poll reporting more makes one more call per BTN_EVT_BATCH_SIZE events */
+#define BTN_EVT_BATCH_SIZE           (16)
+
+/** Trace ring size in bytes (trace mode), must be a power of 2 */
+#ifndef BTN_TRACE_BUF_SIZE
+#define BTN_TRACE_BUF_SIZE           (1024)
+#endif
+
+/** Detection latency histogram (stats mode): bin 0 counts < 1 ms,
+ *  bin n [2^(n-1), 2^n) ms, the last bin everything longer */
+#define BTN_STATS_LAT_BINS           (8)
 
 #ifdef BTN_HW_INTERRUPT_DISABLE
 #define BTN_HW_INTERRUPT_DISABLE()    __disable_irq();
@@ -52,10 +243,20 @@ extern "C" {
 #define BTN_HW_INTERRUPT_ENABLE()   do {} while(0)
 #endif
 
+/** Memory barrier between event queue producer and consumer */
+#ifndef BTN_MEMORY_BARRIER
+#define BTN_MEMORY_BARRIER()        __sync_synchronize()
+#endif
+
 /*==============================================================================
  * Key ID definitions
  *============================================================================*/
 
+/* linux/input.h defines KEY_UP, KEY_DOWN and KEY_OK as evdev key codes */
+#if defined(KEY_UP) || defined(KEY_DOWN) || defined(KEY_OK)
+    #error "include lite_button headers before <linux/input.h>, its key codes share names with the key ids"
+#endif
+
 /**
  * @brief Single key IDs
  */
@@ -80,6 +281,17 @@ typedef enum {
     KEY_COMBO_INVALID,
 } key_combo_id_e;
 
+/**
+ * @brief Key sequence IDs
+ */
+typedef enum {
+    KEY_SEQ_SERVICE = 0,
+    KEY_SEQ_UNLOCK,
+
+    KEY_SEQ_MAX,
+    KEY_SEQ_INVALID,
+} key_seq_id_e;
+
 #ifdef __cplusplus
 }
 #endif
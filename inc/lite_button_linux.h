@@ -0,0 +1,133 @@
+/**
+ * @file    lite_button_linux.h
+ * @brief   Linux backend: input keys fed from file descriptors with epoll.
+ *
+ * Edges are read from descriptors carrying the evdev input_event format or
+ * the GPIO character device line event format (ABI v1 or v2). A timerfd
+ * takes the place of the button timer, so a thread running
+ * btn_linux_wait() sleeps until an edge arrives or the next debounce,
+ * long press or multi-click deadline is due. Any descriptor delivering
+ * the same records works, pipes and socketpairs included.
+ *
+ * Best run with BTN_EXTI_FUN_ENABLE and BTN_TICKLESS_FUN_ENABLE, the timer
+ * is then only armed to the next deadline. BTN_TIMESTAMP_FUN_ENABLE times
+ * keys from CLOCK_MONOTONIC. Without EXTI the timerfd ticks every poll
+ * period.
+ *
+ * @note The lite_button timer callbacks take no argument, so only one
+ *       backend can be active at a time.
+ *
+ * @note <linux/input.h> defines KEY_UP, KEY_DOWN and KEY_OK as evdev key
+ *       codes, the same names as the key ids of lite_button_cfg.h. This
+ *       header does not include it. A file that needs both must include
+ *       <linux/input.h> last and then refer to the key ids by number, as
+ *       the names stand for the evdev codes from there on.
+ */
+
+#ifndef __LITE_BUTTON_LINUX_H__
+#define __LITE_BUTTON_LINUX_H__
+
+#include "lite_button.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Descriptors one backend waits on, besides its timerfd */
+#ifndef BTN_LINUX_SRC_MAX
+#define BTN_LINUX_SRC_MAX    (8)
+#endif
+/** Largest record of the supported formats (gpio_v2_line_event) */
+#define BTN_LINUX_REC_MAX    (48)
+
+typedef enum {
+    BTN_LINUX_EVDEV = 0,    /* struct input_event, EV_KEY press/release, repeats ignored */
+    BTN_LINUX_GPIO_V1,      /* struct gpioevent_data, one line per descriptor */
+    BTN_LINUX_GPIO_V2,      /* struct gpio_v2_line_event, lines told apart by offset */
+} btn_linux_fmt_e;
+
+/*
+ * Source to key mapping: evdev key code or GPIO v2 line offset. A GPIO v1
+ * descriptor carries a single line and uses the first entry only.
+ */
+typedef struct {
+    uint32_t code;
+    key_id_e key;
+} btn_linux_map_t;
+
+typedef struct {
+    int fd;
+    btn_linux_fmt_e fmt;
+    const btn_linux_map_t *map;
+    size_t map_num;
+    uint8_t buf[BTN_LINUX_REC_MAX];     /* partial record left by the last read */
+    size_t len;
+} btn_linux_src_t;
+
+typedef struct {
+    lite_button_ctx_t *ctx;
+    int epfd;
+    int tfd;
+    int tmr_err;                /* errno of a failed timerfd update, 0 for none */
+    uint32_t armed_ms;
+    btn_timer_arg_callback_cb_f poll_cb;
+    void *poll_arg;
+    btn_linux_src_t src[BTN_LINUX_SRC_MAX];
+    size_t src_num;
+} btn_linux_t;
+
+/**
+ * @brief Set up the backend for a context
+ *
+ * Creates the epoll instance and the timerfd, and registers them as the
+ * timer (and in timestamp mode the clock) of the context.
+ *
+ * @param lx  Caller provided backend storage
+ * @param ctx Context initialized with lite_button_ctx_init()
+ * @return 0 on success, -1 with errno set (EBUSY if a backend is active)
+ */
+int btn_linux_init(btn_linux_t *lx, lite_button_ctx_t *ctx);
+
+/**
+ * @brief Wait on an event descriptor
+ *
+ * The descriptor is switched to non-blocking mode and stays owned by the
+ * caller. Mapped keys must be set up with lite_button_init_input_ctx().
+ * A GPIO line reports its physical level: a rising edge is BTN_LEVEL_HIGH.
+ * An evdev key press is BTN_ACTIVE_LEVEL.
+ *
+ * @param lx  Backend
+ * @param fd  Event descriptor
+ * @param fmt Record format
+ * @param map Mapping to keys, kept by reference
+ * @param num Number of mapping entries
+ * @return 0 on success, -1 with errno set
+ */
+int btn_linux_add(btn_linux_t *lx, int fd, btn_linux_fmt_e fmt, const btn_linux_map_t *map, size_t num);
+
+/**
+ * @brief Sleep until an edge or a deadline, then feed it to the context
+ *
+ * Button callbacks run from here, or from lite_button_dispatch_ctx() in
+ * queue mode.
+ *
+ * @param lx         Backend
+ * @param timeout_ms Longest wait, -1 for no limit
+ * @return Number of descriptors served, 0 on timeout or signal, -1 with
+ *         errno set on error. A descriptor that reached end of file is
+ *         dropped and counts as served. A timerfd update that failed
+ *         since the last call is reported as -1 with its errno, the
+ *         deadlines it was meant for may be missed.
+ */
+int btn_linux_wait(btn_linux_t *lx, int timeout_ms);
+
+/**
+ * @brief Close the epoll instance and the timerfd, event descriptors are left open
+ */
+void btn_linux_deinit(btn_linux_t *lx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __LITE_BUTTON_LINUX_H__
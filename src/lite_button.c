@@ -4,10 +4,32 @@
  *
  * Contains internal state machines and logic for:
  *   - Debouncing
+ *   - Per key adaptive debounce learned from the observed bounce(option)
+ *   - Zero latency press with a lockout window, selectable per key(option)
+ *   - Per key sample periods on a hashed timer wheel(option)
+ *   - EXTI keys parked on a hierarchical wheel of timeouts(option)
  *   - Press/release detection
  *   - Long press and repeat press(option)
  *   - Multi-click(option)
  *   - Combo keys(option)
+ *   - Batched port sampling with vertical counter debounce(option)
+ *   - Keyboard matrix scanning with anti-ghosting(option)
+ *   - Resistor ladder keys on one ADC channel(option)
+ *   - Lock-free event queue for deferred callback dispatch(option)
+ *   - Batched event delivery, one callback per poll(option)
+ *   - Per key event subscription masks(option)
+ *   - Tickless EXTI timer armed to the next deadline(option)
+ *   - Lock-free EXTI to poll handoff on C11 atomics(option)
+ *   - Timestamp timing engine on a microsecond clock(option)
+ *   - Key sequence recognition automaton(option)
+ *   - Independent button contexts with caller provided storage
+ *   - Key and combo slots handed out at run time from the context(option)
+ *   - Run-length encoded input trace recording and replay(option)
+ *   - Snapshot and restore of the key state across deep sleep(option)
+ *   - Per key bounce, latency and callback time instrumentation(option)
+ *   - Compact per key state with narrow counters and packed flags(option)
+ *   - Poll mode state machine limited to the active keys
+ *   - Input keys fed with pushed levels instead of a GPIO read
  *
  * @author  HughWu
  * @date    2025-08-16
@@ -20,257 +42,3357 @@
 
 #include "lite_button.h"
 
-static size_t g_btn_tmr_tick = 0;
-static uint32_t g_btn_press_mask = 0;
-static btn_dev_t g_btn_list[BTN_NUM] = {0};
-#if BTN_COMBO_FUN_ENABLE
-static size_t g_btn_combo_num = 0;
-static btn_combo_t g_btn_combo_list[BTN_COMBO_NUM] = {0};
+#if BTN_POOL_FUN_ENABLE
+/* the fixed ids keep the low slots of the pool */
+typedef char btn_pool_check_t[(BTN_POOL_KEY_NUM >= KEY_MAX && BTN_POOL_COMBO_NUM >= KEY_COMBO_MAX) ? 1 : -1];
+
+/* per poll mask walks stop after the last key set up, no bit is set past it */
+#define BTN_KEY_WORDS(ctx)   ((size_t)(ctx)->key_words)
+#define BTN_LIVE_NUM(ctx)    ((size_t)(ctx)->key_live_num)
+#define BTN_LIVE_KEY(ctx, n) ((size_t)(ctx)->key_live[n])
+#else
+#define BTN_KEY_WORDS(ctx)   ((size_t)BTN_MASK_WORDS)
+#define BTN_LIVE_NUM(ctx)    ((size_t)BTN_NUM)
+#define BTN_LIVE_KEY(ctx, n) (n)
 #endif
-#if BTN_EXTI_FUN_ENABLE
-static uint32_t g_btn_exti_mask = 0;
-static btn_timer_t g_btn_timer_handle = {NULL};
 
+/* default context behind the plain API, polled every BTN_POLL_PERIOD_MS */
+static lite_button_ctx_t g_btn_ctx = {
+    .poll_period_ms = BTN_POLL_PERIOD_MS,
+    .poll_ticks = BTN_POLL_TICKS,
+#if BTN_TIMESTAMP_FUN_ENABLE
+    .deb_thr = BTN_DEBOUNCE_TIME,
+#else
+    .deb_thr = BTN_DEBOUNCE_THR,
+#endif
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    .deb_min = BTN_DEBOUNCE_MIN_THR,
+    .deb_max = BTN_DEBOUNCE_MAX_THR,
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    .lock_thr = BTN_LOCKOUT_THR,
+#endif
+    .multi_gap_thr = BTN_MULTI_GAP_THR,
+    .combo_gap_thr = BTN_COMBO_GAP_THR,
+    .seq_step_thr = BTN_SEQ_STEP_THR,
+    .vc_target = BTN_VC_TARGET,
+#if BTN_MATRIX_FUN_ENABLE
+    .vc_mx_target = BTN_VC_MX_TARGET,
+#endif
+};
+
+#if BTN_EXTI_FUN_ENABLE
 void lite_button_poll_handle(void);
 #endif
 
-#if BTN_COMBO_FUN_ENABLE
-static size_t lite_button_combo_tick_diff(key_id_e *keys, btn_combo_num_e num)
+static btn_tick_t lite_button_ms_to_tick(const lite_button_ctx_t *ctx, uint32_t ms)
+{
+#if BTN_TIMESTAMP_FUN_ENABLE
+    (void)ctx;
+    return BTN_MS_TO_TICK(ms);
+#else
+    return ms / ctx->poll_period_ms;
+#endif
+}
+
+#if BTN_TICKLESS_FUN_ENABLE
+static uint32_t lite_button_tick_to_ms(const lite_button_ctx_t *ctx, btn_tick_t t)
+{
+#if BTN_TIMESTAMP_FUN_ENABLE
+    (void)ctx;
+    return (uint32_t)BTN_TICK_TO_MS(t);
+#else
+    return (uint32_t)(t * ctx->poll_period_ms);
+#endif
+}
+#endif
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+static btn_tick_t lite_button_now(const lite_button_ctx_t *ctx)
+{
+    return (ctx->clock != NULL) ? ctx->clock() : 0;
+}
+#endif
+#if BTN_EVT_QUEUE_FUN_ENABLE
+static void lite_button_evt_push(lite_button_ctx_t *ctx, uint16_t id, btn_evt_e evt)
 {
-    size_t t0 = g_btn_list[keys[0]].prs_tick;
-    size_t t1 = g_btn_list[keys[1]].prs_tick;
-    size_t t2 = 0;
+    btn_evt_queue_t *q = &ctx->evt_queue;
+    uint32_t head = q->head;
 
-    if (num == BTN_DOUBLE_KEY_CNT) {
-        return ABS_DIFF(t0, t1);
-    } else if (num == BTN_TRIPLE_KEY_CNT) {
-        t2 = g_btn_list[keys[2]].prs_tick;
-        return MAX3_DIFF(t0, t1, t2);
+    if ((uint32_t)(head - q->tail) >= BTN_EVT_QUEUE_SIZE) {
+        q->overflow++;
+        return;
     }
 
-    return SIZE_MAX;
+    q->buf[head & (BTN_EVT_QUEUE_SIZE - 1)].tick = (uint32_t)ctx->tmr_tick;
+    q->buf[head & (BTN_EVT_QUEUE_SIZE - 1)].id = id;
+    q->buf[head & (BTN_EVT_QUEUE_SIZE - 1)].evt = (uint8_t)evt;
+    // publish the record before the new head
+    BTN_MEMORY_BARRIER();
+    q->head = head + 1;
 }
+#endif
 
-static void lite_button_combo_handle(void)
+#if BTN_TRACE_FUN_ENABLE || BTN_SNAPSHOT_FUN_ENABLE
+static size_t lite_button_varint_put(uint8_t *p, size_t v)
 {
-    btn_combo_t *combo = NULL;
+    size_t n = 0;
 
-    if (HAS_MULTI_BITS(g_btn_press_mask) == 0) return;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
 
-    for (size_t i = 0; i < BTN_COMBO_NUM; i++) {
-        combo = &g_btn_combo_list[i];
-        if (combo->cb == NULL || combo->cfg.num == 0) continue;
+    return n;
+}
 
-        if (g_btn_press_mask != combo->keys_mask) continue;
-        g_btn_press_mask &= ~combo->keys_mask;
-        if (combo->cfg.type == BTN_COMBO_SIMULTANEOUS) {
-            if (lite_button_combo_tick_diff(combo->cfg.keys, combo->cfg.num) <= BTN_COMBO_GAP_THR) {
-                combo->cb(i, combo->para);
-            }
-        } else if (combo->cfg.type == BTN_COMBO_SEQUENTIAL) {
-            for (size_t k = 0; k < combo->cfg.num - 1; k++) {
-                if (g_btn_list[combo->cfg.keys[k]].prs_tick >=
-                    g_btn_list[combo->cfg.keys[k + 1]].prs_tick) {
-                    return;
-                }
-            }
-            combo->cb(i, combo->para);
+/* buf is read through mask, so the ring and a flat blob decode alike */
+static size_t lite_button_varint_get(const uint8_t *buf, size_t mask, size_t pos, size_t end, size_t *v)
+{
+    size_t n = 0;
+    size_t shift = 0;
+    uint8_t b = 0;
+
+    *v = 0;
+    do {
+        if (n >= end - pos || shift >= sizeof(size_t) * 8) return 0;
+        b = buf[(pos + n) & mask];
+        *v |= (size_t)(b & 0x7F) << shift;
+        shift += 7;
+        n++;
+    } while (b & 0x80);
+
+    return n;
+}
+#endif
+
+#if BTN_TRACE_FUN_ENABLE
+/* returns the record length, 0 if it is cut off */
+static size_t lite_button_trace_decode(const uint8_t *buf, size_t mask, size_t pos, size_t end,
+                                       btn_trace_rec_t *rec)
+{
+    size_t n = 1;
+    size_t k = 0;
+    size_t v = 0;
+    uint8_t tag = 0;
+
+    if (pos == end) return 0;
+    tag = buf[pos & mask];
+    rec->type = tag & BTN_TRACE_TYPE_MASK;
+    rec->arg = tag >> 2;
+
+    if (rec->type == BTN_TRACE_POLL) {
+        if ((k = lite_button_varint_get(buf, mask, pos + n, end, &rec->val)) == 0) return 0;
+        n += k;
+        for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+            if ((k = lite_button_varint_get(buf, mask, pos + n, end, &v)) == 0) return 0;
+            n += k;
+            rec->lv.w[w] = (uint32_t)v;
         }
+    } else if (rec->type == BTN_TRACE_EXTI) {
+        if ((k = lite_button_varint_get(buf, mask, pos + n, end, &rec->arg)) == 0) return 0;
+        n += k;
+        if ((k = lite_button_varint_get(buf, mask, pos + n, end, &rec->val)) == 0) return 0;
+        n += k;
+    } else if (rec->type != BTN_TRACE_REPEAT) {
+        return 0;
     }
+
+    return n;
 }
-#endif
 
-#if BTN_MULTICLICK_FUN_ENABLE
-static void lite_button_multi_click_handle(btn_dev_t *btn)
+static void lite_button_trace_apply(btn_trace_pos_t *pos, const btn_trace_rec_t *rec)
+{
+    if (rec->type == BTN_TRACE_POLL) {
+        pos->delta = rec->val;
+        pos->lv = rec->lv;
+        pos->tick += rec->val;
+    } else if (rec->type == BTN_TRACE_REPEAT) {
+        pos->tick += pos->delta * rec->arg;
+    }
+}
+
+static void lite_button_trace_append(lite_button_ctx_t *ctx, const uint8_t *rec, size_t len)
+{
+    btn_trace_t *tr = &ctx->trace;
+    btn_trace_rec_t old;
+    size_t n = 0;
+
+    // make room by folding the oldest records into the start state
+    while (BTN_TRACE_BUF_SIZE - (tr->head - tr->tail) < len) {
+        n = lite_button_trace_decode(tr->buf, BTN_TRACE_BUF_SIZE - 1, tr->tail, tr->head, &old);
+        if (n == 0) {
+            tr->tail = tr->head;
+            break;
+        }
+        lite_button_trace_apply(&tr->base, &old);
+        tr->tail += n;
+        tr->dropped++;
+    }
+
+    tr->last = tr->head;
+    for (n = 0; n < len; n++) {
+        tr->buf[(tr->head + n) & (BTN_TRACE_BUF_SIZE - 1)] = rec[n];
+    }
+    tr->head += len;
+}
+
+static void lite_button_trace_poll(lite_button_ctx_t *ctx)
 {
-    uint32_t interval = GET_INTERVAL(g_btn_tmr_tick, btn->rel_tick);
+    btn_trace_t *tr = &ctx->trace;
+    uint8_t rec[BTN_TRACE_REC_MAX];
+    btn_tick_t delta = ctx->tmr_tick - tr->cur.tick;
+    uint8_t *tag = NULL;
+    size_t n = 0;
 
-    if(interval <= BTN_MULTI_GAP_THR) {
-        btn->click_cnt++;
+    BTN_HW_INTERRUPT_DISABLE();
+    if (delta == tr->cur.delta && btn_mask_eq(&tr->lv, &tr->cur.lv)) {
+        // same sample and spacing as the previous poll, extend the run
+        tag = &tr->buf[tr->last & (BTN_TRACE_BUF_SIZE - 1)];
+        if (tr->head != tr->tail && (*tag & BTN_TRACE_TYPE_MASK) == BTN_TRACE_REPEAT &&
+            (*tag >> 2) < BTN_TRACE_REPEAT_MAX) {
+            *tag += 1U << 2;
+        } else {
+            rec[0] = (1U << 2) | BTN_TRACE_REPEAT;
+            lite_button_trace_append(ctx, rec, 1);
+        }
     } else {
-        btn->click_cnt = BTN_SINGLE_CLICK;
+        rec[n++] = BTN_TRACE_POLL;
+        n += lite_button_varint_put(&rec[n], delta);
+        for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+            n += lite_button_varint_put(&rec[n], tr->lv.w[w]);
+        }
+        lite_button_trace_append(ctx, rec, n);
+        tr->cur.delta = delta;
+        tr->cur.lv = tr->lv;
     }
+    tr->cur.tick = ctx->tmr_tick;
+    BTN_HW_INTERRUPT_ENABLE();
+}
 
-    if(btn->click_cnt == BTN_SINGLE_CLICK) {
-        btn->cb(BTN_EVT_RELEASE, btn->cb_para);
-    } else if(btn->click_cnt == BTN_DOUBLE_CLICK) {
-        btn->cb(BTN_EVT_DOUBLE, btn->cb_para);
-    } else if(btn->click_cnt == BTN_TRIPLE_CLICK) {
-        btn->cb(BTN_EVT_TRIPLE, btn->cb_para);
+#if BTN_EXTI_FUN_ENABLE
+static void lite_button_trace_exti(lite_button_ctx_t *ctx, key_id_e i)
+{
+    btn_trace_t *tr = &ctx->trace;
+    uint8_t rec[BTN_TRACE_REC_MAX];
+    btn_tick_t ofs = 0;
+    size_t n = 0;
+    size_t k = 0;
+
+    BTN_HW_INTERRUPT_DISABLE();
+    // zigzag: the EXTI tick may lie ahead of the last poll (tickless)
+    if (TICK_REACHED(ctx->timer.exti_tick, tr->cur.tick)) {
+        ofs = (ctx->timer.exti_tick - tr->cur.tick) << 1;
+    } else {
+        ofs = ((tr->cur.tick - ctx->timer.exti_tick) << 1) - 1;
+    }
+    rec[n++] = BTN_TRACE_EXTI;
+    n += lite_button_varint_put(&rec[n], (size_t)i);
+    n += lite_button_varint_put(&rec[n], ofs);
+
+    // a bounce repeating the newest record changes nothing on replay
+    if (tr->head != tr->tail && tr->head - tr->last == n) {
+        for (k = 0; k < n; k++) {
+            if (tr->buf[(tr->last + k) & (BTN_TRACE_BUF_SIZE - 1)] != rec[k]) break;
+        }
     }
+    if (k != n) {
+        lite_button_trace_append(ctx, rec, n);
+    }
+    BTN_HW_INTERRUPT_ENABLE();
 }
 #endif
+#endif
 
-#if BTN_LONGPRESS_FUN_ENABLE
-static void lite_button_long_press_handle(btn_dev_t *btn)
+#if BTN_STATS_FUN_ENABLE
+static uint32_t lite_button_stats_clock(const lite_button_ctx_t *ctx)
 {
-    if (btn->lp_cnt == 0) return;
-    if (btn->state == BTN_IDLE_LEVEL) return;
+    return (ctx->stats_clock != NULL) ? ctx->stats_clock() : 0;
+}
 
-    btn->lp_cnt--;
-    if (btn->lp_cnt == 0) {
-        btn->lp_cnt = btn->cfg.lp_rpt_thr;
-        btn->cb(BTN_EVT_LONG, btn->cb_para);
+#if !BTN_TIMESTAMP_FUN_ENABLE || BTN_BATCH_FUN_ENABLE
+/* key i starts to differ from its state, a glitch that never switched goes stale */
+static void lite_button_stats_burst(lite_button_ctx_t *ctx, key_id_e i)
+{
+    if (btn_mask_test(&ctx->stats_burst_on, i) &&
+        GET_INTERVAL(ctx->tmr_tick, ctx->stats_burst[i]) <= 2 * (ctx->deb_thr + ctx->poll_ticks)) {
+        return;
     }
+    ctx->stats_burst[i] = ctx->tmr_tick;
+    btn_mask_set(&ctx->stats_burst_on, i);
 }
 #endif
 
-static void lite_button_state_update(key_combo_id_e i)
+/* key i switches now, start: its first differing sample or edge */
+static void lite_button_stats_detect(lite_button_ctx_t *ctx, key_id_e i, btn_tick_t start)
 {
-    btn_dev_t *btn = NULL;
-    btn_level_e cur_lv = BTN_IDLE_LEVEL;
+#if BTN_TIMESTAMP_FUN_ENABLE
+    uint32_t ms = (uint32_t)(GET_INTERVAL(ctx->tmr_tick, start) / 1000U);
+#else
+    uint32_t ms = (uint32_t)(GET_INTERVAL(ctx->tmr_tick, start) * ctx->poll_period_ms);
+#endif
+    size_t bin = 0;
 
-    btn = &g_btn_list[i];
+    while (ms != 0 && bin < BTN_STATS_LAT_BINS - 1) {
+        ms >>= 1;
+        bin++;
+    }
+    ctx->stats.key[i].lat_hist[bin]++;
+    btn_mask_clr(&ctx->stats_burst_on, i);
+}
 
-    if (btn->cb == NULL || btn->gpio_cb == NULL) return;
+static void lite_button_stats_cb(lite_button_ctx_t *ctx, key_id_e i, btn_evt_e evt)
+{
+    btn_key_stats_t *st = &ctx->stats.key[i];
+    uint32_t t0 = lite_button_stats_clock(ctx);
+    uint32_t t = 0;
 
-    cur_lv = btn->gpio_cb();
-    // debounce
-    if(btn->state == cur_lv) {
-        btn->deb_cnt = 0;
-    } else {
-        btn->deb_cnt++;
-        if(btn->deb_cnt > BTN_DEBOUNCE_THR) {
-            // switch state
-            btn->state = cur_lv;
-            btn->deb_cnt = 0;
-            btn->lp_cnt = btn->cfg.lp_thr;
-
-            // button press
-            if(btn->state == BTN_ACTIVE_LEVEL) {
-                g_btn_press_mask |= BIT(i);
-                btn->prs_tick = g_btn_tmr_tick;
-                btn->cb(BTN_EVT_PRESS, btn->cb_para);
-            }
-            // button release
-            if(btn->state != BTN_ACTIVE_LEVEL) {
-                g_btn_press_mask &= ~BIT(i);
-#if BTN_MULTICLICK_FUN_ENABLE
-                lite_button_multi_click_handle(btn);
-#else
-                btn->cb(BTN_EVT_RELEASE, btn->cb_para);
+    ctx->dev_cfg[i].cb(evt, ctx->dev_cfg[i].cb_para);
+    t = lite_button_stats_clock(ctx) - t0;
+    st->cb_cnt++;
+    st->cb_sum += t;
+    if (t > st->cb_max) st->cb_max = t;
+}
+
+static void lite_button_stats_poll(lite_button_ctx_t *ctx, uint32_t t)
+{
+    btn_stats_t *st = &ctx->stats;
+
+    if (st->poll_cnt == 0 || t < st->poll_min) st->poll_min = t;
+    if (t > st->poll_max) st->poll_max = t;
+    st->poll_sum += t;
+    st->poll_cnt++;
+}
 #endif
-                btn->rel_tick = g_btn_tmr_tick;
-            }
-        }
+
+#if BTN_EVT_BATCH_FUN_ENABLE
+static void lite_button_evt_batch_deliver(lite_button_ctx_t *ctx, const btn_evt_rec_t *rec, size_t num)
+{
+#if BTN_STATS_FUN_ENABLE
+    btn_key_stats_t *st = NULL;
+    uint32_t t0 = lite_button_stats_clock(ctx);
+    uint32_t t = 0;
+#endif
+
+    ctx->evt_batch_cb(rec, num, ctx->evt_batch_para);
+#if BTN_STATS_FUN_ENABLE
+    // every key event of the batch is charged an equal share of the call
+    t = (lite_button_stats_clock(ctx) - t0) / (uint32_t)num;
+    for (size_t n = 0; n < num; n++) {
+        if (rec[n].evt == BTN_EVT_COMBO || rec[n].evt == BTN_EVT_SEQUENCE || rec[n].id >= BTN_NUM) continue;
+        st = &ctx->stats.key[rec[n].id];
+        st->cb_cnt++;
+        st->cb_sum += t;
+        if (t > st->cb_max) st->cb_max = t;
     }
+#endif
+}
 
-    // long press
-#if BTN_LONGPRESS_FUN_ENABLE
-    lite_button_long_press_handle(btn);
+#if !BTN_EVT_QUEUE_FUN_ENABLE
+static void lite_button_evt_batch_flush(lite_button_ctx_t *ctx)
+{
+    size_t num = ctx->evt_batch_num;
+
+    if (num == 0) return;
+    ctx->evt_batch_num = 0;
+    lite_button_evt_batch_deliver(ctx, ctx->evt_batch, num);
+}
+
+static void lite_button_evt_batch_add(lite_button_ctx_t *ctx, uint16_t id, btn_evt_e evt)
+{
+    btn_evt_rec_t rec;
+
+    rec.tick = (uint32_t)ctx->tmr_tick;
+    rec.id = id;
+    rec.evt = (uint8_t)evt;
+
+    // reported outside a poll, nothing to wait for
+    if (ctx->evt_batch == NULL) {
+        lite_button_evt_batch_deliver(ctx, &rec, 1);
+        return;
+    }
+    if (ctx->evt_batch_num >= BTN_EVT_BATCH_SIZE) {
+        lite_button_evt_batch_flush(ctx);
+    }
+    ctx->evt_batch[ctx->evt_batch_num++] = rec;
+}
+#endif
+#endif
+
+static void lite_button_evt_report(lite_button_ctx_t *ctx, key_id_e i, btn_evt_e evt)
+{
+#if BTN_EVT_MASK_FUN_ENABLE
+    if ((ctx->dev_cfg[i].cfg.evt_mask & BTN_EVT_BIT(evt)) == 0) return;
+#endif
+#if BTN_EVT_QUEUE_FUN_ENABLE
+    lite_button_evt_push(ctx, (uint16_t)i, evt);
+#else
+#if BTN_EVT_BATCH_FUN_ENABLE
+    if (ctx->evt_batch_cb != NULL) {
+        lite_button_evt_batch_add(ctx, (uint16_t)i, evt);
+        return;
+    }
+#endif
+#if BTN_STATS_FUN_ENABLE
+    lite_button_stats_cb(ctx, i, evt);
+#else
+    ctx->dev_cfg[i].cb(evt, ctx->dev_cfg[i].cb_para);
+#endif
 #endif
 }
 
-#if BTN_EXTI_FUN_ENABLE
+#if BTN_COMBO_FUN_ENABLE
+static void lite_button_combo_report(lite_button_ctx_t *ctx, key_combo_id_e i)
+{
+#if BTN_EVT_QUEUE_FUN_ENABLE
+    lite_button_evt_push(ctx, (uint16_t)i, BTN_EVT_COMBO);
+#else
+#if BTN_EVT_BATCH_FUN_ENABLE
+    if (ctx->evt_batch_cb != NULL) {
+        lite_button_evt_batch_add(ctx, (uint16_t)i, BTN_EVT_COMBO);
+        return;
+    }
+#endif
+    ctx->combo_list[i].cb(i, ctx->combo_list[i].para);
+#endif
+}
+#endif
 
-static void lite_button_timer_creat(btn_timer_callback_cb_f cb)
+#if BTN_SEQ_FUN_ENABLE
+static void lite_button_seq_report(lite_button_ctx_t *ctx, key_seq_id_e i)
 {
-    if (g_btn_timer_handle.cb.creat == NULL) return;
-    g_btn_timer_handle.cb.creat(cb);
+#if BTN_EVT_QUEUE_FUN_ENABLE
+    lite_button_evt_push(ctx, (uint16_t)i, BTN_EVT_SEQUENCE);
+#else
+#if BTN_EVT_BATCH_FUN_ENABLE
+    if (ctx->evt_batch_cb != NULL) {
+        lite_button_evt_batch_add(ctx, (uint16_t)i, BTN_EVT_SEQUENCE);
+        return;
+    }
+#endif
+    ctx->seq_list[i].cb(i, ctx->seq_list[i].para);
+#endif
 }
 
-static void lite_button_timer_stop(void)
+static void lite_button_seq_advance(lite_button_ctx_t *ctx, key_id_e i, btn_tick_t ts)
 {
-    if (g_btn_timer_handle.cb.stop == NULL) return;
-    g_btn_timer_handle.cb.stop();
-    g_btn_timer_handle.run_flag = false;
+    btn_seq_fsm_t *fsm = &ctx->seq_fsm;
+    btn_seq_node_t n = 0;
+
+    if (fsm->node_num <= 1) return;
+
+    // too long since the previous press, start over
+    if (fsm->state != 0 && GET_INTERVAL(ts, fsm->last_tick) > ctx->seq_step_thr) {
+        fsm->state = 0;
+    }
+    fsm->last_tick = ts;
+    fsm->state = fsm->next[fsm->state][i];
+
+    // every sequence ending here is a suffix found through the output links
+    for (n = fsm->state; n != 0; n = fsm->out_link[n]) {
+        if (fsm->out_id[n] < BTN_SEQ_NUM) {
+            lite_button_seq_report(ctx, (key_seq_id_e)fsm->out_id[n]);
+        }
+    }
 }
+#endif
 
-static void lite_button_timer_start(uint32_t ms)
+#if BTN_COMBO_FUN_ENABLE
+/* spread between the earliest and the latest press of the combo keys */
+static btn_tick_t lite_button_combo_tick_diff(lite_button_ctx_t *ctx, const key_id_e *keys, size_t num)
 {
-    if (g_btn_timer_handle.cb.start == NULL) return;
-    if (g_btn_timer_handle.run_flag) return;
-    g_btn_timer_handle.cb.start(ms);
-    g_btn_timer_handle.run_flag = true;
+    btn_tick_t lo = ctx->list[keys[0]].prs_tick;
+    btn_tick_t hi = lo;
+    btn_tick_t t = 0;
+
+    for (size_t k = 1; k < num; k++) {
+        t = ctx->list[keys[k]].prs_tick;
+        if (!TICK_REACHED(t, lo)) lo = t;
+        if (TICK_REACHED(t, hi)) hi = t;
+    }
+
+    return hi - lo;
 }
 
-static void lite_button_timer_stop_check(key_id_e i)
+static bool lite_button_combo_match(lite_button_ctx_t *ctx, const btn_combo_t *combo)
 {
-    if (g_btn_list[i].state != BTN_ACTIVE_LEVEL) {
-        uint32_t interval = GET_INTERVAL(g_btn_tmr_tick, g_btn_timer_handle.exti_tick);
-        if (interval > BTN_MULTI_GAP_THR) {
-            BTN_HW_INTERRUPT_DISABLE();
-            g_btn_exti_mask &= ~BIT(i);
-            if (g_btn_exti_mask == 0) {
-                lite_button_timer_stop();
+    if (combo->cfg.type == BTN_COMBO_SIMULTANEOUS) {
+        return lite_button_combo_tick_diff(ctx, combo->cfg.keys, combo->cfg.num) <= ctx->combo_gap_thr;
+    } else if (combo->cfg.type == BTN_COMBO_SEQUENTIAL) {
+        for (size_t k = 0; k < (size_t)combo->cfg.num - 1; k++) {
+            if (TICK_REACHED(ctx->list[combo->cfg.keys[k]].prs_tick,
+                             ctx->list[combo->cfg.keys[k + 1]].prs_tick)) {
+                return false;
             }
-            BTN_HW_INTERRUPT_ENABLE();
         }
+        return true;
     }
+
+    return false;
 }
 
-void lite_button_register_timer(btn_timer_cb_t *cb)
+/* first index entry whose mask is not below the given one */
+static size_t lite_button_combo_lower_bound(lite_button_ctx_t *ctx, const btn_mask_t *mask)
 {
-    if (cb == NULL) return;
-    g_btn_timer_handle.cb = *cb;
-    g_btn_timer_handle.run_flag = false;
+    size_t lo = 0;
+    size_t hi = ctx->combo_num;
+    size_t mid = 0;
 
-    lite_button_timer_creat(lite_button_poll_handle);
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (btn_mask_cmp(&ctx->combo_list[ctx->combo_index[mid]].keys_mask, mask) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
 }
 
-void lite_button_exti_trigger(key_id_e i)
+static void lite_button_combo_handle(lite_button_ctx_t *ctx)
 {
-    BTN_HW_INTERRUPT_DISABLE();
-    g_btn_exti_mask |= BIT(i);
-    BTN_HW_INTERRUPT_ENABLE();
-    lite_button_timer_start(BTN_POLL_PERIOD_MS);
-    g_btn_timer_handle.exti_tick = g_btn_tmr_tick;
+    btn_combo_t *combo = NULL;
+    btn_mask_t held;
+    size_t n = 0;
+
+    // the held set only changes on press/release
+    if (!ctx->press_dirty) return;
+    ctx->press_dirty = false;
+
+    if (!btn_mask_has_multi_bits(&ctx->press_mask)) return;
+
+#if BTN_STATS_FUN_ENABLE
+    ctx->stats.combo_lookup++;
+#endif
+    held = ctx->press_mask;
+    for (n = lite_button_combo_lower_bound(ctx, &held); n < ctx->combo_num; n++) {
+        combo = &ctx->combo_list[ctx->combo_index[n]];
+#if BTN_STATS_FUN_ENABLE
+        ctx->stats.combo_scan++;
+#endif
+        if (!btn_mask_eq(&held, &combo->keys_mask)) break;
+
+        btn_mask_clr_mask(&ctx->press_mask, &combo->keys_mask);
+        // combos sharing a key set are tried in id order, the first match wins
+        if (lite_button_combo_match(ctx, combo)) {
+            lite_button_combo_report(ctx, ctx->combo_index[n]);
+            break;
+        }
+    }
 }
 #endif
 
-void lite_button_poll_handle(void)
+#if BTN_MULTICLICK_FUN_ENABLE
+static void lite_button_multi_click_handle(lite_button_ctx_t *ctx, key_id_e i, btn_tick_t ts)
 {
-    g_btn_tmr_tick++;
-    for(size_t i = 0; i < BTN_NUM; i++) {
-#if BTN_EXTI_FUN_ENABLE
-        if ((g_btn_exti_mask & BIT(i)) == 0) continue;
-#endif
-        lite_button_state_update(i);
-#if BTN_EXTI_FUN_ENABLE
-        lite_button_timer_stop_check(i);
+    btn_dev_t *btn = &ctx->list[i];
+    btn_tick_t interval = STAMP_SINCE(btn_gap_tick_t, ts, btn->rel_tick);
+
+    if(btn->mc_on && interval <= ctx->multi_gap_thr) {
+        if (btn->click_cnt < BTN_CLICK_MAX) btn->click_cnt++;
+    } else {
+        btn->click_cnt = BTN_SINGLE_CLICK;
+    }
+
+    if(btn->click_cnt == BTN_SINGLE_CLICK) {
+        lite_button_evt_report(ctx, i, BTN_EVT_RELEASE);
+    } else if(btn->click_cnt == BTN_DOUBLE_CLICK) {
+        lite_button_evt_report(ctx, i, BTN_EVT_DOUBLE);
+    } else if(btn->click_cnt == BTN_TRIPLE_CLICK) {
+        lite_button_evt_report(ctx, i, BTN_EVT_TRIPLE);
+    }
+}
 #endif
+
+#if BTN_LONGPRESS_FUN_ENABLE
+static void lite_button_long_press_handle(lite_button_ctx_t *ctx, key_id_e i)
+{
+    btn_dev_t *btn = &ctx->list[i];
+    const btn_inner_cfg_t *cfg = &ctx->dev_cfg[i].cfg;
+
+    if (!btn->lp_on) return;
+    if (btn->state == BTN_IDLE_LEVEL) return;
+
+    if (STAMP_REACHED(btn_lp_tick_t, ctx->tmr_tick, btn->lp_tick)) {
+        btn->lp_tick = (btn_lp_tick_t)(btn->lp_tick + cfg->lp_rpt_thr);
+        btn->lp_on = (cfg->lp_rpt_thr != 0);
+        lite_button_evt_report(ctx, i, BTN_EVT_LONG);
     }
+}
+#endif
 
-    // combo
+/* ts: when the switch happened, the poll tick or the first edge timestamp */
+static void lite_button_state_switch(lite_button_ctx_t *ctx, key_id_e i, btn_level_e lv, btn_tick_t ts)
+{
+    btn_dev_t *btn = &ctx->list[i];
+    const btn_inner_cfg_t *cfg = &ctx->dev_cfg[i].cfg;
+
+    btn->state = lv;
+    btn->deb_cnt = 0;
+#if !BTN_EXTI_FUN_ENABLE
+    // port and matrix keys join the active set here
+    btn_mask_set(&ctx->active_mask, i);
+#endif
+#if BTN_TIMESTAMP_FUN_ENABLE
+    btn->lp_tick = (btn_lp_tick_t)(ts + cfg->lp_thr);
+#else
+    // first long press fires on the (lp_thr)th poll counting the switching one
+    btn->lp_tick = (btn_lp_tick_t)(ts + cfg->lp_thr - 1);
+#endif
+    btn->lp_on = (cfg->lp_thr != 0);
+
+    // button press
+    if(btn->state == BTN_ACTIVE_LEVEL) {
+        btn_mask_set(&ctx->press_mask, i);
+#if BTN_COMBO_FUN_ENABLE
+        ctx->press_dirty = true;
+        btn->prs_tick = ts;
+#endif
+        lite_button_evt_report(ctx, i, BTN_EVT_PRESS);
+#if BTN_SEQ_FUN_ENABLE
+        lite_button_seq_advance(ctx, i, ts);
+#endif
+    }
+    // button release
+    if(btn->state != BTN_ACTIVE_LEVEL) {
+        btn_mask_clr(&ctx->press_mask, i);
 #if BTN_COMBO_FUN_ENABLE
-    lite_button_combo_handle();
+        ctx->press_dirty = true;
+#endif
+#if BTN_MULTICLICK_FUN_ENABLE
+#if BTN_EVT_MASK_FUN_ENABLE
+        // no clicks to count, no multi-click window to keep open
+        if ((cfg->evt_mask & BTN_EVT_MASK_MULTI) == 0) {
+            lite_button_evt_report(ctx, i, BTN_EVT_RELEASE);
+            return;
+        }
+#endif
+        lite_button_multi_click_handle(ctx, i, ts);
+#else
+        lite_button_evt_report(ctx, i, BTN_EVT_RELEASE);
+#endif
+#if BTN_MULTICLICK_FUN_ENABLE
+        btn->rel_tick = (btn_gap_tick_t)ts;
+        btn->mc_on = true;
 #endif
+    }
 }
 
-#if BTN_COMBO_FUN_ENABLE
-void lite_button_register_combos(key_combo_id_e id, const btn_combo_cfg_t *cfg,
-                                 btn_combo_cb_f cb, void *para)
+static btn_tick_t lite_button_deb_thr(const lite_button_ctx_t *ctx, const btn_dev_t *btn)
 {
-    if (id >= BTN_COMBO_NUM) return;
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    (void)ctx;
+    return btn->deb_thr;
+#else
+    (void)btn;
+    return ctx->deb_thr;
+#endif
+}
 
-    g_btn_combo_list[id].cb = cb;
-    g_btn_combo_list[id].para = para;
-    g_btn_combo_list[id].keys_mask = 0;
+#if BTN_DEB_ADAPT_FUN_ENABLE
+/* btn starts to differ from its state at start: a new burst, or the last one bouncing on */
+static void lite_button_deb_burst(const lite_button_ctx_t *ctx, btn_dev_t *btn, btn_tick_t start)
+{
+    // a switch reverted this soon was a bounce as well, measure it with its burst
+    if (btn->bnc_on && GET_INTERVAL(start, btn->bnc_tick) <= 2 * (btn->deb_thr + ctx->poll_ticks)) {
+        return;
+    }
+    btn->bnc_tick = start;
+    btn->bnc_on = true;
+}
 
-    memcpy(&g_btn_combo_list[id].cfg, cfg, sizeof(btn_combo_cfg_t));
-    for (size_t i = 0; i < cfg->num; i++) {
-        if (cfg->keys[i] < BTN_NUM) {
-            g_btn_combo_list[id].keys_mask |= BIT(cfg->keys[i]);
-        }
+/* btn switches, its level has held since settled: fit the window to the bounce before */
+static void lite_button_deb_learn(const lite_button_ctx_t *ctx, btn_dev_t *btn, btn_tick_t settled)
+{
+    btn_tick_t span = GET_INTERVAL(settled, btn->bnc_tick);
+    btn_tick_t thr = btn->deb_thr;
+    // a quarter over the bounce seen, one tick at least
+    btn_tick_t want = MIN(MAX(span + (span >> 2) + 1, ctx->deb_min), ctx->deb_max);
+
+    if (want >= thr) {
+        // grow at once
+        btn->deb_thr = (btn_deb_thr_t)want;
+        btn->deb_clean = 0;
+    } else if (++btn->deb_clean >= BTN_DEBOUNCE_LEARN_CNT) {
+        // shrink by an eighth after a run of cleaner switches
+        btn->deb_thr = (btn_deb_thr_t)MAX(thr - MAX(thr >> 3, (btn_tick_t)1), want);
+        btn->deb_clean = 0;
     }
 }
 #endif
 
-void lite_button_init(key_id_e id, btn_gpio_lv_f gpio_cb,
-                      const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+/* lockout mode: true while key i is not to be looked at, the press is taken at once */
+static bool lite_button_deb_lockout(lite_button_ctx_t *ctx, key_id_e i, btn_level_e cur_lv)
 {
-    if (id >= BTN_NUM) return;
+    btn_dev_t *btn = &ctx->list[i];
+    btn_tick_t ts = ctx->tmr_tick;
 
-    g_btn_list[id].gpio_cb = gpio_cb;
-    g_btn_list[id].cb = cb;
-    g_btn_list[id].cb_para = para;
+    if (btn->lock_on) {
+        if (GET_INTERVAL(ctx->tmr_tick, btn->lock_tick) < ctx->lock_thr) {
+#if BTN_TIMESTAMP_FUN_ENABLE
+            // the edges of the window are dropped with its levels
+            btn->edge_on = false;
+#endif
+            return true;
+        }
+        btn->lock_on = false;
+    }
+    if (ctx->dev_cfg[i].cfg.deb_mode != BTN_DEB_LOCKOUT) return false;
+    if (btn->state == BTN_ACTIVE_LEVEL || cur_lv != BTN_ACTIVE_LEVEL) return false;
 
-    g_btn_list[id].cfg.lp_thr = cfg->longpress_ms / BTN_POLL_PERIOD_MS;
-    g_btn_list[id].cfg.lp_rpt_thr = cfg->longpress_repeat_ms / BTN_POLL_PERIOD_MS;
+#if BTN_TIMESTAMP_FUN_ENABLE
+    if (btn->edge_on) ts = btn->edge_first;
+    btn->edge_on = false;
+#endif
+#if BTN_STATS_FUN_ENABLE
+    lite_button_stats_detect(ctx, i, ts);
+#endif
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    // the press is not measured, the next release starts a burst of its own
+    btn->bnc_on = false;
+#endif
+    btn->lock_tick = ts;
+    btn->lock_on = true;
+    lite_button_state_switch(ctx, i, cur_lv, ts);
 
-    g_btn_list[id].state = BTN_IDLE_LEVEL;
-    g_btn_list[id].deb_cnt = 0;
-    g_btn_list[id].lp_cnt = 0;
-    g_btn_list[id].click_cnt = 0;
+    return true;
 }
+#endif
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+static void lite_button_debounce(lite_button_ctx_t *ctx, key_id_e i, btn_level_e cur_lv)
+{
+    btn_dev_t *btn = &ctx->list[i];
+    btn_tick_t last = 0;
+
+    // an EXTI that preempted this poll may stamp past tmr_tick, leave it to the next poll
+    if (btn->edge_on && !TICK_REACHED(ctx->tmr_tick, btn->edge_last)) return;
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    if (lite_button_deb_lockout(ctx, i, cur_lv)) return;
+#endif
+    if (btn->state == cur_lv) {
+#if BTN_STATS_FUN_ENABLE
+        // edges were counted as they came in
+        if (btn->deb_cnt != 0 && !btn->edge_on) ctx->stats.key[i].bounce++;
+#endif
+        // glitch over, forget the edges seen so far
+        btn->deb_cnt = 0;
+        btn->edge_on = false;
+        return;
+    }
 
+    // a burst starts at its first EXTI edge, or at the first differing sample
+    if (btn->deb_cnt == 0) {
+        btn->deb_cnt = 1;
+        btn->deb_tick = btn->edge_on ? btn->edge_first : ctx->tmr_tick;
+#if BTN_DEB_ADAPT_FUN_ENABLE
+        lite_button_deb_burst(ctx, btn, btn->deb_tick);
+#endif
+    }
+    // the level must then stay put for the debounce time after the last edge
+    last = btn->edge_on ? btn->edge_last : btn->deb_tick;
+    if (TICK_REACHED(ctx->tmr_tick, (btn_tick_t)(last + lite_button_deb_thr(ctx, btn)))) {
+        btn->edge_on = false;
+#if BTN_STATS_FUN_ENABLE
+        lite_button_stats_detect(ctx, i, btn->deb_tick);
+#endif
+#if BTN_DEB_ADAPT_FUN_ENABLE
+        lite_button_deb_learn(ctx, btn, last);
+#endif
+        lite_button_state_switch(ctx, i, cur_lv, btn->deb_tick);
+    }
+}
+#else
+static void lite_button_debounce(lite_button_ctx_t *ctx, key_id_e i, btn_level_e cur_lv)
+{
+    btn_dev_t *btn = &ctx->list[i];
+
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    if (lite_button_deb_lockout(ctx, i, cur_lv)) return;
+#endif
+    if(btn->state == cur_lv) {
+#if BTN_STATS_FUN_ENABLE
+        if (btn->deb_cnt != 0) ctx->stats.key[i].bounce++;
+#endif
+        btn->deb_cnt = 0;
+    } else {
+#if BTN_STATS_FUN_ENABLE
+        if (btn->deb_cnt == 0) lite_button_stats_burst(ctx, i);
+#endif
+#if BTN_DEB_ADAPT_FUN_ENABLE
+        if (btn->deb_cnt == 0) lite_button_deb_burst(ctx, btn, ctx->tmr_tick);
+#endif
+#if BTN_WHEEL_FUN_ENABLE
+        // polls since the first differing sample, one past the window is enough to keep
+        btn->deb_cnt = (btn_deb_cnt_t)MIN((btn->deb_cnt == 0) ? 1 : btn->deb_cnt + ctx->dev_cfg[i].cfg.poll_div,
+                                          lite_button_deb_thr(ctx, btn) + 1);
+#else
+        btn->deb_cnt++;
+#endif
+        if(btn->deb_cnt > lite_button_deb_thr(ctx, btn)) {
+#if BTN_STATS_FUN_ENABLE
+            lite_button_stats_detect(ctx, i, ctx->stats_burst[i]);
+#endif
+#if BTN_DEB_ADAPT_FUN_ENABLE
+            // the final stable run began deb_cnt samples ago
+            lite_button_deb_learn(ctx, btn, ctx->tmr_tick + 1 - btn->deb_cnt);
+#endif
+            // switch state
+            lite_button_state_switch(ctx, i, cur_lv, ctx->tmr_tick);
+        }
+    }
+}
+#endif
+
+/* input keys have no read function, their level is the one last pushed */
+static btn_level_e lite_button_level_get(lite_button_ctx_t *ctx, key_id_e i)
+{
+    if (ctx->gpio[i] != NULL) return ctx->gpio[i]();
+#if BTN_ATOMIC_FUN_ENABLE
+    return btn_atomic_mask_test(&ctx->input_lv, i) ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL;
+#else
+    return btn_mask_test(&ctx->input_lv, i) ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL;
+#endif
+}
+
+static btn_level_e lite_button_gpio_read(lite_button_ctx_t *ctx, key_id_e i)
+{
+#if BTN_TRACE_FUN_ENABLE
+    btn_level_e lv = BTN_IDLE_LEVEL;
+
+    if (ctx->trace.replay) {
+        return btn_mask_test(&ctx->trace.lv, i) ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL;
+    }
+    lv = lite_button_level_get(ctx, i);
+    if (ctx->trace.on && lv == BTN_ACTIVE_LEVEL) {
+        btn_mask_set(&ctx->trace.lv, i);
+    }
+    return lv;
+#else
+    return lite_button_level_get(ctx, i);
+#endif
+}
+
+/* the time driven part: long press and the multi-click window */
+static void lite_button_state_timers(lite_button_ctx_t *ctx, key_id_e i)
+{
+#if BTN_MULTICLICK_FUN_ENABLE
+    btn_dev_t *btn = &ctx->list[i];
+#endif
+
+    // long press
+#if BTN_LONGPRESS_FUN_ENABLE
+    lite_button_long_press_handle(ctx, i);
+#endif
+#if BTN_MULTICLICK_FUN_ENABLE
+    // close the window while the release stamp can still tell it is over
+    if (btn->mc_on && STAMP_SINCE(btn_gap_tick_t, ctx->tmr_tick, btn->rel_tick) > ctx->multi_gap_thr) {
+        btn->mc_on = false;
+    }
+#else
+    (void)ctx;
+    (void)i;
+#endif
+}
+
+static void lite_button_state_update(lite_button_ctx_t *ctx, key_id_e i)
+{
+    btn_dev_t *btn = NULL;
+    btn_level_e cur_lv = BTN_IDLE_LEVEL;
+
+    btn = &ctx->list[i];
+
+    if (!btn->used) return;
+
+    // port and matrix keys are debounced in lite_button_batch_update()
+    if (ctx->gpio[i] != NULL || btn_mask_test(&ctx->input_mask, i)) {
+        cur_lv = lite_button_gpio_read(ctx, i);
+        lite_button_debounce(ctx, i, cur_lv);
+    }
+
+    lite_button_state_timers(ctx, i);
+}
+
+#if !BTN_EXTI_FUN_ENABLE
+/* released, settled and out of the multi-click window: nothing to time */
+static bool lite_button_at_rest(const lite_button_ctx_t *ctx, key_id_e i)
+{
+    const btn_dev_t *btn = &ctx->list[i];
+
+#if BTN_MULTICLICK_FUN_ENABLE
+    if (btn->mc_on) return false;
+#endif
+    return btn->state == BTN_IDLE_LEVEL && btn->deb_cnt == 0;
+}
+
+#if BTN_WHEEL_FUN_ENABLE
+/* put key id back into the wheel for its next sample, keys not polled leave it */
+static void lite_button_wheel_sched(lite_button_ctx_t *ctx, key_id_e id)
+{
+    btn_wheel_t *whl = &ctx->wheel;
+
+    for (size_t s = 0; s < BTN_WHEEL_SLOTS; s++) {
+        btn_mask_clr(&whl->slot[s], id);
+    }
+    if (!btn_mask_test(&ctx->gpio_mask, id)) return;
+
+    ctx->list[id].whl_due = whl->pos + 1;
+    btn_mask_set(&whl->slot[ctx->list[id].whl_due & (BTN_WHEEL_SLOTS - 1)], id);
+}
+
+/* advance the wheel by a poll, due: the keys to sample on it, moved on to their next slot */
+static void lite_button_wheel_turn(lite_button_ctx_t *ctx, btn_mask_t *due)
+{
+    btn_wheel_t *whl = &ctx->wheel;
+    btn_mask_t *slot = NULL;
+    btn_dev_t *btn = NULL;
+    uint32_t keys = 0;
+    size_t i = 0;
+
+    whl->pos++;
+    slot = &whl->slot[whl->pos & (BTN_WHEEL_SLOTS - 1)];
+    for (size_t w = 0; w < BTN_KEY_WORDS(ctx); w++) {
+        due->w[w] = 0;
+        keys = slot->w[w];
+        while (keys) {
+            i = w * BTN_MASK_WORD_BITS + BTN_CTZ(keys);
+            keys &= keys - 1;
+            btn = &ctx->list[i];
+            // a period longer than the wheel comes round more than once
+            if (btn->whl_due != whl->pos) continue;
+
+            due->w[w] |= BTN_MASK_BIT(i);
+            btn->whl_due += ctx->dev_cfg[i].cfg.poll_div;
+            slot->w[w] &= ~BTN_MASK_BIT(i);
+            btn_mask_set(&whl->slot[btn->whl_due & (BTN_WHEEL_SLOTS - 1)], i);
+        }
+    }
+}
+#endif
+
+/* poll mode: keys at rest only get their level compared, the active ones run the state machine */
+static void lite_button_poll_keys(lite_button_ctx_t *ctx)
+{
+    btn_mask_t woken = {0};
+#if BTN_WHEEL_FUN_ENABLE
+    btn_mask_t due;
+#endif
+    uint32_t keys = 0;
+    size_t i = 0;
+
+#if BTN_WHEEL_FUN_ENABLE
+    // only the keys whose sample falls on this poll
+    lite_button_wheel_turn(ctx, &due);
+#endif
+    for (size_t w = 0; w < BTN_KEY_WORDS(ctx); w++) {
+        keys = ctx->gpio_mask.w[w] & ~ctx->active_mask.w[w];
+#if BTN_WHEEL_FUN_ENABLE
+        keys &= due.w[w];
+#endif
+        while (keys) {
+            i = w * BTN_MASK_WORD_BITS + BTN_CTZ(keys);
+            keys &= keys - 1;
+            // a key at rest is released, anything else starts its debounce
+            if (lite_button_gpio_read(ctx, i) != BTN_IDLE_LEVEL) {
+                woken.w[w] |= BTN_MASK_BIT(i);
+            }
+        }
+        ctx->active_mask.w[w] |= woken.w[w];
+    }
+
+    // in key order, as if every key was visited
+    for (size_t w = 0; w < BTN_KEY_WORDS(ctx); w++) {
+        keys = ctx->active_mask.w[w];
+#if BTN_WHEEL_FUN_ENABLE
+        // port, matrix and ADC keys are sampled every poll, they keep to no wheel
+        keys &= due.w[w] | ~ctx->gpio_mask.w[w];
+#endif
+        while (keys) {
+            i = w * BTN_MASK_WORD_BITS + BTN_CTZ(keys);
+            keys &= keys - 1;
+            if (woken.w[w] & BTN_MASK_BIT(i)) {
+                lite_button_debounce(ctx, i, BTN_ACTIVE_LEVEL);
+                lite_button_state_timers(ctx, i);
+            } else {
+                lite_button_state_update(ctx, i);
+            }
+            if (lite_button_at_rest(ctx, i)) {
+                ctx->active_mask.w[w] &= ~BTN_MASK_BIT(i);
+            }
+        }
+    }
+}
+#endif
+
+#if BTN_PORT_FUN_ENABLE
+static void lite_button_port_sample(lite_button_ctx_t *ctx, btn_mask_t *raw)
+{
+    btn_port_t *port = NULL;
+    uint32_t lv = 0;
+    uint32_t keys = 0;
+    size_t w = 0;
+    size_t b = 0;
+    size_t k = 0;
+
+    for (size_t p = 0; p < BTN_PORT_NUM; p++) {
+        port = &ctx->port_list[p];
+        if (port->port_cb == NULL || btn_mask_is_zero(&port->keys_mask)) continue;
+
+        lv = port->port_cb();
+#if (BTN_ACTIVE_LEVEL == BTN_LEVEL_LOW)
+        lv = ~lv;
+#endif
+        if (port->linear) {
+            // key id = pin + shift for every key on this port
+            lv &= port->pins_mask;
+            if (port->shift < 0) {
+                raw->w[0] |= lv >> -port->shift;
+                continue;
+            }
+            w = BTN_MASK_WORD(port->shift);
+            b = (size_t)port->shift % BTN_MASK_WORD_BITS;
+            raw->w[w] |= lv << b;
+            if (b != 0 && w + 1 < BTN_MASK_WORDS) {
+                raw->w[w + 1] |= lv >> (BTN_MASK_WORD_BITS - b);
+            }
+            continue;
+        }
+
+        for (w = 0; w < BTN_MASK_WORDS; w++) {
+            keys = port->keys_mask.w[w];
+            while (keys) {
+                b = BTN_CTZ(keys);
+                keys &= keys - 1;
+                k = w * BTN_MASK_WORD_BITS + b;
+                raw->w[w] |= ((lv >> ctx->dev_cfg[k].pin) & 1U) << b;
+            }
+        }
+    }
+}
+
+#endif
+
+#if BTN_MATRIX_FUN_ENABLE
+static void lite_button_matrix_commit(lite_button_ctx_t *ctx)
+{
+    btn_matrix_t *mx = &ctx->matrix;
+    bool ghost[BTN_MATRIX_ROWS] = {false};
+    uint32_t cols = 0;
+    size_t c = 0;
+    size_t r = 0;
+
+    // three corners of a rectangle pressed make the fourth one look pressed
+    mx->ghost = false;
+    for (r = 0; r < BTN_MATRIX_ROWS; r++) {
+        if (HAS_MULTI_BITS(mx->scan[r]) == 0) continue;
+        for (size_t r2 = r + 1; r2 < BTN_MATRIX_ROWS; r2++) {
+            if (HAS_MULTI_BITS(mx->scan[r] & mx->scan[r2])) {
+                ghost[r] = true;
+                ghost[r2] = true;
+                mx->ghost = true;
+            }
+        }
+    }
+
+    memset(&mx->raw, 0, sizeof(btn_mask_t));
+    for (r = 0; r < BTN_MATRIX_ROWS; r++) {
+        // ambiguous rows may release keys but never add new ones
+        mx->rows[r] = ghost[r] ? (mx->rows[r] & mx->scan[r]) : mx->scan[r];
+        cols = mx->rows[r];
+        while (cols) {
+            c = BTN_CTZ(cols);
+            cols &= cols - 1;
+            // map holds key id + 1, 0 for an unused cross point
+            if (mx->map[r][c] != 0) {
+                btn_mask_set(&mx->raw, mx->map[r][c] - 1);
+            }
+        }
+    }
+}
+
+static void lite_button_matrix_sample(lite_button_ctx_t *ctx, btn_mask_t *raw)
+{
+    btn_matrix_t *mx = &ctx->matrix;
+    uint32_t cols = 0;
+
+    if (mx->cb.row_drive == NULL || mx->cb.col_read == NULL) return;
+
+    for (size_t n = 0; n < BTN_MATRIX_ROWS_PER_POLL; n++) {
+        mx->cb.row_drive(mx->next_row, true);
+        cols = mx->cb.col_read();
+        mx->cb.row_drive(mx->next_row, false);
+#if (BTN_ACTIVE_LEVEL == BTN_LEVEL_LOW)
+        cols = ~cols;
+#endif
+        mx->scan[mx->next_row] = cols & (uint32_t)((1ULL << BTN_MATRIX_COLS) - 1);
+
+        if (++mx->next_row >= BTN_MATRIX_ROWS) {
+            mx->next_row = 0;
+            lite_button_matrix_commit(ctx);
+            break;
+        }
+    }
+
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        raw->w[w] |= mx->raw.w[w];
+    }
+}
+#endif
+
+#if BTN_ADC_FUN_ENABLE
+/* band index of reading v, adc->band_num above the last band */
+static uint8_t lite_button_adc_decode(btn_adc_t *adc, uint16_t v)
+{
+    uint32_t lo = (adc->cur == 0) ? 0 : adc->band[adc->cur - 1].max + 1U;
+    uint32_t hi = (adc->cur < adc->band_num) ? adc->band[adc->cur].max : UINT16_MAX;
+    size_t l = 0;
+    size_t r = adc->band_num;
+    size_t m = 0;
+
+    // noise around a band edge keeps the band of the last reading
+    if ((uint32_t)v + BTN_ADC_HYST >= lo && v <= hi + BTN_ADC_HYST) return adc->cur;
+
+    // first band whose top is at or above the reading
+    while (l < r) {
+        m = (l + r) / 2;
+        if (adc->band[m].max < v) {
+            l = m + 1;
+        } else {
+            r = m;
+        }
+    }
+    adc->cur = (uint8_t)l;
+
+    return adc->cur;
+}
+
+static void lite_button_adc_sample(lite_button_ctx_t *ctx, btn_mask_t *raw)
+{
+    btn_adc_t *adc = NULL;
+    uint8_t band = 0;
+
+    for (size_t a = 0; a < BTN_ADC_NUM; a++) {
+        adc = &ctx->adc_list[a];
+        if (adc->read_cb == NULL || btn_mask_is_zero(&adc->keys_mask)) continue;
+
+        band = lite_button_adc_decode(adc, adc->read_cb());
+        if (band >= adc->band_num) continue;
+        for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+            raw->w[w] |= adc->band_keys[band].w[w];
+        }
+    }
+}
+#endif
+
+#if BTN_BATCH_FUN_ENABLE
+#if BTN_STATS_FUN_ENABLE
+/* keys of word w that started to differ, and that fell back before switching */
+static void lite_button_stats_batch(lite_button_ctx_t *ctx, size_t w, uint32_t start, uint32_t reset)
+{
+    while (start) {
+        lite_button_stats_burst(ctx, w * BTN_MASK_WORD_BITS + BTN_CTZ(start));
+        start &= start - 1;
+    }
+    while (reset) {
+        ctx->stats.key[w * BTN_MASK_WORD_BITS + BTN_CTZ(reset)].bounce++;
+        reset &= reset - 1;
+    }
+}
+#endif
+
+static void lite_button_batch_update(lite_button_ctx_t *ctx)
+{
+    btn_vc_t *vc = &ctx->vc;
+    btn_mask_t raw = {0};
+    uint32_t delta = 0;
+    uint32_t carry = 0;
+    uint32_t tmp = 0;
+    uint32_t toggle = 0;
+#if BTN_MATRIX_FUN_ENABLE
+    uint32_t mx_hit = 0;
+#endif
+#if BTN_STATS_FUN_ENABLE
+    uint32_t busy = 0;
+#endif
+    size_t k = 0;
+
+#if BTN_TRACE_FUN_ENABLE
+    if (ctx->trace.replay) {
+        raw = ctx->trace.lv;
+    } else {
+#endif
+#if BTN_PORT_FUN_ENABLE
+    lite_button_port_sample(ctx, &raw);
+#endif
+#if BTN_MATRIX_FUN_ENABLE
+    lite_button_matrix_sample(ctx, &raw);
+#endif
+#if BTN_ADC_FUN_ENABLE
+    lite_button_adc_sample(ctx, &raw);
+#endif
+#if BTN_TRACE_FUN_ENABLE
+        if (ctx->trace.on) {
+            for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+                ctx->trace.lv.w[w] |= raw.w[w] & vc->keys_mask.w[w];
+            }
+        }
+    }
+#endif
+
+    for (size_t w = 0; w < BTN_KEY_WORDS(ctx); w++) {
+        if (vc->keys_mask.w[w] == 0) continue;
+
+        // keys whose sample differs from the debounced state count up, others reset
+        delta = (raw.w[w] ^ vc->state.w[w]) & vc->keys_mask.w[w];
+#if BTN_STATS_FUN_ENABLE
+        busy = 0;
+        for (k = 0; k < BTN_VC_BITS; k++) {
+            busy |= vc->cnt[k].w[w];
+        }
+        lite_button_stats_batch(ctx, w, delta & ~busy, busy & ~delta);
+#endif
+        carry = delta;
+        toggle = delta;
+#if BTN_MATRIX_FUN_ENABLE
+        // matrix keys switch on a count of their own
+        mx_hit = delta & ctx->matrix.keys_mask.w[w];
+        toggle &= ~mx_hit;
+#endif
+        for (k = 0; k < BTN_VC_BITS; k++) {
+            tmp = vc->cnt[k].w[w] & carry;
+            vc->cnt[k].w[w] = (vc->cnt[k].w[w] ^ carry) & delta;
+            carry = tmp;
+            toggle &= ((ctx->vc_target >> k) & 1U) ? vc->cnt[k].w[w] : ~vc->cnt[k].w[w];
+#if BTN_MATRIX_FUN_ENABLE
+            mx_hit &= ((ctx->vc_mx_target >> k) & 1U) ? vc->cnt[k].w[w] : ~vc->cnt[k].w[w];
+#endif
+        }
+#if BTN_MATRIX_FUN_ENABLE
+        toggle |= mx_hit;
+#endif
+        if (toggle == 0) continue;
+
+        vc->state.w[w] ^= toggle;
+        for (k = 0; k < BTN_VC_BITS; k++) {
+            vc->cnt[k].w[w] &= ~toggle;
+        }
+
+        while (toggle) {
+            k = BTN_CTZ(toggle);
+            toggle &= toggle - 1;
+            if (!ctx->list[w * BTN_MASK_WORD_BITS + k].used) continue;
+#if BTN_STATS_FUN_ENABLE
+            lite_button_stats_detect(ctx, w * BTN_MASK_WORD_BITS + k, ctx->stats_burst[w * BTN_MASK_WORD_BITS + k]);
+#endif
+            lite_button_state_switch(ctx, w * BTN_MASK_WORD_BITS + k,
+                                     (vc->state.w[w] & BIT(k)) ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL,
+                                     ctx->tmr_tick);
+        }
+    }
+}
+#endif
+
+#if BTN_EXTI_FUN_ENABLE
+
+static void lite_button_timer_poll(void *arg)
+{
+    lite_button_poll_handle_ctx((lite_button_ctx_t *)arg);
+}
+
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+/* hang key i in the slot its timeout falls in, as the wheel stands */
+static void lite_button_tmo_place(btn_tmo_wheel_t *whl, btn_dev_t *btn, key_id_e i)
+{
+    size_t l = 0;
+    size_t s = 0;
+
+    while (l + 1 < BTN_TMO_LEVELS &&
+           (btn->tmo_tick >> ((l + 1) * BTN_TMO_BITS)) != (whl->now >> ((l + 1) * BTN_TMO_BITS))) {
+        l++;
+    }
+    // the top level also holds the next rotation, up to its current slot
+    if ((btn_tick_t)((btn->tmo_tick >> (l * BTN_TMO_BITS)) - (whl->now >> (l * BTN_TMO_BITS))) < BTN_TMO_SLOTS) {
+        s = (btn->tmo_tick >> (l * BTN_TMO_BITS)) & (BTN_TMO_SLOTS - 1);
+    } else {
+        // beyond the wheel, the last top slot comes round first
+        s = ((whl->now >> (l * BTN_TMO_BITS)) - 1) & (BTN_TMO_SLOTS - 1);
+    }
+
+    btn_mask_set(&whl->slot[l][s], i);
+    whl->busy[l] |= BIT(s);
+    btn->tmo_slot = (uint8_t)(l * BTN_TMO_SLOTS + s + 1);
+}
+
+static void lite_button_tmo_cancel(btn_tmo_wheel_t *whl, btn_dev_t *btn, key_id_e i)
+{
+    size_t l = 0;
+    size_t s = 0;
+
+    if (btn->tmo_slot == 0) return;
+    l = (size_t)(btn->tmo_slot - 1) >> BTN_TMO_BITS;
+    s = (size_t)(btn->tmo_slot - 1) & (BTN_TMO_SLOTS - 1);
+    btn_mask_clr(&whl->slot[l][s], i);
+    if (btn_mask_is_zero(&whl->slot[l][s])) {
+        whl->busy[l] &= ~BIT(s);
+    }
+    btn->tmo_slot = 0;
+}
+
+/* time key i out at tick due, a due one already passed comes with the next tick */
+static void lite_button_tmo_set(lite_button_ctx_t *ctx, key_id_e i, btn_tick_t due)
+{
+    btn_dev_t *btn = &ctx->list[i];
+
+    lite_button_tmo_cancel(&ctx->tmo, btn, i);
+    if (TICK_REACHED(ctx->tmo.now, due)) {
+        due = ctx->tmo.now + 1;
+    }
+    btn->tmo_tick = due;
+    lite_button_tmo_place(&ctx->tmo, btn, i);
+}
+
+/* empty slot s of level l, its keys are put back or, on level 0, added to due */
+static void lite_button_tmo_take(lite_button_ctx_t *ctx, size_t l, size_t s, btn_mask_t *due)
+{
+    btn_tmo_wheel_t *whl = &ctx->tmo;
+    btn_mask_t keys = whl->slot[l][s];
+    uint32_t bits = 0;
+    size_t i = 0;
+
+    memset(&whl->slot[l][s], 0, sizeof(btn_mask_t));
+    whl->busy[l] &= ~BIT(s);
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        bits = keys.w[w];
+        while (bits) {
+            i = w * BTN_MASK_WORD_BITS + BTN_CTZ(bits);
+            bits &= bits - 1;
+            ctx->list[i].tmo_slot = 0;
+            if (l == 0) {
+                btn_mask_set(due, i);
+            } else {
+                lite_button_tmo_place(whl, &ctx->list[i], i);
+            }
+        }
+    }
+}
+
+/* turn the wheel on to tick to, due: the keys timed out on the way */
+static void lite_button_tmo_turn(lite_button_ctx_t *ctx, btn_tick_t to, btn_mask_t *due)
+{
+    btn_tmo_wheel_t *whl = &ctx->tmo;
+    uint32_t busy = 0;
+    size_t pos = 0;
+    size_t l = 0;
+
+    memset(due, 0, sizeof(btn_mask_t));
+    while (whl->now != to) {
+        busy = 0;
+        for (l = 0; l < BTN_TMO_LEVELS; l++) {
+            busy |= whl->busy[l];
+        }
+        if (busy == 0) {
+            whl->now = to;
+            break;
+        }
+
+        // nothing left in this level 0 rotation, skip to its last tick
+        pos = whl->now & (BTN_TMO_SLOTS - 1);
+        if ((whl->busy[0] & ~(BIT(pos) | (BIT(pos) - 1))) == 0) {
+            if ((btn_tick_t)(to - whl->now) <= BTN_TMO_SLOTS - 1 - pos) {
+                whl->now = to;
+                break;
+            }
+            whl->now += BTN_TMO_SLOTS - 1 - pos;
+        }
+
+        whl->now++;
+        // a new rotation, higher levels move their slot down first
+        for (l = 1; l < BTN_TMO_LEVELS && (whl->now & (BIT(l * BTN_TMO_BITS) - 1)) == 0; l++) {}
+        while (--l > 0) {
+            lite_button_tmo_take(ctx, l, (whl->now >> (l * BTN_TMO_BITS)) & (BTN_TMO_SLOTS - 1), due);
+        }
+        if (whl->busy[0] & BIT(whl->now & (BTN_TMO_SLOTS - 1))) {
+            lite_button_tmo_take(ctx, 0, whl->now & (BTN_TMO_SLOTS - 1), due);
+        }
+    }
+}
+
+#if BTN_TICKLESS_FUN_ENABLE
+/* ticks to the next timeout, or to the turn moving one down a level; BTN_TICK_MAX for none */
+static btn_tick_t lite_button_tmo_next(const btn_tmo_wheel_t *whl)
+{
+    btn_tick_t next = BTN_TICK_MAX;
+    uint32_t rot = 0;
+    size_t sh = 0;
+    size_t pos = 0;
+
+    for (size_t l = 0; l < BTN_TMO_LEVELS; l++) {
+        if (whl->busy[l] == 0) continue;
+        sh = l * BTN_TMO_BITS;
+        pos = (whl->now >> sh) & (BTN_TMO_SLOTS - 1);
+        // slots counted from the current one, which is already served
+        rot = pos ? ((whl->busy[l] >> pos) | (whl->busy[l] << (BTN_TMO_SLOTS - pos))) : whl->busy[l];
+        rot &= ~1U;
+        if (rot == 0) continue;
+        next = MIN(next, (((whl->now >> sh) + BTN_CTZ(rot)) << sh) - whl->now);
+    }
+
+    return next;
+}
+#endif
+#endif
+
+#if !BTN_TICKLESS_FUN_ENABLE
+static void lite_button_timer_stop(lite_button_ctx_t *ctx)
+{
+    if (ctx->timer.cb.stop == NULL) return;
+    ctx->timer.cb.stop();
+    ctx->timer.run_flag = false;
+#if BTN_STATS_FUN_ENABLE
+    ctx->stats.tmr_stop++;
+#endif
+}
+#endif
+
+#if BTN_LONGPRESS_FUN_ENABLE && (BTN_TICKLESS_FUN_ENABLE || BTN_TIMEOUT_WHEEL_FUN_ENABLE)
+/* ticks to the next long press or repeat of btn, 0 once overdue */
+static btn_tick_t lite_button_lp_left(const lite_button_ctx_t *ctx, const btn_dev_t *btn)
+{
+    btn_lp_tick_t left = STAMP_SINCE(btn_lp_tick_t, btn->lp_tick, ctx->tmr_tick);
+
+    return (left > (STAMP_MAX(btn_lp_tick_t) >> 1)) ? 0 : left;
+}
+#endif
+
+#if BTN_TICKLESS_FUN_ENABLE
+static void lite_button_timer_arm(lite_button_ctx_t *ctx, btn_tick_t ticks)
+{
+    btn_timer_t *tmr = &ctx->timer;
+    btn_tick_t now = ctx->tmr_tick;
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+    now = lite_button_now(ctx);
+#else
+    // credit the ticks of the pending one-shot that already went by, it
+    // may have been restarted since the last poll
+    if (tmr->run_flag && tmr->cb.elapsed != NULL) {
+        now = tmr->start + MIN(tmr->cb.elapsed() / ctx->poll_period_ms, tmr->due - tmr->start);
+    }
+#endif
+
+    if (tmr->cb.start == NULL) return;
+    if (tmr->run_flag) {
+        if (TICK_REACHED(now + ticks, tmr->due)) return;
+        if (tmr->cb.stop != NULL) tmr->cb.stop();
+#if BTN_STATS_FUN_ENABLE
+        ctx->stats.tmr_stop++;
+#endif
+    }
+
+    tmr->cb.start(lite_button_tick_to_ms(ctx, ticks));
+    tmr->start = now;
+    tmr->due = now + ticks;
+    tmr->run_flag = true;
+#if BTN_STATS_FUN_ENABLE
+    ctx->stats.tmr_start++;
+#endif
+}
+
+static btn_tick_t lite_button_next_deadline(lite_button_ctx_t *ctx)
+{
+#if !BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    btn_dev_t *btn = NULL;
+    uint32_t keys = 0;
+    size_t i = 0;
+#endif
+    btn_tick_t next = BTN_TICK_MAX;
+
+#if BTN_BATCH_FUN_ENABLE
+    for (size_t k = 0; k < BTN_VC_BITS; k++) {
+        if (!btn_mask_is_zero(&ctx->vc.cnt[k])) return ctx->poll_ticks;
+    }
+#endif
+#if BTN_MATRIX_FUN_ENABLE
+    if (ctx->matrix.next_row != 0) return ctx->poll_ticks;
+#endif
+
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    // keys left unparked are debouncing, the rest wait on the wheel
+    for (size_t w = 0; w < BTN_KEY_WORDS(ctx); w++) {
+        if (ctx->exti_mask.w[w] & ~ctx->tmo_park.w[w]) return 1;
+    }
+    next = lite_button_tmo_next(&ctx->tmo);
+#else
+    for (size_t w = 0; w < BTN_KEY_WORDS(ctx); w++) {
+        keys = ctx->exti_mask.w[w];
+        while (keys) {
+            i = w * BTN_MASK_WORD_BITS + BTN_CTZ(keys);
+            keys &= keys - 1;
+            btn = &ctx->list[i];
+            if (btn->deb_cnt != 0) {
+#if BTN_TIMESTAMP_FUN_ENABLE
+                // debounce settles once the level held still long enough
+                next = MIN(next, (btn->edge_on ? btn->edge_last : btn->deb_tick) +
+                                 lite_button_deb_thr(ctx, btn) - ctx->tmr_tick);
+                continue;
+#else
+                // debounce settles one sample at a time
+                return 1;
+#endif
+            }
+
+            if (btn->state == BTN_ACTIVE_LEVEL) {
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+                // end of the lockout, the level is looked at again
+                if (btn->lock_on) {
+                    next = MIN(next, btn->lock_tick + ctx->lock_thr - ctx->tmr_tick);
+                }
+#endif
+#if BTN_LONGPRESS_FUN_ENABLE
+                // long press or repeat expiry
+                if (btn->lp_on) {
+                    next = MIN(next, lite_button_lp_left(ctx, btn));
+                }
+#endif
+            } else {
+                // end of the multi-click gap, the key leaves the EXTI mask then
+                next = MIN(next, ctx->timer.exti_tick + ctx->multi_gap_thr + 1 - ctx->tmr_tick);
+            }
+        }
+    }
+#endif
+
+#if BTN_SEQ_FUN_ENABLE && !BTN_TIMESTAMP_FUN_ENABLE
+    // end of the step a sequence under way waits for
+    if (ctx->seq_fsm.state != 0) {
+        next = MIN(next, ctx->seq_fsm.last_tick + ctx->seq_step_thr + 1 - ctx->tmr_tick);
+    }
+#endif
+
+    if (next == BTN_TICK_MAX) return 0;
+    // deadlines already passed are due at once
+    if (next > (BTN_TICK_MAX >> 1)) return 1;
+    return MAX(next, 1);
+}
+
+static void lite_button_timer_rearm(lite_button_ctx_t *ctx)
+{
+    btn_tick_t next = lite_button_next_deadline(ctx);
+
+    // the one-shot that triggered this poll has expired
+    ctx->timer.run_flag = false;
+    if (next != 0) {
+        lite_button_timer_arm(ctx, next);
+    }
+}
+#else
+static void lite_button_timer_start(lite_button_ctx_t *ctx, uint32_t ms)
+{
+    if (ctx->timer.cb.start == NULL) return;
+    if (ctx->timer.run_flag) return;
+    ctx->timer.cb.start(ms);
+    ctx->timer.run_flag = true;
+#if BTN_STATS_FUN_ENABLE
+    ctx->stats.tmr_start++;
+#endif
+}
+#endif
+
+static void lite_button_timer_stop_check(lite_button_ctx_t *ctx, key_id_e i)
+{
+#if !BTN_TICKLESS_FUN_ENABLE
+    bool idle = false;
+#endif
+
+    if (ctx->list[i].state != BTN_ACTIVE_LEVEL) {
+        // an EXTI stamped past tmr_tick keeps the key awake
+        if (TICK_REACHED(ctx->tmr_tick, (btn_tick_t)(ctx->timer.exti_tick + ctx->multi_gap_thr + 1))) {
+#if !BTN_ATOMIC_FUN_ENABLE
+            BTN_HW_INTERRUPT_DISABLE();
+#endif
+            btn_mask_clr(&ctx->exti_mask, i);
+#if BTN_MULTICLICK_FUN_ENABLE
+            // no release stamp is checked until the key wakes up again
+            ctx->list[i].mc_on = false;
+#endif
+#if !BTN_TICKLESS_FUN_ENABLE
+            // with atomics an EXTI racing this stop leaves a wake request behind
+            idle = btn_mask_is_zero(&ctx->exti_mask);
+#if BTN_SEQ_FUN_ENABLE && !BTN_TIMESTAMP_FUN_ENABLE
+            // a sequence under way still needs the ticks, lite_button_seq_expire() stops it
+            idle = idle && (ctx->seq_fsm.state == 0);
+#endif
+            if (idle) {
+                lite_button_timer_stop(ctx);
+            }
+#endif
+#if !BTN_ATOMIC_FUN_ENABLE
+            BTN_HW_INTERRUPT_ENABLE();
+#endif
+        }
+    }
+}
+
+#if BTN_SEQ_FUN_ENABLE && !BTN_TIMESTAMP_FUN_ENABLE
+/*
+ * Ticks only count while the timer runs, so a sequence under way keeps it
+ * running until the step time after its last press is over.
+ */
+static void lite_button_seq_expire(lite_button_ctx_t *ctx)
+{
+    btn_seq_fsm_t *fsm = &ctx->seq_fsm;
+
+    if (fsm->state == 0 || GET_INTERVAL(ctx->tmr_tick, fsm->last_tick) <= ctx->seq_step_thr) return;
+
+    fsm->state = 0;
+#if !BTN_TICKLESS_FUN_ENABLE
+#if !BTN_ATOMIC_FUN_ENABLE
+    BTN_HW_INTERRUPT_DISABLE();
+#endif
+    if (btn_mask_is_zero(&ctx->exti_mask)) {
+        lite_button_timer_stop(ctx);
+    }
+#if !BTN_ATOMIC_FUN_ENABLE
+    BTN_HW_INTERRUPT_ENABLE();
+#endif
+#endif
+}
+#endif
+
+void lite_button_register_timer_ctx(lite_button_ctx_t *ctx, btn_timer_cb_t *cb)
+{
+    if (cb == NULL) return;
+    ctx->timer.cb = *cb;
+    ctx->timer.run_flag = false;
+
+    if (cb->creat_arg != NULL) {
+        cb->creat_arg(lite_button_timer_poll, ctx);
+    } else if (cb->creat != NULL && ctx == &g_btn_ctx) {
+        // a plain callback can only reach the default context
+        cb->creat(lite_button_poll_handle);
+    }
+}
+
+void lite_button_register_timer(btn_timer_cb_t *cb)
+{
+    lite_button_register_timer_ctx(&g_btn_ctx, cb);
+}
+
+/* wake key i up for polling, ts: edge time in timestamp mode */
+static void lite_button_exti_mark(lite_button_ctx_t *ctx, key_id_e i, btn_tick_t ts)
+{
+#if BTN_TIMESTAMP_FUN_ENABLE
+    btn_dev_t *btn = &ctx->list[i];
+
+    // keep the edge time, debounce and press time are measured from it
+    if (!btn->edge_on) {
+        btn->edge_first = ts;
+    }
+#if BTN_STATS_FUN_ENABLE
+    // every further edge of a burst restarts the debounce time
+    if (btn->edge_on) ctx->stats.key[i].bounce++;
+#endif
+    btn->edge_last = ts;
+    btn->edge_on = true;
+#else
+    (void)ts;
+#endif
+
+#if BTN_ATOMIC_FUN_ENABLE
+    // the next poll moves it over to exti_mask
+    btn_atomic_mask_set(&ctx->exti_pend, i);
+#else
+    BTN_HW_INTERRUPT_DISABLE();
+    btn_mask_set(&ctx->exti_mask, i);
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    // a parked key is visited again by the next poll
+    btn_mask_set(&ctx->exti_new, i);
+#endif
+    BTN_HW_INTERRUPT_ENABLE();
+#endif
+}
+
+#if BTN_ATOMIC_FUN_ENABLE
+/*
+ * Timer ownership: a poll or an EXTI handler sets BTN_TMR_BUSY to drive the
+ * timer. Others leave their request in the same word instead of waiting,
+ * the owner serves it before it lets go.
+ */
+#define BTN_TMR_BUSY         (1U << 0)
+#define BTN_TMR_WAKE         (1U << 1)  /* a key was triggered */
+#define BTN_TMR_POLL         (1U << 2)  /* the timer fired */
+
+static void lite_button_poll_run(lite_button_ctx_t *ctx);
+
+/* poll within poll_ticks */
+static void lite_button_timer_wake(lite_button_ctx_t *ctx)
+{
+#if BTN_TICKLESS_FUN_ENABLE
+    lite_button_timer_arm(ctx, ctx->poll_ticks);
+#else
+    lite_button_timer_start(ctx, ctx->poll_period_ms);
+#endif
+}
+
+/* serve requests until none is left, then let the timer go */
+static void lite_button_timer_serve(lite_button_ctx_t *ctx)
+{
+    unsigned int req = 0;
+
+    for (;;) {
+        req = atomic_exchange(&ctx->timer.lock, BTN_TMR_BUSY);
+        if (req & BTN_TMR_POLL) {
+            // the poll takes the triggered keys, a wake is served with it
+            lite_button_poll_run(ctx);
+        } else if (req & BTN_TMR_WAKE) {
+            lite_button_timer_wake(ctx);
+        } else {
+            req = BTN_TMR_BUSY;
+            if (atomic_compare_exchange_strong(&ctx->timer.lock, &req, 0U)) return;
+        }
+    }
+}
+
+/* leave req to the owner of the timer, or take it and serve req here */
+static void lite_button_timer_request(lite_button_ctx_t *ctx, unsigned int req)
+{
+    unsigned int cur = atomic_load(&ctx->timer.lock);
+
+    for (;;) {
+        if (cur & BTN_TMR_BUSY) {
+            if (atomic_compare_exchange_weak(&ctx->timer.lock, &cur, cur | req)) return;
+        } else if (atomic_compare_exchange_weak(&ctx->timer.lock, &cur, BTN_TMR_BUSY | req)) {
+            break;
+        }
+    }
+    lite_button_timer_serve(ctx);
+}
+
+/* move the keys triggered since the last poll into its own mask */
+static void lite_button_exti_take(lite_button_ctx_t *ctx)
+{
+    uint32_t keys = 0;
+    uint32_t any = 0;
+
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        keys = atomic_exchange(&ctx->exti_pend.w[w], 0U);
+        // an edge raced past the free of a key no walk reaches any more
+        if (w >= BTN_KEY_WORDS(ctx)) continue;
+        ctx->exti_mask.w[w] |= keys;
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+        ctx->exti_new.w[w] |= keys;
+#endif
+        any |= keys;
+    }
+    // the edges came after the previous poll, as the handler would stamp them
+    if (any != 0) {
+        ctx->timer.exti_tick = ctx->tmr_tick - 1;
+    }
+}
+#endif
+
+#if BTN_TICKLESS_FUN_ENABLE && BTN_TIMESTAMP_FUN_ENABLE && BTN_DEB_LOCKOUT_FUN_ENABLE
+/* ticks to the poll after an edge of key i, a lockout key about to press gets it at once */
+static btn_tick_t lite_button_exti_wait(const lite_button_ctx_t *ctx, key_id_e i)
+{
+    // a state read racing the poll only delays this poll to the usual time
+    if (ctx->dev_cfg[i].cfg.deb_mode == BTN_DEB_LOCKOUT && ctx->list[i].state != BTN_ACTIVE_LEVEL) {
+        return MIN(BTN_MS_TO_TICK(1), ctx->poll_ticks);
+    }
+    return ctx->poll_ticks;
+}
+#endif
+
+void lite_button_exti_trigger_ctx(lite_button_ctx_t *ctx, key_id_e i)
+{
+    btn_tick_t now = 0;
+
+    if (i >= BTN_NUM) return;
+#if BTN_POOL_FUN_ENABLE
+    // a slot not set up may lie past the words the poll walks
+    if (!ctx->list[i].used) return;
+#endif
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+    now = lite_button_now(ctx);
+#endif
+    lite_button_exti_mark(ctx, i, now);
+#if BTN_ATOMIC_FUN_ENABLE
+    // the poll stamps the edge when it takes the key
+    lite_button_timer_request(ctx, BTN_TMR_WAKE);
+#else
+#if BTN_TICKLESS_FUN_ENABLE && BTN_TIMESTAMP_FUN_ENABLE && BTN_DEB_LOCKOUT_FUN_ENABLE
+    lite_button_timer_arm(ctx, lite_button_exti_wait(ctx, i));
+#elif BTN_TICKLESS_FUN_ENABLE
+    lite_button_timer_arm(ctx, ctx->poll_ticks);
+#else
+    lite_button_timer_start(ctx, ctx->poll_period_ms);
+#endif
+#if BTN_TIMESTAMP_FUN_ENABLE
+    ctx->timer.exti_tick = now;
+#elif BTN_TICKLESS_FUN_ENABLE
+    // tick the next poll will run at, minus the one it advances itself
+    ctx->timer.exti_tick = ctx->timer.due - 1;
+#else
+    ctx->timer.exti_tick = ctx->tmr_tick;
+#endif
+#endif
+#if BTN_TRACE_FUN_ENABLE
+    if (ctx->trace.on) {
+        lite_button_trace_exti(ctx, i);
+    }
+#endif
+}
+
+void lite_button_exti_trigger(key_id_e i)
+{
+    lite_button_exti_trigger_ctx(&g_btn_ctx, i);
+}
+#endif
+
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+/* after a visit, park key i until an edge or its next timeout, or keep it polled */
+static void lite_button_tmo_park(lite_button_ctx_t *ctx, key_id_e i)
+{
+    btn_dev_t *btn = &ctx->list[i];
+    btn_tick_t due = BTN_TICK_MAX;
+
+    lite_button_tmo_cancel(&ctx->tmo, btn, i);
+    btn_mask_clr(&ctx->tmo_park, i);
+    // asleep, or debouncing one sample at a time
+    if (!btn_mask_test(&ctx->exti_mask, i) || btn->deb_cnt != 0) return;
+
+    if (btn->state == BTN_ACTIVE_LEVEL) {
+        // held until the release edge wakes it, or its long press comes
+#if BTN_LONGPRESS_FUN_ENABLE
+        if (btn->lp_on) {
+            due = ctx->tmr_tick + lite_button_lp_left(ctx, btn);
+        }
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+        if (btn->lock_on && (due == BTN_TICK_MAX || TICK_REACHED(due, btn->lock_tick + ctx->lock_thr))) {
+            due = btn->lock_tick + ctx->lock_thr;
+        }
+#endif
+    } else {
+        // end of the multi-click gap, the key leaves the EXTI mask then
+        due = ctx->timer.exti_tick + ctx->multi_gap_thr + 1;
+    }
+
+    btn_mask_set(&ctx->tmo_park, i);
+    if (due != BTN_TICK_MAX) {
+        lite_button_tmo_set(ctx, i, due);
+    }
+}
+#endif
+
+/* one pass of the state machine at ctx->tmr_tick */
+static void lite_button_poll_step(lite_button_ctx_t *ctx)
+{
+#if BTN_EXTI_FUN_ENABLE
+    btn_mask_t active;
+    uint32_t keys = 0;
+    size_t i = 0;
+#endif
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    btn_mask_t edges;
+    btn_mask_t due;
+#endif
+#if BTN_EVT_BATCH_FUN_ENABLE && !BTN_EVT_QUEUE_FUN_ENABLE
+    btn_evt_rec_t evts[BTN_EVT_BATCH_SIZE];
+
+    ctx->evt_batch = evts;
+    ctx->evt_batch_num = 0;
+#endif
+
+#if BTN_BATCH_FUN_ENABLE
+    lite_button_batch_update(ctx);
+#endif
+#if BTN_EXTI_FUN_ENABLE
+    // only visit keys woken up by EXTI, word by word
+#if BTN_ATOMIC_FUN_ENABLE
+    lite_button_exti_take(ctx);
+    active = ctx->exti_mask;
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    edges = ctx->exti_new;
+    memset(&ctx->exti_new, 0, sizeof(btn_mask_t));
+#endif
+#else
+    BTN_HW_INTERRUPT_DISABLE();
+    active = ctx->exti_mask;
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    edges = ctx->exti_new;
+    memset(&ctx->exti_new, 0, sizeof(btn_mask_t));
+#endif
+    BTN_HW_INTERRUPT_ENABLE();
+#endif
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    // parked keys only when an edge woke them or their timeout came
+    lite_button_tmo_turn(ctx, ctx->tmr_tick, &due);
+    for (size_t w = 0; w < BTN_KEY_WORDS(ctx); w++) {
+        active.w[w] &= ~ctx->tmo_park.w[w] | edges.w[w] | due.w[w];
+    }
+#endif
+    for (size_t w = 0; w < BTN_KEY_WORDS(ctx); w++) {
+        keys = active.w[w];
+        while (keys) {
+            i = w * BTN_MASK_WORD_BITS + BTN_CTZ(keys);
+            keys &= keys - 1;
+            lite_button_state_update(ctx, i);
+            lite_button_timer_stop_check(ctx, i);
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+            lite_button_tmo_park(ctx, i);
+#endif
+        }
+    }
+#if BTN_SEQ_FUN_ENABLE && !BTN_TIMESTAMP_FUN_ENABLE
+    lite_button_seq_expire(ctx);
+#endif
+#else
+    lite_button_poll_keys(ctx);
+#endif
+
+    // combo
+#if BTN_COMBO_FUN_ENABLE
+    lite_button_combo_handle(ctx);
+#endif
+
+#if BTN_EVT_BATCH_FUN_ENABLE && !BTN_EVT_QUEUE_FUN_ENABLE
+    lite_button_evt_batch_flush(ctx);
+    ctx->evt_batch = NULL;
+#endif
+}
+
+static void lite_button_poll_run(lite_button_ctx_t *ctx)
+{
+#if BTN_STATS_FUN_ENABLE
+    uint32_t t0 = 0;
+
+    // readers retry a copy taken while the sequence is odd or moved on
+    ctx->stats_seq++;
+    BTN_MEMORY_BARRIER();
+    t0 = lite_button_stats_clock(ctx);
+#endif
+#if BTN_TIMESTAMP_FUN_ENABLE
+    ctx->tmr_tick = lite_button_now(ctx);
+#elif BTN_TICKLESS_FUN_ENABLE
+    // one poll may stand for several ticks slept through
+    ctx->tmr_tick = ctx->timer.run_flag ? ctx->timer.due : (ctx->tmr_tick + 1);
+#else
+    ctx->tmr_tick++;
+#endif
+#if BTN_TRACE_FUN_ENABLE
+    if (ctx->trace.on) {
+        memset(&ctx->trace.lv, 0, sizeof(btn_mask_t));
+    }
+#endif
+
+    lite_button_poll_step(ctx);
+
+#if BTN_TRACE_FUN_ENABLE
+    if (ctx->trace.on) {
+        lite_button_trace_poll(ctx);
+    }
+#endif
+#if BTN_TICKLESS_FUN_ENABLE
+    lite_button_timer_rearm(ctx);
+#endif
+#if BTN_STATS_FUN_ENABLE
+    lite_button_stats_poll(ctx, lite_button_stats_clock(ctx) - t0);
+    BTN_MEMORY_BARRIER();
+    ctx->stats_seq++;
+#endif
+}
+
+void lite_button_poll_handle_ctx(lite_button_ctx_t *ctx)
+{
+#if BTN_ATOMIC_FUN_ENABLE
+    // an EXTI handler owning the timer runs this poll before it lets go
+    lite_button_timer_request(ctx, BTN_TMR_POLL);
+#else
+    lite_button_poll_run(ctx);
+#endif
+}
+
+void lite_button_poll_handle(void)
+{
+    lite_button_poll_handle_ctx(&g_btn_ctx);
+}
+
+#if BTN_COMBO_FUN_ENABLE
+void lite_button_register_combos_ctx(lite_button_ctx_t *ctx, key_combo_id_e id, const btn_combo_cfg_t *cfg,
+                                     btn_combo_cb_f cb, void *para)
+{
+    btn_combo_t *combo = NULL;
+    size_t n = 0;
+
+    if (id >= BTN_COMBO_NUM) return;
+    if (cfg->num < BTN_DOUBLE_KEY_CNT || cfg->num > BTN_COMBO_KEY_NUM) return;
+    for (size_t i = 0; i < cfg->num; i++) {
+        if (cfg->keys[i] >= BTN_NUM) return;
+    }
+
+    // drop a previous registration of this id from the index
+    for (n = 0; n < ctx->combo_num; n++) {
+        if (ctx->combo_index[n] == id) break;
+    }
+    if (n < ctx->combo_num) {
+        memmove(&ctx->combo_index[n], &ctx->combo_index[n + 1],
+                (ctx->combo_num - n - 1) * sizeof(ctx->combo_index[0]));
+        ctx->combo_num--;
+    }
+
+    combo = &ctx->combo_list[id];
+    combo->cb = cb;
+    combo->para = para;
+    memset(&combo->keys_mask, 0, sizeof(btn_mask_t));
+
+    memcpy(&combo->cfg, cfg, sizeof(btn_combo_cfg_t));
+    for (size_t i = 0; i < cfg->num; i++) {
+        btn_mask_set(&combo->keys_mask, cfg->keys[i]);
+    }
+    if (cb == NULL) return;
+
+    // insert after the entries with a lower mask, or the same mask and a lower id
+    for (n = lite_button_combo_lower_bound(ctx, &combo->keys_mask); n < ctx->combo_num; n++) {
+        if (!btn_mask_eq(&ctx->combo_list[ctx->combo_index[n]].keys_mask, &combo->keys_mask) ||
+            ctx->combo_index[n] > id) {
+            break;
+        }
+    }
+    memmove(&ctx->combo_index[n + 1], &ctx->combo_index[n],
+            (ctx->combo_num - n) * sizeof(ctx->combo_index[0]));
+    ctx->combo_index[n] = (uint16_t)id;
+    ctx->combo_num++;
+}
+
+void lite_button_register_combos(key_combo_id_e id, const btn_combo_cfg_t *cfg,
+                                 btn_combo_cb_f cb, void *para)
+{
+    lite_button_register_combos_ctx(&g_btn_ctx, id, cfg, cb, para);
+}
+
+#if BTN_POOL_FUN_ENABLE
+/* unregister combo id, its slot stays as it is */
+static void lite_button_combo_drop(lite_button_ctx_t *ctx, key_combo_id_e id)
+{
+    // register_combos copies the config in, hand it a copy
+    btn_combo_cfg_t cfg = ctx->combo_list[id].cfg;
+
+    if (ctx->combo_list[id].cb == NULL) return;
+    lite_button_register_combos_ctx(ctx, id, &cfg, NULL, NULL);
+}
+
+key_combo_id_e lite_button_combo_alloc_ctx(lite_button_ctx_t *ctx)
+{
+    for (size_t n = 0; n < BTN_COMBO_NUM; n++) {
+        if ((ctx->combo_pool[BTN_MASK_WORD(n)] & BTN_MASK_BIT(n)) || ctx->combo_list[n].cb != NULL) continue;
+        ctx->combo_pool[BTN_MASK_WORD(n)] |= BTN_MASK_BIT(n);
+        return (key_combo_id_e)n;
+    }
+
+    return BTN_COMBO_INVALID;
+}
+
+key_combo_id_e lite_button_combo_alloc(void)
+{
+    return lite_button_combo_alloc_ctx(&g_btn_ctx);
+}
+
+void lite_button_combo_free_ctx(lite_button_ctx_t *ctx, key_combo_id_e id)
+{
+    if (id >= BTN_COMBO_NUM) return;
+
+    lite_button_combo_drop(ctx, id);
+    ctx->combo_pool[BTN_MASK_WORD(id)] &= ~BTN_MASK_BIT(id);
+}
+
+void lite_button_combo_free(key_combo_id_e id)
+{
+    lite_button_combo_free_ctx(&g_btn_ctx, id);
+}
+#endif
+#endif
+
+#if BTN_SEQ_FUN_ENABLE
+static bool lite_button_seq_insert(btn_seq_fsm_t *fsm, key_seq_id_e id, const btn_seq_cfg_t *cfg)
+{
+    btn_seq_node_t n = 0;
+    size_t k = 0;
+    size_t fresh = 0;
+
+    // count the states this sequence adds before touching the trie
+    for (k = 0; k < cfg->num && fsm->next[n][cfg->keys[k]] != 0; k++) {
+        n = fsm->next[n][cfg->keys[k]];
+    }
+    fresh = cfg->num - k;
+    if (fsm->node_num + fresh > BTN_SEQ_NODE_MAX) return false;
+
+    for (; k < cfg->num; k++) {
+        fsm->out_id[fsm->node_num] = BTN_SEQ_NUM;
+        fsm->next[n][cfg->keys[k]] = (btn_seq_node_t)fsm->node_num;
+        n = (btn_seq_node_t)fsm->node_num++;
+    }
+    if (fsm->out_id[n] >= BTN_SEQ_NUM) {
+        fsm->out_id[n] = (uint16_t)id;
+    }
+
+    return true;
+}
+
+static void lite_button_seq_build(lite_button_ctx_t *ctx)
+{
+    btn_seq_fsm_t *fsm = &ctx->seq_fsm;
+    btn_seq_node_t fail[BTN_SEQ_NODE_MAX] = {0};
+    btn_seq_node_t queue[BTN_SEQ_NODE_MAX] = {0};
+    btn_seq_node_t u = 0;
+    btn_seq_node_t v = 0;
+    size_t head = 0;
+    size_t tail = 0;
+
+    memset(fsm, 0, sizeof(btn_seq_fsm_t));
+    fsm->node_num = 1;
+    fsm->out_id[0] = BTN_SEQ_NUM;
+
+    // trie of all registered sequences
+    for (size_t i = 0; i < BTN_SEQ_NUM; i++) {
+        if (ctx->seq_list[i].cb == NULL) continue;
+        if (!lite_button_seq_insert(fsm, (key_seq_id_e)i, &ctx->seq_list[i].cfg)) {
+            ctx->seq_list[i].cb = NULL;
+        }
+    }
+
+    // breadth first: failure links, output links, then missing transitions
+    for (size_t k = 0; k < BTN_NUM; k++) {
+        v = fsm->next[0][k];
+        if (v != 0) queue[tail++] = v;
+    }
+    while (head < tail) {
+        u = queue[head++];
+        for (size_t k = 0; k < BTN_NUM; k++) {
+            v = fsm->next[u][k];
+            if (v == 0) {
+                fsm->next[u][k] = fsm->next[fail[u]][k];
+                continue;
+            }
+            fail[v] = fsm->next[fail[u]][k];
+            fsm->out_link[v] = (fsm->out_id[fail[v]] < BTN_SEQ_NUM) ? fail[v] : fsm->out_link[fail[v]];
+            queue[tail++] = v;
+        }
+    }
+}
+#endif
+
+#if BTN_PORT_FUN_ENABLE
+static void lite_button_port_map_update(lite_button_ctx_t *ctx, btn_port_t *port)
+{
+    uint32_t keys = 0;
+    size_t k = 0;
+    int shift = 0;
+
+    port->pins_mask = 0;
+    port->linear = true;
+    port->shift = 0;
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        keys = port->keys_mask.w[w];
+        while (keys) {
+            k = w * BTN_MASK_WORD_BITS + BTN_CTZ(keys);
+            keys &= keys - 1;
+            shift = (int)k - (int)ctx->dev_cfg[k].pin;
+            if (port->pins_mask == 0) {
+                port->shift = (int16_t)shift;
+            } else if (port->shift != shift) {
+                port->linear = false;
+            }
+            port->pins_mask |= BIT(ctx->dev_cfg[k].pin);
+        }
+    }
+}
+#endif
+
+#if BTN_ADC_FUN_ENABLE
+static void lite_button_adc_map_update(lite_button_ctx_t *ctx, btn_adc_t *adc)
+{
+    uint32_t keys = 0;
+    size_t k = 0;
+
+    memset(adc->band_keys, 0, sizeof(adc->band_keys));
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        keys = adc->keys_mask.w[w];
+        while (keys) {
+            k = w * BTN_MASK_WORD_BITS + BTN_CTZ(keys);
+            keys &= keys - 1;
+            for (size_t b = 0; b < adc->band_num; b++) {
+                if (adc->band[b].pins & BIT(ctx->dev_cfg[k].pin)) {
+                    btn_mask_set(&adc->band_keys[b], k);
+                }
+            }
+        }
+    }
+}
+#endif
+
+#if BTN_BATCH_FUN_ENABLE
+static void lite_button_batch_detach(lite_button_ctx_t *ctx, key_id_e id)
+{
+    btn_mask_clr(&ctx->vc.keys_mask, id);
+    btn_mask_clr(&ctx->vc.state, id);
+    for (size_t k = 0; k < BTN_VC_BITS; k++) {
+        btn_mask_clr(&ctx->vc.cnt[k], id);
+    }
+#if BTN_PORT_FUN_ENABLE
+    for (size_t p = 0; p < BTN_PORT_NUM; p++) {
+        if (!btn_mask_test(&ctx->port_list[p].keys_mask, id)) continue;
+        btn_mask_clr(&ctx->port_list[p].keys_mask, id);
+        lite_button_port_map_update(ctx, &ctx->port_list[p]);
+    }
+#endif
+#if BTN_ADC_FUN_ENABLE
+    for (size_t a = 0; a < BTN_ADC_NUM; a++) {
+        if (!btn_mask_test(&ctx->adc_list[a].keys_mask, id)) continue;
+        btn_mask_clr(&ctx->adc_list[a].keys_mask, id);
+        lite_button_adc_map_update(ctx, &ctx->adc_list[a]);
+    }
+#endif
+#if BTN_MATRIX_FUN_ENABLE
+    for (size_t r = 0; r < BTN_MATRIX_ROWS; r++) {
+        for (size_t c = 0; c < BTN_MATRIX_COLS; c++) {
+            if (ctx->matrix.map[r][c] == id + 1) ctx->matrix.map[r][c] = 0;
+        }
+    }
+    btn_mask_clr(&ctx->matrix.keys_mask, id);
+#endif
+}
+#endif
+
+static btn_lp_tick_t lite_button_lp_thr(const lite_button_ctx_t *ctx, uint32_t ms)
+{
+#if BTN_COMPACT_FUN_ENABLE
+    // long press stamps are sized for BTN_LONGPRESS_MAX_MS
+    return (btn_lp_tick_t)MIN(lite_button_ms_to_tick(ctx, MIN(ms, BTN_LONGPRESS_MAX_MS)),
+                              (btn_tick_t)(STAMP_MAX(btn_lp_tick_t) >> 1));
+#else
+    return lite_button_ms_to_tick(ctx, ms);
+#endif
+}
+
+#if BTN_WHEEL_FUN_ENABLE
+static uint16_t lite_button_poll_div(const lite_button_ctx_t *ctx, uint32_t ms)
+{
+    uint32_t div = MAX(ms / ctx->poll_period_ms, 1U);
+
+#if BTN_COMPACT_FUN_ENABLE && !BTN_TIMESTAMP_FUN_ENABLE
+    // the multi-click window must still close within the narrow stamps
+    div = MIN(div, (uint32_t)((STAMP_MAX(btn_gap_tick_t) >> 1) - ctx->multi_gap_thr));
+#endif
+    return (uint16_t)MIN(div, UINT16_MAX);
+}
+#endif
+
+void lite_button_ctx_init(lite_button_ctx_t *ctx, uint32_t poll_period_ms)
+{
+    if (ctx == NULL) return;
+
+    memset(ctx, 0, sizeof(lite_button_ctx_t));
+    ctx->poll_period_ms = (poll_period_ms != 0) ? poll_period_ms : BTN_POLL_PERIOD_MS;
+    ctx->poll_ticks = lite_button_ms_to_tick(ctx, ctx->poll_period_ms);
+    ctx->deb_thr = lite_button_ms_to_tick(ctx, BTN_DEBOUNCE_MS);
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    ctx->deb_min = lite_button_ms_to_tick(ctx, BTN_DEBOUNCE_MIN_MS);
+    ctx->deb_max = lite_button_ms_to_tick(ctx, BTN_DEBOUNCE_MAX_MS);
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    ctx->lock_thr = lite_button_ms_to_tick(ctx, BTN_LOCKOUT_MS);
+#endif
+    ctx->multi_gap_thr = lite_button_ms_to_tick(ctx, BTN_MULTI_GAP_MS);
+    ctx->combo_gap_thr = lite_button_ms_to_tick(ctx, BTN_COMBO_GAP_MS);
+    ctx->seq_step_thr = lite_button_ms_to_tick(ctx, BTN_SEQ_STEP_MS);
+    // port and matrix keys count polls, up to what BTN_VC_BITS planes can hold
+    ctx->vc_target = (uint8_t)MIN(BTN_DEBOUNCE_MS / ctx->poll_period_ms + 1, BIT(BTN_VC_BITS) - 1);
+#if BTN_MATRIX_FUN_ENABLE
+    // one bounced image lasts a whole scan, the images kept must span the debounce time
+    ctx->vc_mx_target = (uint8_t)(MIN((BTN_DEBOUNCE_MS / ctx->poll_period_ms + BTN_MATRIX_SCAN_POLLS - 1) /
+                                      BTN_MATRIX_SCAN_POLLS + 1,
+                                      (BIT(BTN_VC_BITS) - 1) / BTN_MATRIX_SCAN_POLLS) * BTN_MATRIX_SCAN_POLLS);
+#endif
+#if BTN_COMPACT_FUN_ENABLE && !BTN_TIMESTAMP_FUN_ENABLE
+    // keep a shorter period within the narrow counters
+    ctx->deb_thr = MIN(ctx->deb_thr, (btn_tick_t)STAMP_MAX(btn_deb_cnt_t) - 1);
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    ctx->deb_max = MIN(ctx->deb_max, (btn_tick_t)STAMP_MAX(btn_deb_cnt_t) - 1);
+    ctx->deb_min = MIN(ctx->deb_min, ctx->deb_max);
+#endif
+    ctx->multi_gap_thr = MIN(ctx->multi_gap_thr, (btn_tick_t)(STAMP_MAX(btn_gap_tick_t) >> 1) - 1);
+#endif
+}
+
+#if BTN_POOL_FUN_ENABLE
+/* keep the list of keys set up sorted, and the mask words the walks need */
+static void lite_button_live_update(lite_button_ctx_t *ctx, key_id_e id)
+{
+    size_t n = 0;
+
+    while (n < ctx->key_live_num && ctx->key_live[n] < id) n++;
+    if (ctx->list[id].used) {
+        if (n == ctx->key_live_num || ctx->key_live[n] != id) {
+            memmove(&ctx->key_live[n + 1], &ctx->key_live[n], (ctx->key_live_num - n) * sizeof(ctx->key_live[0]));
+            ctx->key_live[n] = (uint16_t)id;
+            ctx->key_live_num++;
+        }
+    } else if (n < ctx->key_live_num && ctx->key_live[n] == id) {
+        ctx->key_live_num--;
+        memmove(&ctx->key_live[n], &ctx->key_live[n + 1], (ctx->key_live_num - n) * sizeof(ctx->key_live[0]));
+#if BTN_EXTI_FUN_ENABLE
+        // the poll may not walk this word any more to let the key go
+#if !BTN_ATOMIC_FUN_ENABLE
+        BTN_HW_INTERRUPT_DISABLE();
+#endif
+        btn_mask_clr(&ctx->exti_mask, id);
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+        btn_mask_clr(&ctx->exti_new, id);
+#endif
+#if !BTN_TICKLESS_FUN_ENABLE
+        // nor stop the timer for it, the key was the last one awake
+        if (btn_mask_is_zero(&ctx->exti_mask)
+#if BTN_SEQ_FUN_ENABLE && !BTN_TIMESTAMP_FUN_ENABLE
+            && ctx->seq_fsm.state == 0
+#endif
+            ) {
+            lite_button_timer_stop(ctx);
+        }
+#endif
+#if !BTN_ATOMIC_FUN_ENABLE
+        BTN_HW_INTERRUPT_ENABLE();
+#endif
+#endif
+    }
+    ctx->key_words = (ctx->key_live_num == 0) ? 0 :
+                     (uint16_t)(BTN_MASK_WORD(ctx->key_live[ctx->key_live_num - 1]) + 1);
+}
+#endif
+
+void lite_button_init_ctx(lite_button_ctx_t *ctx, key_id_e id, btn_gpio_lv_f gpio_cb,
+                          const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    if (id >= BTN_NUM) return;
+
+    ctx->gpio[id] = gpio_cb;
+    btn_mask_clr(&ctx->input_mask, id);
+    ctx->dev_cfg[id].cb = cb;
+    ctx->dev_cfg[id].cb_para = para;
+
+    ctx->dev_cfg[id].cfg.lp_thr = lite_button_lp_thr(ctx, cfg->longpress_ms);
+    ctx->dev_cfg[id].cfg.lp_rpt_thr = lite_button_lp_thr(ctx, cfg->longpress_repeat_ms);
+#if BTN_EVT_MASK_FUN_ENABLE
+    ctx->dev_cfg[id].cfg.evt_mask = (cfg->evt_mask != 0) ? cfg->evt_mask : BTN_EVT_MASK_ALL;
+    // a zero threshold never starts the long press countdown
+    if ((ctx->dev_cfg[id].cfg.evt_mask & BTN_EVT_BIT(BTN_EVT_LONG)) == 0) {
+        ctx->dev_cfg[id].cfg.lp_thr = 0;
+        ctx->dev_cfg[id].cfg.lp_rpt_thr = 0;
+    }
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    ctx->dev_cfg[id].cfg.deb_mode = cfg->deb_mode;
+#endif
+#if BTN_WHEEL_FUN_ENABLE
+    ctx->dev_cfg[id].cfg.poll_div = lite_button_poll_div(ctx, cfg->poll_ms);
+#endif
+
+    ctx->list[id].used = (cb != NULL);
+    ctx->list[id].state = BTN_IDLE_LEVEL;
+    ctx->list[id].deb_cnt = 0;
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    // every key starts from the configured window
+    ctx->list[id].deb_thr = (btn_deb_thr_t)MIN(MAX(ctx->deb_thr, ctx->deb_min), ctx->deb_max);
+    ctx->list[id].deb_clean = 0;
+    ctx->list[id].bnc_on = false;
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    ctx->list[id].lock_on = false;
+#endif
+    ctx->list[id].lp_tick = 0;
+    ctx->list[id].lp_on = false;
+    ctx->list[id].click_cnt = 0;
+#if BTN_MULTICLICK_FUN_ENABLE
+    ctx->list[id].mc_on = false;
+#endif
+#if !BTN_EXTI_FUN_ENABLE
+    btn_mask_clr(&ctx->active_mask, id);
+    if (gpio_cb != NULL && cb != NULL) {
+        btn_mask_set(&ctx->gpio_mask, id);
+    } else {
+        btn_mask_clr(&ctx->gpio_mask, id);
+    }
+#if BTN_WHEEL_FUN_ENABLE
+    lite_button_wheel_sched(ctx, id);
+#endif
+#endif
+#if BTN_TIMESTAMP_FUN_ENABLE
+    ctx->list[id].edge_on = false;
+#endif
+#if BTN_TIMEOUT_WHEEL_FUN_ENABLE
+    lite_button_tmo_cancel(&ctx->tmo, &ctx->list[id], id);
+    btn_mask_clr(&ctx->tmo_park, id);
+#endif
+#if BTN_BATCH_FUN_ENABLE
+    lite_button_batch_detach(ctx, id);
+#endif
+#if BTN_POOL_FUN_ENABLE
+    lite_button_live_update(ctx, id);
+#endif
+}
+
+void lite_button_init(key_id_e id, btn_gpio_lv_f gpio_cb,
+                      const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    lite_button_init_ctx(&g_btn_ctx, id, gpio_cb, cfg, cb, para);
+}
+
+void lite_button_init_input_ctx(lite_button_ctx_t *ctx, key_id_e id,
+                                const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    if (id >= BTN_NUM) return;
+
+    lite_button_init_ctx(ctx, id, NULL, cfg, cb, para);
+    btn_mask_set(&ctx->input_mask, id);
+#if BTN_ATOMIC_FUN_ENABLE
+    btn_atomic_mask_clr(&ctx->input_lv, id);
+#else
+    btn_mask_clr(&ctx->input_lv, id);
+#endif
+#if !BTN_EXTI_FUN_ENABLE
+    if (cb != NULL) btn_mask_set(&ctx->gpio_mask, id);
+#if BTN_WHEEL_FUN_ENABLE
+    lite_button_wheel_sched(ctx, id);
+#endif
+#endif
+}
+
+void lite_button_init_input(key_id_e id, const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    lite_button_init_input_ctx(&g_btn_ctx, id, cfg, cb, para);
+}
+
+void lite_button_input_set_ctx(lite_button_ctx_t *ctx, key_id_e id, btn_level_e lv)
+{
+    if (id >= BTN_NUM || !btn_mask_test(&ctx->input_mask, id)) return;
+#if BTN_ATOMIC_FUN_ENABLE
+    if (btn_atomic_mask_test(&ctx->input_lv, id) == (lv == BTN_ACTIVE_LEVEL)) return;
+
+    if (lv == BTN_ACTIVE_LEVEL) {
+        btn_atomic_mask_set(&ctx->input_lv, id);
+    } else {
+        btn_atomic_mask_clr(&ctx->input_lv, id);
+    }
+#else
+    if (btn_mask_test(&ctx->input_lv, id) == (lv == BTN_ACTIVE_LEVEL)) return;
+
+    BTN_HW_INTERRUPT_DISABLE();
+    if (lv == BTN_ACTIVE_LEVEL) {
+        btn_mask_set(&ctx->input_lv, id);
+    } else {
+        btn_mask_clr(&ctx->input_lv, id);
+    }
+    BTN_HW_INTERRUPT_ENABLE();
+#endif
+#if BTN_EXTI_FUN_ENABLE
+    // a pushed change is an edge
+    lite_button_exti_trigger_ctx(ctx, id);
+#endif
+}
+
+void lite_button_input_set(key_id_e id, btn_level_e lv)
+{
+    lite_button_input_set_ctx(&g_btn_ctx, id, lv);
+}
+
+#if BTN_DEB_ADAPT_FUN_ENABLE
+uint32_t lite_button_debounce_get_ctx(const lite_button_ctx_t *ctx, key_id_e id)
+{
+    if (id >= BTN_NUM) return 0;
+#if BTN_TIMESTAMP_FUN_ENABLE
+    return (uint32_t)BTN_TICK_TO_MS(ctx->list[id].deb_thr);
+#else
+    return (uint32_t)ctx->list[id].deb_thr * ctx->poll_period_ms;
+#endif
+}
+
+uint32_t lite_button_debounce_get(key_id_e id)
+{
+    return lite_button_debounce_get_ctx(&g_btn_ctx, id);
+}
+#endif
+
+#if BTN_SEQ_FUN_ENABLE
+void lite_button_register_seq_ctx(lite_button_ctx_t *ctx, key_seq_id_e id, const btn_seq_cfg_t *cfg,
+                                  btn_seq_cb_f cb, void *para)
+{
+    if (id >= BTN_SEQ_NUM) return;
+    if (cb != NULL) {
+        if (cfg == NULL || cfg->num == 0 || cfg->num > BTN_SEQ_KEY_MAX) return;
+        for (size_t k = 0; k < cfg->num; k++) {
+            if (cfg->keys[k] >= BTN_NUM) return;
+        }
+        memcpy(&ctx->seq_list[id].cfg, cfg, sizeof(btn_seq_cfg_t));
+    }
+
+    ctx->seq_list[id].cb = cb;
+    ctx->seq_list[id].para = para;
+    lite_button_seq_build(ctx);
+}
+
+void lite_button_register_seq(key_seq_id_e id, const btn_seq_cfg_t *cfg,
+                              btn_seq_cb_f cb, void *para)
+{
+    lite_button_register_seq_ctx(&g_btn_ctx, id, cfg, cb, para);
+}
+#endif
+
+#if BTN_POOL_FUN_ENABLE
+key_id_e lite_button_key_alloc_ctx(lite_button_ctx_t *ctx)
+{
+    // lowest free slot first, the keys in use stay packed
+    for (size_t i = 0; i < BTN_NUM; i++) {
+        if (btn_mask_test(&ctx->pool_mask, i) || ctx->list[i].used) continue;
+        btn_mask_set(&ctx->pool_mask, i);
+        return (key_id_e)i;
+    }
+
+    return BTN_KEY_INVALID;
+}
+
+key_id_e lite_button_key_alloc(void)
+{
+    return lite_button_key_alloc_ctx(&g_btn_ctx);
+}
+
+void lite_button_key_free_ctx(lite_button_ctx_t *ctx, key_id_e id)
+{
+    static const btn_cfg_t cfg = {0};
+
+    if (id >= BTN_NUM) return;
+
+    // a key taking the slot later must not complete them
+#if BTN_COMBO_FUN_ENABLE
+    for (size_t n = 0; n < BTN_COMBO_NUM; n++) {
+        if (ctx->combo_list[n].cb != NULL && btn_mask_test(&ctx->combo_list[n].keys_mask, id)) {
+            lite_button_combo_drop(ctx, (key_combo_id_e)n);
+        }
+    }
+#endif
+#if BTN_SEQ_FUN_ENABLE
+    for (size_t n = 0; n < BTN_SEQ_NUM; n++) {
+        if (ctx->seq_list[n].cb == NULL) continue;
+        for (size_t k = 0; k < ctx->seq_list[n].cfg.num; k++) {
+            if (ctx->seq_list[n].cfg.keys[k] != id) continue;
+            lite_button_register_seq_ctx(ctx, (key_seq_id_e)n, NULL, NULL, NULL);
+            break;
+        }
+    }
+#endif
+
+    lite_button_init_ctx(ctx, id, NULL, &cfg, NULL, NULL);
+    btn_mask_clr(&ctx->press_mask, id);
+#if BTN_COMBO_FUN_ENABLE
+    ctx->press_dirty = true;
+#endif
+    btn_mask_clr(&ctx->pool_mask, id);
+}
+
+void lite_button_key_free(key_id_e id)
+{
+    lite_button_key_free_ctx(&g_btn_ctx, id);
+}
+#endif
+
+#if BTN_PORT_FUN_ENABLE
+void lite_button_register_port_ctx(lite_button_ctx_t *ctx, uint8_t port, btn_port_lv_f port_cb)
+{
+    if (port >= BTN_PORT_NUM) return;
+
+    ctx->port_list[port].port_cb = port_cb;
+}
+
+void lite_button_register_port(uint8_t port, btn_port_lv_f port_cb)
+{
+    lite_button_register_port_ctx(&g_btn_ctx, port, port_cb);
+}
+
+void lite_button_init_port_ctx(lite_button_ctx_t *ctx, key_id_e id, uint8_t port, uint8_t pin,
+                               const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    if (id >= BTN_NUM || port >= BTN_PORT_NUM || pin >= 32) return;
+
+    lite_button_init_ctx(ctx, id, NULL, cfg, cb, para);
+    ctx->dev_cfg[id].port = port;
+    ctx->dev_cfg[id].pin = pin;
+
+    btn_mask_set(&ctx->port_list[port].keys_mask, id);
+    lite_button_port_map_update(ctx, &ctx->port_list[port]);
+    btn_mask_set(&ctx->vc.keys_mask, id);
+}
+
+void lite_button_init_port(key_id_e id, uint8_t port, uint8_t pin,
+                           const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    lite_button_init_port_ctx(&g_btn_ctx, id, port, pin, cfg, cb, para);
+}
+#endif
+
+#if BTN_ADC_FUN_ENABLE
+void lite_button_register_adc_ctx(lite_button_ctx_t *ctx, uint8_t adc, btn_adc_read_f read_cb,
+                                  const btn_adc_band_t *band, size_t num)
+{
+    btn_adc_t *lad = NULL;
+
+    if (adc >= BTN_ADC_NUM || band == NULL || num == 0 || num > BTN_ADC_BAND_MAX) return;
+    // the lookup needs the bands in order
+    for (size_t b = 1; b < num; b++) {
+        if (band[b].max <= band[b - 1].max) return;
+    }
+
+    lad = &ctx->adc_list[adc];
+    lad->read_cb = read_cb;
+    lad->band = band;
+    lad->band_num = (uint8_t)num;
+    // nothing pressed until the first reading says otherwise
+    lad->cur = (uint8_t)num;
+    lite_button_adc_map_update(ctx, lad);
+}
+
+void lite_button_register_adc(uint8_t adc, btn_adc_read_f read_cb,
+                              const btn_adc_band_t *band, size_t num)
+{
+    lite_button_register_adc_ctx(&g_btn_ctx, adc, read_cb, band, num);
+}
+
+void lite_button_init_adc_ctx(lite_button_ctx_t *ctx, key_id_e id, uint8_t adc, uint8_t pin,
+                              const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    if (id >= BTN_NUM || adc >= BTN_ADC_NUM || pin >= 32) return;
+
+    lite_button_init_ctx(ctx, id, NULL, cfg, cb, para);
+    ctx->dev_cfg[id].port = adc;
+    ctx->dev_cfg[id].pin = pin;
+
+    btn_mask_set(&ctx->adc_list[adc].keys_mask, id);
+    lite_button_adc_map_update(ctx, &ctx->adc_list[adc]);
+    btn_mask_set(&ctx->vc.keys_mask, id);
+}
+
+void lite_button_init_adc(key_id_e id, uint8_t adc, uint8_t pin,
+                          const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    lite_button_init_adc_ctx(&g_btn_ctx, id, adc, pin, cfg, cb, para);
+}
+#endif
+
+#if BTN_MATRIX_FUN_ENABLE
+void lite_button_register_matrix_ctx(lite_button_ctx_t *ctx, const btn_matrix_cb_t *cb)
+{
+    if (cb == NULL) return;
+
+    ctx->matrix.cb = *cb;
+    ctx->matrix.next_row = 0;
+}
+
+void lite_button_register_matrix(const btn_matrix_cb_t *cb)
+{
+    lite_button_register_matrix_ctx(&g_btn_ctx, cb);
+}
+
+void lite_button_init_matrix_ctx(lite_button_ctx_t *ctx, key_id_e id, uint8_t row, uint8_t col,
+                                 const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    if (id >= BTN_NUM || row >= BTN_MATRIX_ROWS || col >= BTN_MATRIX_COLS) return;
+
+    lite_button_init_ctx(ctx, id, NULL, cfg, cb, para);
+    ctx->matrix.map[row][col] = (uint16_t)(id + 1);
+    btn_mask_set(&ctx->matrix.keys_mask, id);
+    btn_mask_set(&ctx->vc.keys_mask, id);
+}
+
+void lite_button_init_matrix(key_id_e id, uint8_t row, uint8_t col,
+                             const btn_cfg_t *cfg, btn_cb_f cb, void *para)
+{
+    lite_button_init_matrix_ctx(&g_btn_ctx, id, row, col, cfg, cb, para);
+}
+
+bool lite_button_matrix_ghost_get_ctx(const lite_button_ctx_t *ctx)
+{
+    return ctx->matrix.ghost;
+}
+
+bool lite_button_matrix_ghost_get(void)
+{
+    return lite_button_matrix_ghost_get_ctx(&g_btn_ctx);
+}
+#endif
+
+#if BTN_EVT_QUEUE_FUN_ENABLE
+#if BTN_EVT_BATCH_FUN_ENABLE
+/* hand the queue over BTN_EVT_BATCH_SIZE records at a time */
+static size_t lite_button_evt_batch_dispatch(lite_button_ctx_t *ctx)
+{
+    btn_evt_queue_t *q = &ctx->evt_queue;
+    btn_evt_rec_t evts[BTN_EVT_BATCH_SIZE];
+    uint32_t tail = q->tail;
+    size_t num = 0;
+    size_t n = 0;
+
+    while (tail != q->head) {
+        for (num = 0; num < BTN_EVT_BATCH_SIZE && tail != q->head; num++) {
+            BTN_MEMORY_BARRIER();
+            evts[num] = q->buf[tail & (BTN_EVT_QUEUE_SIZE - 1)];
+            BTN_MEMORY_BARRIER();
+            q->tail = ++tail;
+        }
+        lite_button_evt_batch_deliver(ctx, evts, num);
+        n += num;
+    }
+
+    return n;
+}
+#endif
+
+size_t lite_button_dispatch_ctx(lite_button_ctx_t *ctx)
+{
+    btn_evt_queue_t *q = &ctx->evt_queue;
+    btn_evt_rec_t rec;
+    uint32_t tail = q->tail;
+    size_t n = 0;
+
+#if BTN_EVT_BATCH_FUN_ENABLE
+    if (ctx->evt_batch_cb != NULL) {
+        return lite_button_evt_batch_dispatch(ctx);
+    }
+#endif
+    while (tail != q->head) {
+        // read the record only after observing the head that published it
+        BTN_MEMORY_BARRIER();
+        rec = q->buf[tail & (BTN_EVT_QUEUE_SIZE - 1)];
+        BTN_MEMORY_BARRIER();
+        q->tail = ++tail;
+        n++;
+
+#if BTN_COMBO_FUN_ENABLE
+        if (rec.evt == BTN_EVT_COMBO) {
+            if (rec.id < BTN_COMBO_NUM && ctx->combo_list[rec.id].cb != NULL) {
+                ctx->combo_list[rec.id].cb((key_combo_id_e)rec.id, ctx->combo_list[rec.id].para);
+            }
+            continue;
+        }
+#endif
+#if BTN_SEQ_FUN_ENABLE
+        if (rec.evt == BTN_EVT_SEQUENCE) {
+            if (rec.id < BTN_SEQ_NUM && ctx->seq_list[rec.id].cb != NULL) {
+                ctx->seq_list[rec.id].cb((key_seq_id_e)rec.id, ctx->seq_list[rec.id].para);
+            }
+            continue;
+        }
+#endif
+        if (rec.id < BTN_NUM && ctx->dev_cfg[rec.id].cb != NULL) {
+#if BTN_STATS_FUN_ENABLE
+            lite_button_stats_cb(ctx, (key_id_e)rec.id, (btn_evt_e)rec.evt);
+#else
+            ctx->dev_cfg[rec.id].cb((btn_evt_e)rec.evt, ctx->dev_cfg[rec.id].cb_para);
+#endif
+        }
+    }
+
+    return n;
+}
+
+size_t lite_button_dispatch(void)
+{
+    return lite_button_dispatch_ctx(&g_btn_ctx);
+}
+
+uint32_t lite_button_evt_overflow_get_ctx(const lite_button_ctx_t *ctx)
+{
+    return ctx->evt_queue.overflow;
+}
+
+uint32_t lite_button_evt_overflow_get(void)
+{
+    return lite_button_evt_overflow_get_ctx(&g_btn_ctx);
+}
+#endif
+
+#if BTN_EVT_BATCH_FUN_ENABLE
+void lite_button_register_evt_batch_ctx(lite_button_ctx_t *ctx, btn_evt_batch_cb_f cb, void *para)
+{
+    ctx->evt_batch_cb = cb;
+    ctx->evt_batch_para = para;
+}
+
+void lite_button_register_evt_batch(btn_evt_batch_cb_f cb, void *para)
+{
+    lite_button_register_evt_batch_ctx(&g_btn_ctx, cb, para);
+}
+#endif
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+void lite_button_register_clock_ctx(lite_button_ctx_t *ctx, btn_clock_us_f clock)
+{
+    ctx->clock = clock;
+}
+
+void lite_button_register_clock(btn_clock_us_f clock)
+{
+    lite_button_register_clock_ctx(&g_btn_ctx, clock);
+}
+#endif
+
+#if BTN_TRACE_FUN_ENABLE
+void lite_button_trace_start_ctx(lite_button_ctx_t *ctx)
+{
+    btn_trace_t *tr = &ctx->trace;
+
+    BTN_HW_INTERRUPT_DISABLE();
+    tr->head = 0;
+    tr->tail = 0;
+    tr->last = 0;
+    memset(&tr->base, 0, sizeof(btn_trace_pos_t));
+    tr->base.tick = ctx->tmr_tick;
+    tr->cur = tr->base;
+    tr->dropped = 0;
+    tr->on = true;
+    BTN_HW_INTERRUPT_ENABLE();
+}
+
+void lite_button_trace_start(void)
+{
+    lite_button_trace_start_ctx(&g_btn_ctx);
+}
+
+void lite_button_trace_stop_ctx(lite_button_ctx_t *ctx)
+{
+    ctx->trace.on = false;
+}
+
+void lite_button_trace_stop(void)
+{
+    lite_button_trace_stop_ctx(&g_btn_ctx);
+}
+
+size_t lite_button_trace_read_ctx(const lite_button_ctx_t *ctx, uint8_t *out, size_t size)
+{
+    const btn_trace_t *tr = &ctx->trace;
+    uint8_t hdr[BTN_TRACE_BLOB_MAX - BTN_TRACE_BUF_SIZE];
+    size_t n = 0;
+
+    // version, then the decoder state the first record starts from
+    hdr[n++] = BTN_TRACE_VERSION;
+    n += lite_button_varint_put(&hdr[n], tr->base.tick);
+    n += lite_button_varint_put(&hdr[n], tr->base.delta);
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        n += lite_button_varint_put(&hdr[n], tr->base.lv.w[w]);
+    }
+    if (out == NULL || size < n + (tr->head - tr->tail)) return 0;
+
+    memcpy(out, hdr, n);
+    for (size_t k = tr->tail; k != tr->head; k++) {
+        out[n++] = tr->buf[k & (BTN_TRACE_BUF_SIZE - 1)];
+    }
+
+    return n;
+}
+
+size_t lite_button_trace_read(uint8_t *out, size_t size)
+{
+    return lite_button_trace_read_ctx(&g_btn_ctx, out, size);
+}
+
+uint32_t lite_button_trace_dropped_get_ctx(const lite_button_ctx_t *ctx)
+{
+    return ctx->trace.dropped;
+}
+
+uint32_t lite_button_trace_dropped_get(void)
+{
+    return lite_button_trace_dropped_get_ctx(&g_btn_ctx);
+}
+
+bool lite_button_replay_ctx(lite_button_ctx_t *ctx, const uint8_t *trace, size_t len)
+{
+    btn_trace_pos_t pos;
+    btn_trace_rec_t rec;
+    size_t pos_len = 0;
+    size_t off = 1;
+    size_t v = 0;
+
+    if (trace == NULL || len == 0 || trace[0] != BTN_TRACE_VERSION) return false;
+
+    memset(&pos, 0, sizeof(btn_trace_pos_t));
+    if ((pos_len = lite_button_varint_get(trace, SIZE_MAX, off, len, &v)) == 0) return false;
+    off += pos_len;
+    pos.tick = (btn_tick_t)v;
+    if ((pos_len = lite_button_varint_get(trace, SIZE_MAX, off, len, &v)) == 0) return false;
+    off += pos_len;
+    pos.delta = (btn_tick_t)v;
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        if ((pos_len = lite_button_varint_get(trace, SIZE_MAX, off, len, &v)) == 0) return false;
+        off += pos_len;
+        pos.lv.w[w] = (uint32_t)v;
+    }
+
+    ctx->trace.on = false;
+    ctx->trace.replay = true;
+    ctx->tmr_tick = pos.tick;
+    while (off < len) {
+        pos_len = lite_button_trace_decode(trace, SIZE_MAX, off, len, &rec);
+        if (pos_len == 0) break;
+        off += pos_len;
+
+        if (rec.type == BTN_TRACE_EXTI) {
+#if BTN_EXTI_FUN_ENABLE
+            if (rec.arg >= BTN_NUM) continue;
+            // undo the zigzag, odd offsets lie before the last poll
+            ctx->timer.exti_tick = (rec.val & 1U) ? (pos.tick - (btn_tick_t)((rec.val + 1) >> 1)) :
+                                                    (pos.tick + (btn_tick_t)(rec.val >> 1));
+            lite_button_exti_mark(ctx, (key_id_e)rec.arg, ctx->timer.exti_tick);
+#endif
+            continue;
+        }
+
+        // a repeat stands for several polls with the same sample
+        if (rec.type == BTN_TRACE_POLL) {
+            lite_button_trace_apply(&pos, &rec);
+            rec.arg = 1;
+        } else {
+            pos.tick += pos.delta * rec.arg;
+        }
+        for (size_t k = rec.arg; k > 0; k--) {
+            ctx->tmr_tick = pos.tick - pos.delta * (k - 1);
+            ctx->trace.lv = pos.lv;
+            lite_button_poll_step(ctx);
+        }
+    }
+    ctx->trace.replay = false;
+
+    return off == len;
+}
+
+bool lite_button_replay(const uint8_t *trace, size_t len)
+{
+    return lite_button_replay_ctx(&g_btn_ctx, trace, len);
+}
+#endif
+
+#if BTN_SNAPSHOT_FUN_ENABLE
+static uint32_t lite_button_snap_mix(uint32_t h, uint32_t v)
+{
+    // FNV-1a, a byte at a time
+    for (size_t k = 0; k < 4; k++) {
+        h = (h ^ ((v >> (k * 8)) & 0xFF)) * 16777619U;
+    }
+    return h;
+}
+
+/* checksum of the key, combo and sequence setup a snapshot belongs to */
+static uint16_t lite_button_snap_sum(const lite_button_ctx_t *ctx)
+{
+    const btn_inner_cfg_t *cfg = NULL;
+    uint32_t h = 2166136261U;
+
+    h = lite_button_snap_mix(h, BTN_NUM);
+    h = lite_button_snap_mix(h, ctx->poll_period_ms);
+    for (size_t i = 0; i < BTN_NUM; i++) {
+        cfg = &ctx->dev_cfg[i].cfg;
+        h = lite_button_snap_mix(h, ctx->list[i].used);
+        h = lite_button_snap_mix(h, (uint32_t)cfg->lp_thr);
+        h = lite_button_snap_mix(h, (uint32_t)cfg->lp_rpt_thr);
+#if BTN_EVT_MASK_FUN_ENABLE
+        h = lite_button_snap_mix(h, cfg->evt_mask);
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+        h = lite_button_snap_mix(h, cfg->deb_mode);
+#endif
+#if BTN_WHEEL_FUN_ENABLE
+        h = lite_button_snap_mix(h, cfg->poll_div);
+#endif
+    }
+#if BTN_COMBO_FUN_ENABLE
+    for (size_t n = 0; n < BTN_COMBO_NUM; n++) {
+        const btn_combo_cfg_t *combo = &ctx->combo_list[n].cfg;
+
+        h = lite_button_snap_mix(h, (uint32_t)combo->num);
+        h = lite_button_snap_mix(h, (uint32_t)combo->type);
+        for (size_t k = 0; k < (size_t)combo->num && k < BTN_COMBO_KEY_NUM; k++) {
+            h = lite_button_snap_mix(h, (uint32_t)combo->keys[k]);
+        }
+    }
+#endif
+#if BTN_SEQ_FUN_ENABLE
+    for (size_t n = 0; n < BTN_SEQ_NUM; n++) {
+        const btn_seq_cfg_t *seq = &ctx->seq_list[n].cfg;
+
+        h = lite_button_snap_mix(h, seq->num);
+        for (size_t k = 0; k < seq->num && k < BTN_SEQ_KEY_MAX; k++) {
+            h = lite_button_snap_mix(h, (uint32_t)seq->keys[k]);
+        }
+    }
+#endif
+
+    return (uint16_t)(h ^ (h >> 16));
+}
+
+/* flag byte of key i, 0 for a key at rest */
+static uint8_t lite_button_snap_flags(const lite_button_ctx_t *ctx, key_id_e i)
+{
+    const btn_dev_t *btn = &ctx->list[i];
+    uint8_t flags = 0;
+
+    if (!btn->used) return 0;
+    if (btn->state == BTN_ACTIVE_LEVEL) {
+        flags |= BTN_SNAP_ACTIVE;
+        if (btn->lp_on) flags |= BTN_SNAP_LP;
+    }
+    if (btn_mask_test(&ctx->press_mask, i)) flags |= BTN_SNAP_PRESS;
+#if BTN_MULTICLICK_FUN_ENABLE
+    if (btn->mc_on) {
+        flags |= (uint8_t)(BTN_SNAP_MC | (btn->click_cnt << BTN_SNAP_CLICK_SHIFT));
+    }
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    if (btn->lock_on) flags |= BTN_SNAP_LOCK;
+#endif
+
+    return flags;
+}
+
+#if BTN_DEB_ADAPT_FUN_ENABLE
+/* the window a key starts from, learned ones differ */
+static btn_deb_thr_t lite_button_snap_deb_start(const lite_button_ctx_t *ctx)
+{
+    return (btn_deb_thr_t)MIN(MAX(ctx->deb_thr, ctx->deb_min), ctx->deb_max);
+}
+#endif
+
+/* record of key i: flag byte, then stamps relative to now */
+static size_t lite_button_snap_key(const lite_button_ctx_t *ctx, key_id_e i, uint8_t flags,
+                                   btn_tick_t now, uint8_t *p)
+{
+    const btn_dev_t *btn = &ctx->list[i];
+    btn_lp_tick_t left = 0;
+    size_t n = 0;
+
+    p[n++] = flags;
+#if BTN_COMBO_FUN_ENABLE
+    if (flags & BTN_SNAP_ACTIVE) {
+        n += lite_button_varint_put(&p[n], now - btn->prs_tick);
+    }
+#endif
+    if (flags & BTN_SNAP_LP) {
+        left = STAMP_SINCE(btn_lp_tick_t, btn->lp_tick, now);
+        n += lite_button_varint_put(&p[n], (left > (STAMP_MAX(btn_lp_tick_t) >> 1)) ? 0 : left);
+    }
+#if BTN_MULTICLICK_FUN_ENABLE
+    if (flags & BTN_SNAP_MC) {
+        n += lite_button_varint_put(&p[n], STAMP_SINCE(btn_gap_tick_t, now, btn->rel_tick));
+    }
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+    if (flags & BTN_SNAP_LOCK) {
+        n += lite_button_varint_put(&p[n], now - btn->lock_tick);
+    }
+#endif
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    n += lite_button_varint_put(&p[n], btn->deb_thr);
+#endif
+
+    return n;
+}
+
+/* keep key i polled until it settles again */
+static void lite_button_snap_poll(lite_button_ctx_t *ctx, key_id_e i)
+{
+#if BTN_EXTI_FUN_ENABLE
+    lite_button_exti_trigger_ctx(ctx, i);
+#else
+    btn_mask_set(&ctx->active_mask, i);
+#endif
+}
+
+/* next varint of a snapshot, false once it runs out */
+static bool lite_button_snap_get(const uint8_t *snap, size_t len, size_t *off, size_t *v)
+{
+    size_t k = lite_button_varint_get(snap, SIZE_MAX, *off, len, v);
+
+    *off += k;
+    return k != 0;
+}
+
+/*
+ * Decode the keys and sequence state of a snapshot, into ctx when apply is
+ * set. now: the time restored at, slept: ticks since the snapshot.
+ */
+static bool lite_button_snap_load(lite_button_ctx_t *ctx, const uint8_t *snap, size_t len,
+                                  btn_tick_t now, btn_tick_t slept, bool apply)
+{
+    btn_tick_t base = now - slept;
+    btn_mask_t keys;
+    btn_dev_t *btn = NULL;
+    uint32_t bits = 0;
+    uint8_t flags = 0;
+    size_t off = 3;
+    size_t v = 0;
+    size_t i = 0;
+
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        if (!lite_button_snap_get(snap, len, &off, &v)) return false;
+        keys.w[w] = (uint32_t)v;
+    }
+
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        bits = keys.w[w];
+        while (bits) {
+            i = w * BTN_MASK_WORD_BITS + BTN_CTZ(bits);
+            bits &= bits - 1;
+            if (i >= BTN_NUM || off >= len) return false;
+            flags = snap[off++];
+            btn = &ctx->list[i];
+            if (apply) {
+                btn->state = (flags & BTN_SNAP_ACTIVE) ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL;
+                btn->deb_cnt = 0;
+                btn->lp_on = ((flags & BTN_SNAP_LP) != 0);
+                if (flags & BTN_SNAP_PRESS) {
+                    btn_mask_set(&ctx->press_mask, i);
+                } else {
+                    btn_mask_clr(&ctx->press_mask, i);
+                }
+#if BTN_BATCH_FUN_ENABLE
+                // the vertical counters hold the debounced level too
+                if (btn_mask_test(&ctx->vc.keys_mask, i) && (flags & BTN_SNAP_ACTIVE)) {
+                    btn_mask_set(&ctx->vc.state, i);
+                }
+#endif
+            }
+
+#if BTN_COMBO_FUN_ENABLE
+            if (flags & BTN_SNAP_ACTIVE) {
+                if (!lite_button_snap_get(snap, len, &off, &v)) return false;
+                if (apply) btn->prs_tick = base - (btn_tick_t)v;
+            }
+#endif
+            if (flags & BTN_SNAP_LP) {
+                if (!lite_button_snap_get(snap, len, &off, &v)) return false;
+                // slept through, the next poll reports it once
+                if (apply) btn->lp_tick = (btn_lp_tick_t)((slept >= v) ? now : (base + (btn_tick_t)v));
+            }
+#if BTN_MULTICLICK_FUN_ENABLE
+            if (flags & BTN_SNAP_MC) {
+                if (!lite_button_snap_get(snap, len, &off, &v)) return false;
+                if (apply) {
+                    // a window that ran out meanwhile is closed before its stamp wraps
+                    btn->rel_tick = (btn_gap_tick_t)(base - (btn_tick_t)v);
+                    btn->mc_on = ((btn_tick_t)v + slept <= ctx->multi_gap_thr);
+                    btn->click_cnt = btn->mc_on ? (flags >> BTN_SNAP_CLICK_SHIFT) : 0;
+                }
+            }
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+            if (flags & BTN_SNAP_LOCK) {
+                if (!lite_button_snap_get(snap, len, &off, &v)) return false;
+                if (apply) {
+                    btn->lock_tick = base - (btn_tick_t)v;
+                    btn->lock_on = ((btn_tick_t)v + slept < ctx->lock_thr);
+                }
+            }
+#endif
+#if BTN_DEB_ADAPT_FUN_ENABLE
+            if (!lite_button_snap_get(snap, len, &off, &v)) return false;
+            if (apply) btn->deb_thr = (btn_deb_thr_t)MIN(MAX((btn_tick_t)v, ctx->deb_min), ctx->deb_max);
+#endif
+            if (apply && flags != 0) {
+                lite_button_snap_poll(ctx, (key_id_e)i);
+            }
+        }
+    }
+
+#if BTN_SEQ_FUN_ENABLE
+    if (!lite_button_snap_get(snap, len, &off, &v)) return false;
+    if (v >= ctx->seq_fsm.node_num && v != 0) return false;
+    if (apply) ctx->seq_fsm.state = (btn_seq_node_t)v;
+    if (v != 0) {
+        if (!lite_button_snap_get(snap, len, &off, &v)) return false;
+        if (apply) ctx->seq_fsm.last_tick = base - (btn_tick_t)v;
+    }
+#endif
+
+    return off == len;
+}
+
+size_t lite_button_snapshot_ctx(const lite_button_ctx_t *ctx, uint8_t *out, size_t size)
+{
+    uint8_t rec[1 + 5 * BTN_TRACE_VARINT_MAX];
+    btn_mask_t keys;
+#if BTN_TIMESTAMP_FUN_ENABLE
+    btn_tick_t now = lite_button_now(ctx);
+#else
+    btn_tick_t now = ctx->tmr_tick;
+#endif
+    uint16_t sum = lite_button_snap_sum(ctx);
+    size_t n = 0;
+    size_t k = 0;
+
+    if (out == NULL || size < 3 + BTN_MASK_WORDS * BTN_TRACE_VARINT_MAX) return 0;
+
+    // keys at rest are left out, a cold set up starts them the same
+    memset(&keys, 0, sizeof(btn_mask_t));
+    for (size_t j = 0; j < BTN_LIVE_NUM(ctx); j++) {
+        size_t i = BTN_LIVE_KEY(ctx, j);
+
+#if BTN_DEB_ADAPT_FUN_ENABLE
+        if (ctx->list[i].used && ctx->list[i].deb_thr != lite_button_snap_deb_start(ctx)) {
+            btn_mask_set(&keys, i);
+        }
+#endif
+        if (lite_button_snap_flags(ctx, (key_id_e)i) != 0) {
+            btn_mask_set(&keys, i);
+        }
+    }
+
+    out[n++] = BTN_SNAPSHOT_VERSION;
+    out[n++] = (uint8_t)sum;
+    out[n++] = (uint8_t)(sum >> 8);
+    for (size_t w = 0; w < BTN_MASK_WORDS; w++) {
+        n += lite_button_varint_put(&out[n], keys.w[w]);
+    }
+    for (size_t j = 0; j < BTN_LIVE_NUM(ctx); j++) {
+        size_t i = BTN_LIVE_KEY(ctx, j);
+
+        if (!btn_mask_test(&keys, i)) continue;
+        k = lite_button_snap_key(ctx, (key_id_e)i, lite_button_snap_flags(ctx, (key_id_e)i), now, rec);
+        if (size - n < k) return 0;
+        memcpy(&out[n], rec, k);
+        n += k;
+    }
+#if BTN_SEQ_FUN_ENABLE
+    k = lite_button_varint_put(rec, ctx->seq_fsm.state);
+    if (ctx->seq_fsm.state != 0) {
+        k += lite_button_varint_put(&rec[k], now - ctx->seq_fsm.last_tick);
+    }
+    if (size - n < k) return 0;
+    memcpy(&out[n], rec, k);
+    n += k;
+#endif
+
+    return n;
+}
+
+size_t lite_button_snapshot(uint8_t *out, size_t size)
+{
+    return lite_button_snapshot_ctx(&g_btn_ctx, out, size);
+}
+
+bool lite_button_restore_ctx(lite_button_ctx_t *ctx, const uint8_t *snap, size_t len, uint32_t slept_ms)
+{
+#if BTN_TIMESTAMP_FUN_ENABLE
+    btn_tick_t now = lite_button_now(ctx);
+#else
+    btn_tick_t now = ctx->tmr_tick;
+#endif
+    btn_tick_t slept = lite_button_ms_to_tick(ctx, slept_ms);
+
+    if (snap == NULL || len < 3 || snap[0] != BTN_SNAPSHOT_VERSION) return false;
+    if ((uint16_t)(snap[1] | (snap[2] << 8)) != lite_button_snap_sum(ctx)) return false;
+
+    // check the whole snapshot before any of it is taken over
+    if (!lite_button_snap_load(ctx, snap, len, now, slept, false)) return false;
+    lite_button_snap_load(ctx, snap, len, now, slept, true);
+
+    return true;
+}
+
+bool lite_button_restore(const uint8_t *snap, size_t len, uint32_t slept_ms)
+{
+    return lite_button_restore_ctx(&g_btn_ctx, snap, len, slept_ms);
+}
+
+void lite_button_wake_ctx(lite_button_ctx_t *ctx, key_id_e id)
+{
+    btn_dev_t *btn = NULL;
+#if BTN_TIMESTAMP_FUN_ENABLE
+    btn_tick_t now = lite_button_now(ctx);
+#else
+    btn_tick_t now = ctx->tmr_tick;
+#endif
+
+    if (id >= BTN_NUM || !ctx->list[id].used) return;
+    btn = &ctx->list[id];
+
+    if (btn->state != BTN_ACTIVE_LEVEL) {
+#if BTN_BATCH_FUN_ENABLE
+        if (btn_mask_test(&ctx->vc.keys_mask, id)) {
+            btn_mask_set(&ctx->vc.state, id);
+        }
+#endif
+#if BTN_DEB_LOCKOUT_FUN_ENABLE
+        // the bounce of the waking press is ignored as for any lockout press
+        if (ctx->dev_cfg[id].cfg.deb_mode == BTN_DEB_LOCKOUT) {
+            btn->lock_tick = now;
+            btn->lock_on = true;
+        }
+#endif
+        lite_button_state_switch(ctx, id, BTN_ACTIVE_LEVEL, now);
+    }
+    lite_button_snap_poll(ctx, id);
+}
+
+void lite_button_wake(key_id_e id)
+{
+    lite_button_wake_ctx(&g_btn_ctx, id);
+}
+#endif
+
+#if BTN_STATS_FUN_ENABLE
+void lite_button_register_stats_clock_ctx(lite_button_ctx_t *ctx, btn_stats_clock_f clock)
+{
+    ctx->stats_clock = clock;
+}
+
+void lite_button_register_stats_clock(btn_stats_clock_f clock)
+{
+    lite_button_register_stats_clock_ctx(&g_btn_ctx, clock);
+}
+
+bool lite_button_stats_get_ctx(const lite_button_ctx_t *ctx, btn_stats_t *out)
+{
+    uint32_t seq = 0;
+
+    for (size_t n = 0; n < BTN_STATS_READ_TRY; n++) {
+        seq = ctx->stats_seq;
+        BTN_MEMORY_BARRIER();
+        memcpy(out, &ctx->stats, sizeof(btn_stats_t));
+        BTN_MEMORY_BARRIER();
+        // no poll started or ran while copying
+        if ((seq & 1U) == 0 && seq == ctx->stats_seq) return true;
+    }
+
+    return false;
+}
+
+bool lite_button_stats_get(btn_stats_t *out)
+{
+    return lite_button_stats_get_ctx(&g_btn_ctx, out);
+}
+
+void lite_button_stats_reset_ctx(lite_button_ctx_t *ctx)
+{
+    ctx->stats_seq++;
+    BTN_MEMORY_BARRIER();
+    memset(&ctx->stats, 0, sizeof(btn_stats_t));
+    BTN_MEMORY_BARRIER();
+    ctx->stats_seq++;
+}
+
+void lite_button_stats_reset(void)
+{
+    lite_button_stats_reset_ctx(&g_btn_ctx);
+}
+#endif
@@ -0,0 +1,342 @@
+/**
+ * @file    lite_button_linux.c
+ * @brief   Linux backend: input keys fed from file descriptors with epoll.
+ *
+ * Every readable descriptor is drained, complete records are turned into
+ * input key levels and partial ones kept for the next read. The timerfd
+ * runs the poll handler: armed by the lite_button timer callbacks in EXTI
+ * mode, free running at the poll period otherwise.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "lite_button_linux.h"
+/* after lite_button_cfg.h: evdev key code macros share names with its key ids */
+#include <linux/input.h>
+#include <linux/gpio.h>
+
+/* every record must fit the partial record buffer */
+typedef char btn_linux_rec_check_t[(sizeof(struct input_event) <= BTN_LINUX_REC_MAX &&
+                                    sizeof(struct gpioevent_data) <= BTN_LINUX_REC_MAX &&
+                                    sizeof(struct gpio_v2_line_event) <= BTN_LINUX_REC_MAX) ? 1 : -1];
+
+/* records read per read() call */
+#define BTN_LINUX_READ_RECS  (16)
+
+/* timer callbacks take no argument, they act on the active backend */
+static btn_linux_t *g_btn_linux = NULL;
+
+static size_t btn_linux_rec_size(btn_linux_fmt_e fmt)
+{
+    switch (fmt) {
+    case BTN_LINUX_EVDEV:
+        return sizeof(struct input_event);
+    case BTN_LINUX_GPIO_V1:
+        return sizeof(struct gpioevent_data);
+    case BTN_LINUX_GPIO_V2:
+        return sizeof(struct gpio_v2_line_event);
+    }
+
+    return 0;
+}
+
+/* keep the first failure for btn_linux_wait() */
+static int btn_linux_tmr_update(btn_linux_t *lx, const struct itimerspec *its)
+{
+    if (timerfd_settime(lx->tfd, 0, its, NULL) == 0) return 0;
+    if (lx->tmr_err == 0) lx->tmr_err = errno;
+
+    return -1;
+}
+
+static int btn_linux_tmr_set(btn_linux_t *lx, uint32_t ms, bool periodic)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = ms / 1000U;
+    its.it_value.tv_nsec = (long)(ms % 1000U) * 1000000L;
+    // a zero value would disarm the timer, due at once instead
+    if (ms == 0) its.it_value.tv_nsec = 1;
+    if (periodic) its.it_interval = its.it_value;
+
+    lx->armed_ms = ms;
+    return btn_linux_tmr_update(lx, &its);
+}
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+static uint32_t btn_linux_clock_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U);
+}
+#endif
+
+#if BTN_EXTI_FUN_ENABLE
+static void btn_linux_tmr_creat(btn_timer_arg_callback_cb_f cb, void *arg)
+{
+    if (g_btn_linux == NULL) return;
+    g_btn_linux->poll_cb = cb;
+    g_btn_linux->poll_arg = arg;
+}
+
+static void btn_linux_tmr_start(uint32_t ms)
+{
+    if (g_btn_linux == NULL) return;
+    (void)btn_linux_tmr_set(g_btn_linux, ms, !BTN_TICKLESS_FUN_ENABLE);
+}
+
+static void btn_linux_tmr_stop(void)
+{
+    struct itimerspec its;
+
+    if (g_btn_linux == NULL) return;
+    memset(&its, 0, sizeof(its));
+    (void)btn_linux_tmr_update(g_btn_linux, &its);
+}
+
+#if BTN_TICKLESS_FUN_ENABLE
+static uint32_t btn_linux_tmr_elapsed(void)
+{
+    struct itimerspec its;
+    uint64_t left = 0;
+
+    if (g_btn_linux == NULL) return 0;
+    if (timerfd_gettime(g_btn_linux->tfd, &its) != 0) return 0;
+
+    // round the time left up, never credit more than went by
+    left = (uint64_t)its.it_value.tv_sec * 1000U + ((uint64_t)its.it_value.tv_nsec + 999999U) / 1000000U;
+    return (left >= g_btn_linux->armed_ms) ? 0 : (uint32_t)(g_btn_linux->armed_ms - left);
+}
+#endif
+#endif
+
+static void btn_linux_tmr_expire(btn_linux_t *lx)
+{
+    uint64_t n = 0;
+
+    if (read(lx->tfd, &n, sizeof(n)) != (ssize_t)sizeof(n)) return;
+
+#if BTN_TIMESTAMP_FUN_ENABLE || BTN_TICKLESS_FUN_ENABLE
+    // the poll reads the time itself
+    n = 1;
+#endif
+    // a late wakeup still counts every tick that went by
+    while (n-- > 0) {
+#if BTN_EXTI_FUN_ENABLE
+        if (lx->poll_cb != NULL) lx->poll_cb(lx->poll_arg);
+#else
+        lite_button_poll_handle_ctx(lx->ctx);
+#endif
+    }
+}
+
+static void btn_linux_rec_handle(btn_linux_t *lx, const btn_linux_src_t *src, const uint8_t *rec)
+{
+    struct input_event key;
+    struct gpioevent_data v1;
+    struct gpio_v2_line_event v2;
+    btn_level_e lv = BTN_IDLE_LEVEL;
+    uint32_t code = 0;
+
+    switch (src->fmt) {
+    case BTN_LINUX_EVDEV:
+        memcpy(&key, rec, sizeof(key));
+        // 2 is an autorepeat, long press is timed here
+        if (key.type != EV_KEY || key.value > 1) return;
+        code = key.code;
+        lv = (key.value != 0) ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL;
+        break;
+    case BTN_LINUX_GPIO_V1:
+        memcpy(&v1, rec, sizeof(v1));
+        if (src->map_num == 0) return;
+        code = src->map[0].code;
+        lv = (v1.id == GPIOEVENT_EVENT_RISING_EDGE) ? BTN_LEVEL_HIGH : BTN_LEVEL_LOW;
+        break;
+    case BTN_LINUX_GPIO_V2:
+        memcpy(&v2, rec, sizeof(v2));
+        code = v2.offset;
+        lv = (v2.id == GPIO_V2_LINE_EVENT_RISING_EDGE) ? BTN_LEVEL_HIGH : BTN_LEVEL_LOW;
+        break;
+    }
+
+    for (size_t n = 0; n < src->map_num; n++) {
+        if (src->map[n].code == code) {
+            lite_button_input_set_ctx(lx->ctx, src->map[n].key, lv);
+        }
+    }
+}
+
+/* drain the descriptor, false once it is closed or failed */
+static bool btn_linux_src_read(btn_linux_t *lx, btn_linux_src_t *src)
+{
+    uint8_t buf[BTN_LINUX_REC_MAX * BTN_LINUX_READ_RECS];
+    size_t rec = btn_linux_rec_size(src->fmt);
+    size_t len = 0;
+    size_t off = 0;
+    ssize_t r = 0;
+
+    for (;;) {
+        memcpy(buf, src->buf, src->len);
+        len = src->len;
+        r = read(src->fd, buf + len, rec * BTN_LINUX_READ_RECS - len);
+        if (r == 0) return false;
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        len += (size_t)r;
+        for (off = 0; len - off >= rec; off += rec) {
+            btn_linux_rec_handle(lx, src, buf + off);
+        }
+        src->len = len - off;
+        memcpy(src->buf, buf + off, src->len);
+    }
+}
+
+int btn_linux_init(btn_linux_t *lx, lite_button_ctx_t *ctx)
+{
+    struct epoll_event ev;
+    int err = 0;
+#if BTN_EXTI_FUN_ENABLE
+    btn_timer_cb_t tmr = {0};
+#endif
+
+    if (g_btn_linux != NULL) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    memset(lx, 0, sizeof(btn_linux_t));
+    lx->ctx = ctx;
+    lx->epfd = epoll_create1(EPOLL_CLOEXEC);
+    lx->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (lx->epfd < 0 || lx->tfd < 0) goto fail;
+
+    // the timerfd is told apart from the sources by a NULL pointer
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(lx->epfd, EPOLL_CTL_ADD, lx->tfd, &ev) != 0) goto fail;
+
+    g_btn_linux = lx;
+#if BTN_TIMESTAMP_FUN_ENABLE
+    lite_button_register_clock_ctx(ctx, btn_linux_clock_us);
+#endif
+#if BTN_EXTI_FUN_ENABLE
+    tmr.creat_arg = btn_linux_tmr_creat;
+    tmr.start = btn_linux_tmr_start;
+    tmr.stop = btn_linux_tmr_stop;
+#if BTN_TICKLESS_FUN_ENABLE
+    tmr.elapsed = btn_linux_tmr_elapsed;
+#endif
+    lite_button_register_timer_ctx(ctx, &tmr);
+#else
+    if (btn_linux_tmr_set(lx, ctx->poll_period_ms, true) != 0) goto fail;
+#endif
+
+    return 0;
+
+fail:
+    err = errno;
+    if (g_btn_linux == lx) g_btn_linux = NULL;
+    if (lx->epfd >= 0) close(lx->epfd);
+    if (lx->tfd >= 0) close(lx->tfd);
+    lx->epfd = -1;
+    lx->tfd = -1;
+    errno = err;
+    return -1;
+}
+
+int btn_linux_add(btn_linux_t *lx, int fd, btn_linux_fmt_e fmt, const btn_linux_map_t *map, size_t num)
+{
+    btn_linux_src_t *src = NULL;
+    struct epoll_event ev;
+    int flags = 0;
+    size_t n = 0;
+
+    if (fd < 0 || btn_linux_rec_size(fmt) == 0 || (map == NULL && num != 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // reuse the slot of a source that went away
+    for (n = 0; n < lx->src_num && lx->src[n].fd >= 0; n++) {}
+    if (n >= BTN_LINUX_SRC_MAX) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) return -1;
+
+    src = &lx->src[n];
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = src;
+    if (epoll_ctl(lx->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) return -1;
+
+    src->fd = fd;
+    src->fmt = fmt;
+    src->map = map;
+    src->map_num = num;
+    src->len = 0;
+    if (n == lx->src_num) lx->src_num++;
+
+    return 0;
+}
+
+int btn_linux_wait(btn_linux_t *lx, int timeout_ms)
+{
+    struct epoll_event ev[BTN_LINUX_SRC_MAX + 1];
+    btn_linux_src_t *src = NULL;
+    bool expired = false;
+    int num = 0;
+
+    if (lx->tmr_err != 0) goto tmr_fail;
+    num = epoll_wait(lx->epfd, ev, BTN_LINUX_SRC_MAX + 1, timeout_ms);
+    if (num < 0) return (errno == EINTR) ? 0 : -1;
+
+    for (int n = 0; n < num; n++) {
+        src = (btn_linux_src_t *)ev[n].data.ptr;
+        if (src == NULL) {
+            expired = true;
+            continue;
+        }
+        if (!btn_linux_src_read(lx, src)) {
+            epoll_ctl(lx->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+            src->fd = -1;
+        }
+    }
+    // edges first, a poll due at the same time sees them
+    if (expired) {
+        btn_linux_tmr_expire(lx);
+    }
+    if (lx->tmr_err != 0) goto tmr_fail;
+
+    return num;
+
+tmr_fail:
+    errno = lx->tmr_err;
+    lx->tmr_err = 0;
+    return -1;
+}
+
+void btn_linux_deinit(btn_linux_t *lx)
+{
+    if (g_btn_linux == lx) g_btn_linux = NULL;
+    if (lx->epfd >= 0) close(lx->epfd);
+    if (lx->tfd >= 0) close(lx->tfd);
+    lx->epfd = -1;
+    lx->tfd = -1;
+    lx->src_num = 0;
+}
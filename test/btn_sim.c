@@ -0,0 +1,526 @@
+/**
+ * @file    btn_sim.c
+ * @brief   Virtual GPIO and timer backend for host side simulation.
+ *
+ * The timeline only advances from one scheduled point to the next: key
+ * edges, timer expiries and (without EXTI) poll ticks. Time spent in the
+ * poll handler is measured on the host monotonic clock.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "btn_sim.h"
+
+typedef struct {
+    uint64_t us;
+    key_id_e key;
+    bool pressed;
+} btn_sim_edge_t;
+
+/* how a key reaches lite_button */
+typedef enum {
+    BTN_SIM_GPIO = 0,
+    BTN_SIM_INPUT,
+    BTN_SIM_PORT,
+    BTN_SIM_MATRIX,
+} btn_sim_kind_e;
+
+static uint64_t g_sim_now = 0;
+static uint32_t g_sim_seed = 1;
+static bool g_sim_pressed[BTN_NUM] = {false};
+static uint8_t g_sim_kind[BTN_NUM] = {0};
+#if BTN_PORT_FUN_ENABLE
+static uint8_t g_sim_port[BTN_NUM][2];      /* port, pin */
+#endif
+#if BTN_MATRIX_FUN_ENABLE
+static uint8_t g_sim_cross[BTN_NUM][2];     /* row, col */
+static int g_sim_row = -1;                  /* driven row, -1 for none */
+#endif
+
+static btn_sim_edge_t g_sim_edge[BTN_SIM_EDGE_MAX];
+static size_t g_sim_edge_num = 0;
+
+static btn_sim_evt_t g_sim_log[BTN_SIM_LOG_MAX];
+static size_t g_sim_log_num = 0;
+
+static btn_sim_stat_t g_sim_stat = {0};
+static uint32_t g_sim_fail = 0;
+#if BTN_EVT_BATCH_FUN_ENABLE
+static uint32_t g_sim_poll_batches = 0;
+#endif
+
+#if BTN_EXTI_FUN_ENABLE
+static btn_timer_callback_cb_f g_sim_tmr_cb = NULL;
+static bool g_sim_tmr_run = false;
+static uint64_t g_sim_tmr_due = 0;
+static uint64_t g_sim_tmr_start = 0;
+static uint64_t g_sim_tmr_period = 0;
+#else
+static uint64_t g_sim_poll_due = 0;
+#endif
+
+static uint32_t btn_sim_rand(void)
+{
+    g_sim_seed = g_sim_seed * 1103515245U + 12345U;
+    return (g_sim_seed >> 16) & 0x7FFF;
+}
+
+static void btn_sim_log(uint32_t id, btn_evt_e evt)
+{
+    if (g_sim_log_num >= BTN_SIM_LOG_MAX) return;
+    g_sim_log[g_sim_log_num].us = g_sim_now;
+    g_sim_log[g_sim_log_num].id = id;
+    g_sim_log[g_sim_log_num].evt = evt;
+    g_sim_log_num++;
+}
+
+static void btn_sim_key_cb(btn_evt_e evt, void *para)
+{
+    btn_sim_log((uint32_t)(uintptr_t)para, evt);
+}
+
+#if BTN_COMBO_FUN_ENABLE
+static void btn_sim_combo_cb(key_combo_id_e id, void *para)
+{
+    (void)para;
+    btn_sim_log(BTN_SIM_COMBO_ID(id), BTN_EVT_COMBO);
+}
+#endif
+
+#if BTN_SEQ_FUN_ENABLE
+static void btn_sim_seq_cb(key_seq_id_e id, void *para)
+{
+    (void)para;
+    btn_sim_log(BTN_SIM_SEQ_ID(id), BTN_EVT_SEQUENCE);
+}
+#endif
+
+#if BTN_EVT_BATCH_FUN_ENABLE
+static void btn_sim_batch_cb(const btn_evt_rec_t *evt, size_t num, void *para)
+{
+    (void)para;
+    g_sim_stat.batches++;
+    g_sim_poll_batches++;
+    for (size_t n = 0; n < num; n++) {
+#if BTN_COMBO_FUN_ENABLE
+        if (evt[n].evt == BTN_EVT_COMBO) {
+            btn_sim_log(BTN_SIM_COMBO_ID(evt[n].id), BTN_EVT_COMBO);
+            continue;
+        }
+#endif
+#if BTN_SEQ_FUN_ENABLE
+        if (evt[n].evt == BTN_EVT_SEQUENCE) {
+            btn_sim_log(BTN_SIM_SEQ_ID(evt[n].id), BTN_EVT_SEQUENCE);
+            continue;
+        }
+#endif
+        btn_sim_log(evt[n].id, (btn_evt_e)evt[n].evt);
+    }
+}
+#endif
+
+static btn_level_e btn_sim_gpio(key_id_e key)
+{
+    g_sim_stat.reads[key]++;
+    return g_sim_pressed[key] ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL;
+}
+
+/* lite_button reads take no argument, one reader per key */
+#define BTN_SIM_GPIO(n) \
+    static btn_level_e btn_sim_gpio_##n(void) { return btn_sim_gpio((key_id_e)(n)); }
+BTN_SIM_GPIO(0) BTN_SIM_GPIO(1) BTN_SIM_GPIO(2) BTN_SIM_GPIO(3)
+BTN_SIM_GPIO(4) BTN_SIM_GPIO(5) BTN_SIM_GPIO(6) BTN_SIM_GPIO(7)
+
+static const btn_gpio_lv_f g_sim_gpio[] = {
+    btn_sim_gpio_0, btn_sim_gpio_1, btn_sim_gpio_2, btn_sim_gpio_3,
+    btn_sim_gpio_4, btn_sim_gpio_5, btn_sim_gpio_6, btn_sim_gpio_7,
+};
+
+#if BTN_PORT_FUN_ENABLE
+/* port word, a pressed key pulls its pin to the active level */
+static uint32_t btn_sim_port(uint8_t port)
+{
+    uint32_t lv = 0;
+
+    for (size_t k = 0; k < BTN_NUM; k++) {
+        if (g_sim_kind[k] != BTN_SIM_PORT || g_sim_port[k][0] != port || !g_sim_pressed[k]) continue;
+        lv |= BIT(g_sim_port[k][1]);
+    }
+#if (BTN_ACTIVE_LEVEL == BTN_LEVEL_LOW)
+    lv = ~lv;
+#endif
+    return lv;
+}
+
+static uint32_t btn_sim_port_0(void) { return btn_sim_port(0); }
+static uint32_t btn_sim_port_1(void) { return btn_sim_port(1); }
+
+static const btn_port_lv_f g_sim_port_cb[] = {btn_sim_port_0, btn_sim_port_1};
+#endif
+
+#if BTN_MATRIX_FUN_ENABLE
+static void btn_sim_row_drive(uint8_t row, bool drive)
+{
+    g_sim_row = drive ? (int)row : -1;
+}
+
+/*
+ * Columns seen on the driven row. Without diodes a pressed key joins its
+ * row and column, so current also finds its way through other rows: three
+ * corners of a rectangle pressed show the fourth one.
+ */
+static uint32_t btn_sim_col_read(void)
+{
+    uint32_t rows = 0;
+    uint32_t cols = 0;
+    uint32_t seen_rows = UINT32_MAX;
+    uint32_t seen_cols = 0;
+
+    if (g_sim_row >= 0) rows = BIT(g_sim_row);
+    // spread until neither rows nor columns grow any more
+    while (seen_rows != rows || seen_cols != cols) {
+        seen_rows = rows;
+        seen_cols = cols;
+        for (size_t k = 0; k < BTN_NUM; k++) {
+            if (g_sim_kind[k] != BTN_SIM_MATRIX || !g_sim_pressed[k]) continue;
+            if (rows & BIT(g_sim_cross[k][0])) cols |= BIT(g_sim_cross[k][1]);
+            if (cols & BIT(g_sim_cross[k][1])) rows |= BIT(g_sim_cross[k][0]);
+        }
+    }
+#if (BTN_ACTIVE_LEVEL == BTN_LEVEL_LOW)
+    cols = ~cols;
+#endif
+    return cols;
+}
+#endif
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+static uint32_t btn_sim_clock_us(void)
+{
+    return (uint32_t)g_sim_now;
+}
+#endif
+
+#if BTN_EXTI_FUN_ENABLE
+static void btn_sim_tmr_creat(btn_timer_callback_cb_f cb)
+{
+    g_sim_tmr_cb = cb;
+}
+
+static void btn_sim_tmr_start(uint32_t ms)
+{
+    g_sim_tmr_start = g_sim_now;
+    g_sim_tmr_period = (uint64_t)ms * 1000U;
+    g_sim_tmr_due = g_sim_now + g_sim_tmr_period;
+    g_sim_tmr_run = true;
+}
+
+static void btn_sim_tmr_stop(void)
+{
+    g_sim_tmr_run = false;
+}
+
+#if BTN_TICKLESS_FUN_ENABLE
+static uint32_t btn_sim_tmr_elapsed(void)
+{
+    return (uint32_t)((g_sim_now - g_sim_tmr_start) / 1000U);
+}
+#endif
+#endif
+
+static uint64_t btn_sim_host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+#if BTN_STATS_FUN_ENABLE
+static uint32_t btn_sim_stats_clock(void)
+{
+    return (uint32_t)btn_sim_host_ns();
+}
+#endif
+
+static void btn_sim_poll(void (*poll)(void))
+{
+    uint64_t t0 = btn_sim_host_ns();
+    uint64_t ns = 0;
+
+#if BTN_EVT_BATCH_FUN_ENABLE
+    g_sim_poll_batches = 0;
+#endif
+    poll();
+    ns = btn_sim_host_ns() - t0;
+
+    g_sim_stat.polls++;
+    g_sim_stat.poll_ns += ns;
+    if (ns > g_sim_stat.poll_ns_max) g_sim_stat.poll_ns_max = ns;
+#if BTN_EVT_QUEUE_FUN_ENABLE
+    lite_button_dispatch();
+#endif
+#if BTN_EVT_BATCH_FUN_ENABLE
+    if (g_sim_poll_batches > 1) g_sim_stat.batch_split++;
+#endif
+}
+
+void btn_sim_init(const btn_cfg_t *cfg)
+{
+#if BTN_EXTI_FUN_ENABLE
+    btn_timer_cb_t tmr = {0};
+#endif
+
+    g_sim_seed = 1;
+    for (size_t i = 0; i < BTN_NUM; i++) {
+        g_sim_pressed[i] = false;
+        g_sim_kind[i] = BTN_SIM_GPIO;
+        if (i >= sizeof(g_sim_gpio) / sizeof(g_sim_gpio[0])) continue;
+        lite_button_init((key_id_e)i, g_sim_gpio[i], cfg, btn_sim_key_cb, (void *)(uintptr_t)i);
+    }
+#if BTN_PORT_FUN_ENABLE
+    for (size_t p = 0; p < BTN_PORT_NUM && p < sizeof(g_sim_port_cb) / sizeof(g_sim_port_cb[0]); p++) {
+        lite_button_register_port((uint8_t)p, g_sim_port_cb[p]);
+    }
+#endif
+#if BTN_MATRIX_FUN_ENABLE
+    {
+        btn_matrix_cb_t mx = {btn_sim_row_drive, btn_sim_col_read};
+
+        lite_button_register_matrix(&mx);
+    }
+#endif
+
+#if BTN_TIMESTAMP_FUN_ENABLE
+    lite_button_register_clock(btn_sim_clock_us);
+#endif
+#if BTN_EVT_BATCH_FUN_ENABLE
+    lite_button_register_evt_batch(btn_sim_batch_cb, NULL);
+#endif
+#if BTN_STATS_FUN_ENABLE
+    lite_button_register_stats_clock(btn_sim_stats_clock);
+    lite_button_stats_reset();
+#endif
+#if BTN_EXTI_FUN_ENABLE
+    tmr.creat = btn_sim_tmr_creat;
+    tmr.start = btn_sim_tmr_start;
+    tmr.stop = btn_sim_tmr_stop;
+#if BTN_TICKLESS_FUN_ENABLE
+    tmr.elapsed = btn_sim_tmr_elapsed;
+#endif
+    g_sim_tmr_run = false;
+    lite_button_register_timer(&tmr);
+#else
+    g_sim_poll_due = g_sim_now + BTN_POLL_PERIOD_MS * 1000U;
+#endif
+}
+
+void btn_sim_key_cfg(key_id_e key, const btn_cfg_t *cfg)
+{
+    if ((size_t)key >= sizeof(g_sim_gpio) / sizeof(g_sim_gpio[0])) return;
+    g_sim_kind[key] = BTN_SIM_GPIO;
+    lite_button_init(key, g_sim_gpio[key], cfg, btn_sim_key_cb, (void *)(uintptr_t)key);
+}
+
+void btn_sim_input_key(key_id_e key, const btn_cfg_t *cfg)
+{
+    if ((size_t)key >= BTN_NUM) return;
+    g_sim_kind[key] = BTN_SIM_INPUT;
+    g_sim_pressed[key] = false;
+    lite_button_init_input(key, cfg, btn_sim_key_cb, (void *)(uintptr_t)key);
+}
+
+#if BTN_PORT_FUN_ENABLE
+void btn_sim_port_key(key_id_e key, uint8_t port, uint8_t pin, const btn_cfg_t *cfg)
+{
+    if ((size_t)key >= BTN_NUM) return;
+    g_sim_kind[key] = BTN_SIM_PORT;
+    g_sim_port[key][0] = port;
+    g_sim_port[key][1] = pin;
+    lite_button_init_port(key, port, pin, cfg, btn_sim_key_cb, (void *)(uintptr_t)key);
+}
+#endif
+
+#if BTN_MATRIX_FUN_ENABLE
+void btn_sim_matrix_key(key_id_e key, uint8_t row, uint8_t col, const btn_cfg_t *cfg)
+{
+    if ((size_t)key >= BTN_NUM) return;
+    g_sim_kind[key] = BTN_SIM_MATRIX;
+    g_sim_cross[key][0] = row;
+    g_sim_cross[key][1] = col;
+    lite_button_init_matrix(key, row, col, cfg, btn_sim_key_cb, (void *)(uintptr_t)key);
+}
+#endif
+
+void btn_sim_register_combo(key_combo_id_e id, const btn_combo_cfg_t *cfg)
+{
+#if BTN_COMBO_FUN_ENABLE
+    lite_button_register_combos(id, cfg, btn_sim_combo_cb, NULL);
+#else
+    (void)id;
+    (void)cfg;
+#endif
+}
+
+void btn_sim_register_seq(key_seq_id_e id, const btn_seq_cfg_t *cfg)
+{
+#if BTN_SEQ_FUN_ENABLE
+    lite_button_register_seq(id, cfg, btn_sim_seq_cb, NULL);
+#else
+    (void)id;
+    (void)cfg;
+#endif
+}
+
+static void btn_sim_edge_add(key_id_e key, uint64_t us, bool pressed)
+{
+    size_t n = g_sim_edge_num;
+
+    if (n >= BTN_SIM_EDGE_MAX) return;
+
+    // keep the edges sorted by time, same time edges in insertion order
+    while (n > 0 && g_sim_edge[n - 1].us > us) {
+        g_sim_edge[n] = g_sim_edge[n - 1];
+        n--;
+    }
+    g_sim_edge[n].us = us;
+    g_sim_edge[n].key = key;
+    g_sim_edge[n].pressed = pressed;
+    g_sim_edge_num++;
+}
+
+uint64_t btn_sim_edge(key_id_e key, uint64_t us, bool pressed, uint32_t bounce)
+{
+    btn_sim_edge_add(key, us, pressed);
+    for (uint32_t b = 0; b < bounce; b++) {
+        us += 50U + btn_sim_rand() % 750U;
+        btn_sim_edge_add(key, us, !pressed);
+        us += 50U + btn_sim_rand() % 750U;
+        btn_sim_edge_add(key, us, pressed);
+    }
+
+    return us;
+}
+
+void btn_sim_run(uint64_t until_us)
+{
+    uint64_t next = 0;
+    size_t n = 0;
+
+    for (;;) {
+        next = UINT64_MAX;
+        if (g_sim_edge_num != 0) next = g_sim_edge[0].us;
+#if BTN_EXTI_FUN_ENABLE
+        if (g_sim_tmr_run && g_sim_tmr_due < next) next = g_sim_tmr_due;
+#else
+        if (g_sim_poll_due < next) next = g_sim_poll_due;
+#endif
+        if (next > until_us) break;
+        if (next > g_sim_now) g_sim_now = next;
+
+        // level changes first, a poll at the same instant sees them
+        for (n = 0; n < g_sim_edge_num && g_sim_edge[n].us <= g_sim_now; n++) {
+            if (g_sim_pressed[g_sim_edge[n].key] == g_sim_edge[n].pressed) continue;
+            g_sim_pressed[g_sim_edge[n].key] = g_sim_edge[n].pressed;
+            if (g_sim_kind[g_sim_edge[n].key] == BTN_SIM_INPUT) {
+                // a pushed level raises its own EXTI trigger
+                lite_button_input_set(g_sim_edge[n].key,
+                                      g_sim_edge[n].pressed ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL);
+                continue;
+            }
+#if BTN_EXTI_FUN_ENABLE
+            g_sim_stat.exti++;
+            lite_button_exti_trigger(g_sim_edge[n].key);
+#endif
+        }
+        if (n != 0) {
+            memmove(&g_sim_edge[0], &g_sim_edge[n], (g_sim_edge_num - n) * sizeof(g_sim_edge[0]));
+            g_sim_edge_num -= n;
+        }
+
+#if BTN_EXTI_FUN_ENABLE
+        if (g_sim_tmr_run && g_sim_tmr_due <= g_sim_now) {
+#if BTN_TICKLESS_FUN_ENABLE
+            g_sim_tmr_run = false;
+#else
+            g_sim_tmr_due += g_sim_tmr_period;
+#endif
+            g_sim_stat.wakeups++;
+            if (g_sim_tmr_cb != NULL) btn_sim_poll(g_sim_tmr_cb);
+        }
+#else
+        if (g_sim_poll_due <= g_sim_now) {
+            g_sim_poll_due += BTN_POLL_PERIOD_MS * 1000U;
+            g_sim_stat.wakeups++;
+            btn_sim_poll(lite_button_poll_handle);
+        }
+#endif
+    }
+
+    if (until_us > g_sim_now) g_sim_now = until_us;
+}
+
+uint64_t btn_sim_now(void)
+{
+    return g_sim_now;
+}
+
+uint64_t btn_sim_find(uint32_t id, btn_evt_e evt, uint64_t from_us)
+{
+    for (size_t n = 0; n < g_sim_log_num; n++) {
+        if (g_sim_log[n].us < from_us) continue;
+        if (g_sim_log[n].id == id && g_sim_log[n].evt == evt) return g_sim_log[n].us;
+    }
+
+    return UINT64_MAX;
+}
+
+size_t btn_sim_count(uint32_t id, btn_evt_e evt, uint64_t from_us, uint64_t to_us)
+{
+    size_t cnt = 0;
+
+    for (size_t n = 0; n < g_sim_log_num; n++) {
+        if (g_sim_log[n].us < from_us || g_sim_log[n].us >= to_us) continue;
+        if (g_sim_log[n].id == id && g_sim_log[n].evt == evt) cnt++;
+    }
+
+    return cnt;
+}
+
+bool btn_sim_expect(const char *name, uint32_t id, btn_evt_e evt, uint64_t from_us, size_t num)
+{
+    size_t cnt = btn_sim_count(id, evt, from_us, UINT64_MAX);
+
+    if (cnt == num) return true;
+    printf("FAIL %s id 0x%x: %zu events, expected %zu\n", name, (unsigned)id, cnt, num);
+    g_sim_fail++;
+    return false;
+}
+
+void btn_sim_fail(void)
+{
+    g_sim_fail++;
+}
+
+int btn_sim_result(void)
+{
+    printf("%u failures\n", g_sim_fail);
+    return g_sim_fail ? 1 : 0;
+}
+
+const btn_sim_evt_t *btn_sim_log_get(size_t *num)
+{
+    *num = g_sim_log_num;
+    return g_sim_log;
+}
+
+void btn_sim_log_clear(void)
+{
+    g_sim_log_num = 0;
+}
+
+const btn_sim_stat_t *btn_sim_stat_get(void)
+{
+    return &g_sim_stat;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file    btn_sim.h
+ * @brief   Virtual GPIO and timer backend for host side simulation.
+ *
+ * Keys are driven by scripted edges (with contact bounce) on a virtual
+ * microsecond timeline. The backend feeds lite_button the same way a board
+ * does: GPIO read callbacks, EXTI triggers on every level change and a
+ * periodic or one-shot timer, or plain periodic polls without EXTI.
+ *
+ * @note Host only, single threaded.
+ */
+
+#ifndef __BTN_SIM_H__
+#define __BTN_SIM_H__
+
+#include "lite_button.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BTN_SIM_EDGE_MAX     (256)
+#define BTN_SIM_LOG_MAX      (1024)
+
+/* ids of combo and sequence events are offset to keep them apart from keys */
+#define BTN_SIM_COMBO_ID(c)  (0x100U + (uint32_t)(c))
+#define BTN_SIM_SEQ_ID(s)    (0x200U + (uint32_t)(s))
+
+typedef struct {
+    uint64_t us;
+    uint32_t id;        /* key id, BTN_SIM_COMBO_ID() or BTN_SIM_SEQ_ID() */
+    btn_evt_e evt;
+} btn_sim_evt_t;
+
+typedef struct {
+    uint64_t polls;         /* lite_button poll handler runs */
+    uint64_t wakeups;       /* timer expiries (EXTI) or poll ticks */
+    uint64_t exti;          /* EXTI triggers raised */
+    uint64_t poll_ns;       /* host time spent in the poll handler */
+    uint64_t poll_ns_max;
+    uint64_t batches;       /* batch callbacks (event batch mode) */
+    uint64_t batch_split;   /* polls whose events took more than one */
+    uint64_t reads[BTN_NUM];    /* GPIO reads per key */
+} btn_sim_stat_t;
+
+/**
+ * @brief Reset the timeline, register the virtual GPIOs and timer
+ *
+ * Keys are registered with lite_button_init() using the given config,
+ * the callbacks only log events into the simulation. In stats mode poll
+ * and callback times are measured in host nanoseconds. In event batch mode
+ * events are logged from a batch callback instead.
+ *
+ * The virtual ports and matrix are registered too, their keys are set up
+ * afterwards.
+ */
+void btn_sim_init(const btn_cfg_t *cfg);
+
+#if BTN_PORT_FUN_ENABLE
+/**
+ * @brief Register a key on a pin of a virtual port word (port 0 or 1)
+ */
+void btn_sim_port_key(key_id_e key, uint8_t port, uint8_t pin, const btn_cfg_t *cfg);
+#endif
+
+#if BTN_MATRIX_FUN_ENABLE
+/**
+ * @brief Register a key on a cross point of a virtual matrix without diodes
+ */
+void btn_sim_matrix_key(key_id_e key, uint8_t row, uint8_t col, const btn_cfg_t *cfg);
+#endif
+
+/**
+ * @brief Register one key again with a config of its own, after btn_sim_init()
+ */
+void btn_sim_key_cfg(key_id_e key, const btn_cfg_t *cfg);
+
+/**
+ * @brief Register a key whose level is pushed with lite_button_input_set(),
+ *        for ids past the virtual GPIOs
+ */
+void btn_sim_input_key(key_id_e key, const btn_cfg_t *cfg);
+
+/**
+ * @brief Register a combo whose events are logged as BTN_SIM_COMBO_ID(id)
+ */
+void btn_sim_register_combo(key_combo_id_e id, const btn_combo_cfg_t *cfg);
+
+/**
+ * @brief Register a sequence whose events are logged as BTN_SIM_SEQ_ID(id)
+ */
+void btn_sim_register_seq(key_seq_id_e id, const btn_seq_cfg_t *cfg);
+
+/**
+ * @brief Schedule a key level change
+ *
+ * @param key     Key ID
+ * @param us      Time of the first edge
+ * @param pressed New level, true for pressed
+ * @param bounce  Extra toggles before the level settles, each 50 ~ 800 us
+ *                apart (pseudo random, reproducible)
+ * @return Time the level settles
+ */
+uint64_t btn_sim_edge(key_id_e key, uint64_t us, bool pressed, uint32_t bounce);
+
+/**
+ * @brief Run the simulation up to the given time
+ */
+void btn_sim_run(uint64_t until_us);
+
+/**
+ * @brief Current simulation time
+ */
+uint64_t btn_sim_now(void);
+
+/**
+ * @brief Find the first logged event matching id and type at or after a time
+ *
+ * @return Event time, or UINT64_MAX when not found
+ */
+uint64_t btn_sim_find(uint32_t id, btn_evt_e evt, uint64_t from_us);
+
+/**
+ * @brief Number of logged events matching id and type in [from_us, to_us)
+ */
+size_t btn_sim_count(uint32_t id, btn_evt_e evt, uint64_t from_us, uint64_t to_us);
+
+/**
+ * @brief Check the number of logged events matching id and type from a time on
+ *
+ * A mismatch is printed with the check name and counted as a failure.
+ *
+ * @return true if the count matched
+ */
+bool btn_sim_expect(const char *name, uint32_t id, btn_evt_e evt, uint64_t from_us, size_t num);
+
+/**
+ * @brief Count a failure the test found and printed itself
+ */
+void btn_sim_fail(void);
+
+/**
+ * @brief Print the failures counted so far
+ *
+ * @return Exit code for main(), 0 without failures
+ */
+int btn_sim_result(void);
+
+/**
+ * @brief Get the logged events
+ */
+const btn_sim_evt_t *btn_sim_log_get(size_t *num);
+
+/**
+ * @brief Forget the logged events
+ */
+void btn_sim_log_clear(void);
+
+/**
+ * @brief Get the run statistics
+ */
+const btn_sim_stat_t *btn_sim_stat_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BTN_SIM_H__
@@ -0,0 +1,173 @@
+/**
+ * @file    test_adc.c
+ * @brief   Resistor ladder keys decoded from noisy ADC readings.
+ *
+ * A 12 bit ladder carries the three keys plus a band where two of them are
+ * pressed together. Every poll takes one reading with pseudo random noise.
+ * Readings that wander across a band edge, or a single reading caught in
+ * the wrong band while the input settles, must not produce key events.
+ * Gestures on the decoded keys, the pair combo included, must be reported
+ * exactly once.
+ */
+
+#include <stdio.h>
+#include "lite_button.h"
+
+#define ADC_LOG_MAX         (64)
+#define ADC_NOISE           (12)    /* within BTN_ADC_HYST */
+#define ADC_LONGPRESS_MS    (600)
+#define ADC_IDLE            (3900)
+#define ADC_COMBO_ID        (0x100U)
+
+typedef struct {
+    uint32_t id;
+    btn_evt_e evt;
+} adc_evt_t;
+
+/* position 0 KEY_UP, 1 KEY_DOWN, 2 KEY_OK, DOWN + OK held together in band 3 */
+static const btn_adc_band_t g_band[] = {
+    {600, BIT(0)},
+    {1400, BIT(1)},
+    {2200, BIT(2)},
+    {3000, BIT(1) | BIT(2)},
+};
+
+static lite_button_ctx_t g_ctx;
+static adc_evt_t g_log[ADC_LOG_MAX];
+static size_t g_log_num = 0;
+static uint16_t g_adc = ADC_IDLE;
+static uint32_t g_noise = 0;
+static uint32_t g_seed = 3;
+
+static void adc_log(uint32_t id, btn_evt_e evt)
+{
+    if (g_log_num >= ADC_LOG_MAX) return;
+    g_log[g_log_num].id = id;
+    g_log[g_log_num].evt = evt;
+    g_log_num++;
+}
+
+static void adc_key_cb(btn_evt_e evt, void *para)
+{
+    adc_log((uint32_t)(uintptr_t)para, evt);
+}
+
+#if BTN_COMBO_FUN_ENABLE
+static void adc_combo_cb(key_combo_id_e id, void *para)
+{
+    (void)para;
+    adc_log(ADC_COMBO_ID + (uint32_t)id, BTN_EVT_COMBO);
+}
+#endif
+
+static uint16_t adc_read(void)
+{
+    int32_t v = 0;
+
+    g_seed = g_seed * 1103515245U + 12345U;
+    v = (int32_t)g_adc + (int32_t)(((g_seed >> 16) & 0x7FFF) % (2 * g_noise + 1)) - (int32_t)g_noise;
+
+    return (uint16_t)MAX(v, 0);
+}
+
+/* hold a level for the given time, one reading per poll */
+static void adc_hold(uint16_t adc, uint32_t noise, uint32_t ms)
+{
+    g_adc = adc;
+    g_noise = noise;
+    for (uint32_t t = 0; t < ms; t += BTN_POLL_PERIOD_MS) {
+        lite_button_poll_handle_ctx(&g_ctx);
+#if BTN_EVT_QUEUE_FUN_ENABLE
+        lite_button_dispatch_ctx(&g_ctx);
+#endif
+    }
+}
+
+static size_t adc_count(uint32_t id, btn_evt_e evt)
+{
+    size_t cnt = 0;
+
+    for (size_t n = 0; n < g_log_num; n++) {
+        if (g_log[n].id == id && g_log[n].evt == evt) cnt++;
+    }
+
+    return cnt;
+}
+
+static uint32_t adc_expect(const char *name, uint32_t id, btn_evt_e evt, size_t num)
+{
+    size_t cnt = adc_count(id, evt);
+
+    printf("%-10s %zu\n", name, cnt);
+    if (cnt == num) return 0;
+    printf("FAIL %s: %zu events, expected %zu\n", name, cnt, num);
+    return 1;
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = ADC_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+    };
+#if BTN_COMBO_FUN_ENABLE
+    btn_combo_cfg_t combo = {
+        .keys = {KEY_DOWN, KEY_OK},
+        .num = BTN_DOUBLE_KEY_CNT,
+        .type = BTN_COMBO_SIMULTANEOUS,
+    };
+#endif
+    uint32_t idle = BTN_MULTI_GAP_MS + 200;
+    uint32_t fail = 0;
+
+    lite_button_ctx_init(&g_ctx, 0);
+    lite_button_register_adc_ctx(&g_ctx, 0, adc_read, g_band, sizeof(g_band) / sizeof(g_band[0]));
+    for (size_t i = 0; i < 3; i++) {
+        lite_button_init_adc_ctx(&g_ctx, (key_id_e)i, 0, (uint8_t)i, &cfg, adc_key_cb, (void *)(uintptr_t)i);
+    }
+#if BTN_COMBO_FUN_ENABLE
+    lite_button_register_combos_ctx(&g_ctx, KEY_COMBO_COPY, &combo, adc_combo_cb, NULL);
+#endif
+
+    printf("poll %d ms, debounce %d ms, hysteresis %d, noise +-%d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_ADC_HYST, ADC_NOISE);
+    adc_hold(ADC_IDLE, ADC_NOISE, idle);
+
+    // click on UP, a single settling reading lands in the OK band on the way down
+    adc_hold(2000, 0, 1);
+    adc_hold(300, ADC_NOISE, 200);
+    adc_hold(ADC_IDLE, ADC_NOISE, idle);
+
+    // DOWN held while the reading drifts around its edge with OK
+    adc_hold(1000, ADC_NOISE, 100);
+    adc_hold(g_band[1].max, ADC_NOISE, 300);
+    adc_hold(ADC_IDLE, ADC_NOISE, idle);
+
+    // DOWN then OK on top of it: the pair band
+    adc_hold(1000, ADC_NOISE, 100);
+    adc_hold(2600, ADC_NOISE, 200);
+    adc_hold(ADC_IDLE, ADC_NOISE, idle);
+
+    // double click and long press on OK
+    adc_hold(1800, ADC_NOISE, 100);
+    adc_hold(ADC_IDLE, ADC_NOISE, 100);
+    adc_hold(1800, ADC_NOISE, 100);
+    adc_hold(ADC_IDLE, ADC_NOISE, idle);
+    adc_hold(1800, ADC_NOISE, ADC_LONGPRESS_MS + 200);
+    adc_hold(ADC_IDLE, ADC_NOISE, idle);
+
+    fail += adc_expect("up press", KEY_UP, BTN_EVT_PRESS, 1);
+    fail += adc_expect("up release", KEY_UP, BTN_EVT_RELEASE, 1);
+    fail += adc_expect("down press", KEY_DOWN, BTN_EVT_PRESS, 2);
+    // the OK presses of the pair, the double click and the long press
+    fail += adc_expect("ok press", KEY_OK, BTN_EVT_PRESS, 4);
+    fail += adc_expect("ok double", KEY_OK, BTN_EVT_DOUBLE, 1);
+#if BTN_LONGPRESS_FUN_ENABLE
+    fail += adc_expect("ok long", KEY_OK, BTN_EVT_LONG, 1);
+#endif
+#if BTN_COMBO_FUN_ENABLE
+    fail += adc_expect("combo", ADC_COMBO_ID + KEY_COMBO_COPY, BTN_EVT_COMBO, 1);
+#endif
+
+    return fail ? 1 : 0;
+}
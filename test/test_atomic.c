@@ -0,0 +1,282 @@
+/**
+ * @file    test_atomic.c
+ * @brief   EXTI handlers racing the poll on host threads (atomic mode).
+ *
+ * Each key has a thread of its own playing its EXTI handler: it pushes
+ * bouncing levels at random and now and then holds one long enough to be
+ * debounced. One more thread fires spurious triggers on all keys. The
+ * timer is a host thread running the poll handler, started and stopped by
+ * whichever thread owns it at the time. Every level held must be reported,
+ * press and release must alternate, and with all keys idle at the end the
+ * timer must stop.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "lite_button.h"
+
+#define AT_RUN_MS           (1500)
+#define AT_HOLD_MS          (40)    /* far beyond debounce, checked after it */
+#define AT_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+#define AT_TMR_STEP_US      (20)
+
+static lite_button_ctx_t g_ctx;
+static atomic_bool g_stop;
+static atomic_bool g_tmr_quit;
+
+/* reported by the poll: level, press and release counts, order errors */
+static atomic_int g_state[BTN_NUM];
+static atomic_uint g_press[BTN_NUM];
+static atomic_uint g_release[BTN_NUM];
+static atomic_uint g_order_err;
+static atomic_uint g_hold_cnt;
+static atomic_uint g_hold_err;
+
+/* emulated hardware timer, the mutex stands for its registers */
+static pthread_mutex_t g_tmr_mtx = PTHREAD_MUTEX_INITIALIZER;
+static btn_timer_arg_callback_cb_f g_tmr_cb = NULL;
+static void *g_tmr_arg = NULL;
+static bool g_tmr_on = false;
+static uint64_t g_tmr_start_us = 0;
+static uint64_t g_tmr_due_us = 0;
+static uint64_t g_tmr_period_us = 0;
+static atomic_uint g_tmr_fired;
+
+static uint64_t at_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000U + (uint64_t)ts.tv_nsec / 1000U;
+}
+
+static void at_sleep_us(uint32_t us)
+{
+    struct timespec ts;
+
+    ts.tv_sec = us / 1000000U;
+    ts.tv_nsec = (long)(us % 1000000U) * 1000L;
+    nanosleep(&ts, NULL);
+}
+
+static uint32_t at_rand(uint32_t *seed, uint32_t range)
+{
+    *seed = *seed * 1103515245U + 12345U;
+    return ((*seed >> 16) & 0x7FFF) % range;
+}
+
+static void at_key_cb(btn_evt_e evt, void *para)
+{
+    size_t i = (size_t)(uintptr_t)para;
+
+    switch (evt) {
+    case BTN_EVT_PRESS:
+        if (atomic_exchange(&g_state[i], 1) != 0) atomic_fetch_add(&g_order_err, 1);
+        atomic_fetch_add(&g_press[i], 1);
+        break;
+    case BTN_EVT_RELEASE:
+        if (atomic_exchange(&g_state[i], 0) != 1) atomic_fetch_add(&g_order_err, 1);
+        atomic_fetch_add(&g_release[i], 1);
+        break;
+    default:
+        break;
+    }
+}
+
+static void at_tmr_creat(btn_timer_arg_callback_cb_f cb, void *arg)
+{
+    g_tmr_cb = cb;
+    g_tmr_arg = arg;
+}
+
+static void at_tmr_start(uint32_t ms)
+{
+    pthread_mutex_lock(&g_tmr_mtx);
+    g_tmr_on = true;
+    g_tmr_start_us = at_now_us();
+    g_tmr_period_us = (uint64_t)ms * 1000U;
+    g_tmr_due_us = g_tmr_start_us + g_tmr_period_us;
+    pthread_mutex_unlock(&g_tmr_mtx);
+}
+
+static void at_tmr_stop(void)
+{
+    pthread_mutex_lock(&g_tmr_mtx);
+    g_tmr_on = false;
+    pthread_mutex_unlock(&g_tmr_mtx);
+}
+
+#if BTN_TICKLESS_FUN_ENABLE
+/* an expired one-shot reads as its full length */
+static uint32_t at_tmr_elapsed(void)
+{
+    uint64_t us = 0;
+
+    pthread_mutex_lock(&g_tmr_mtx);
+    us = MIN(at_now_us() - g_tmr_start_us, g_tmr_period_us);
+    pthread_mutex_unlock(&g_tmr_mtx);
+
+    return (uint32_t)(us / 1000U);
+}
+#endif
+
+static bool at_tmr_running(void)
+{
+    bool on = false;
+
+    pthread_mutex_lock(&g_tmr_mtx);
+    on = g_tmr_on;
+    pthread_mutex_unlock(&g_tmr_mtx);
+
+    return on;
+}
+
+static void *at_tmr_thread(void *arg)
+{
+    bool fire = false;
+
+    (void)arg;
+    while (!atomic_load(&g_tmr_quit)) {
+        pthread_mutex_lock(&g_tmr_mtx);
+        fire = g_tmr_on && at_now_us() >= g_tmr_due_us;
+        if (fire) {
+#if BTN_TICKLESS_FUN_ENABLE
+            g_tmr_on = false;
+#else
+            g_tmr_due_us += g_tmr_period_us;
+#endif
+        }
+        pthread_mutex_unlock(&g_tmr_mtx);
+
+        if (fire) {
+            atomic_fetch_add(&g_tmr_fired, 1);
+            g_tmr_cb(g_tmr_arg);
+        } else {
+            at_sleep_us(AT_TMR_STEP_US);
+        }
+    }
+
+    return NULL;
+}
+
+/* EXTI handler of one key: bursts of bounces, then a short or a long hold */
+static void *at_key_thread(void *arg)
+{
+    key_id_e i = (key_id_e)(uintptr_t)arg;
+    uint32_t seed = (uint32_t)i + 1;
+    bool active = false;
+
+    while (!atomic_load(&g_stop)) {
+        for (uint32_t n = at_rand(&seed, 8) + 1; n > 0; n--) {
+            active = !active;
+            lite_button_input_set_ctx(&g_ctx, i, active ? BTN_ACTIVE_LEVEL : BTN_IDLE_LEVEL);
+            at_sleep_us(at_rand(&seed, 50));
+        }
+        if (at_rand(&seed, 2) == 0) {
+            at_sleep_us(at_rand(&seed, 3000));
+            continue;
+        }
+
+        at_sleep_us(AT_HOLD_MS * 1000U);
+        atomic_fetch_add(&g_hold_cnt, 1);
+        if (atomic_load(&g_state[i]) != (int)active) {
+            printf("FAIL key %d held %s, not reported\n", (int)i, active ? "active" : "idle");
+            atomic_fetch_add(&g_hold_err, 1);
+        }
+    }
+
+    // leave the key released
+    lite_button_input_set_ctx(&g_ctx, i, BTN_IDLE_LEVEL);
+
+    return NULL;
+}
+
+/* triggers with no level change, a noisy line or a shared EXTI vector */
+static void *at_spurious_thread(void *arg)
+{
+    uint32_t seed = 99;
+
+    (void)arg;
+    while (!atomic_load(&g_stop)) {
+        lite_button_exti_trigger_ctx(&g_ctx, (key_id_e)at_rand(&seed, BTN_NUM));
+        at_sleep_us(at_rand(&seed, 20));
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = 0,
+        .longpress_repeat_ms = 0,
+    };
+    btn_timer_cb_t tmr = {
+        .start = at_tmr_start,
+        .stop = at_tmr_stop,
+#if BTN_TICKLESS_FUN_ENABLE
+        .elapsed = at_tmr_elapsed,
+#endif
+        .creat_arg = at_tmr_creat,
+    };
+    pthread_t tmr_th;
+    pthread_t spurious_th;
+    pthread_t key_th[BTN_NUM];
+    uint32_t fail = 0;
+
+    lite_button_ctx_init(&g_ctx, 0);
+    for (size_t i = 0; i < BTN_NUM; i++) {
+        lite_button_init_input_ctx(&g_ctx, (key_id_e)i, &cfg, at_key_cb, (void *)(uintptr_t)i);
+    }
+    lite_button_register_timer_ctx(&g_ctx, &tmr);
+
+    printf("poll %d ms, debounce %d ms, tickless %d, atomic %d, %d keys\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_TICKLESS_FUN_ENABLE, BTN_ATOMIC_FUN_ENABLE, BTN_NUM);
+
+    pthread_create(&tmr_th, NULL, at_tmr_thread, NULL);
+    pthread_create(&spurious_th, NULL, at_spurious_thread, NULL);
+    for (size_t i = 0; i < BTN_NUM; i++) {
+        pthread_create(&key_th[i], NULL, at_key_thread, (void *)(uintptr_t)i);
+    }
+
+    at_sleep_us(AT_RUN_MS * 1000U);
+    atomic_store(&g_stop, true);
+    pthread_join(spurious_th, NULL);
+    for (size_t i = 0; i < BTN_NUM; i++) {
+        pthread_join(key_th[i], NULL);
+    }
+    at_sleep_us(AT_IDLE_MS * 1000U);
+
+    for (size_t i = 0; i < BTN_NUM; i++) {
+        printf("key %zu: %u presses, %u releases\n", i,
+               atomic_load(&g_press[i]), atomic_load(&g_release[i]));
+        if (atomic_load(&g_state[i]) != 0 || atomic_load(&g_press[i]) != atomic_load(&g_release[i])) {
+            printf("FAIL key %zu left active\n", i);
+            fail++;
+        }
+    }
+    printf("holds %u, timer fired %u\n", atomic_load(&g_hold_cnt), atomic_load(&g_tmr_fired));
+    if (atomic_load(&g_hold_cnt) == 0) {
+        printf("FAIL no level held\n");
+        fail++;
+    }
+    if (atomic_load(&g_order_err) != 0) {
+        printf("FAIL %u press/release out of order\n", atomic_load(&g_order_err));
+        fail++;
+    }
+    fail += atomic_load(&g_hold_err);
+    // all keys idle, nothing keeps the timer going
+    if (at_tmr_running()) {
+        printf("FAIL timer still running\n");
+        fail++;
+    }
+
+    atomic_store(&g_tmr_quit, true);
+    pthread_join(tmr_th, NULL);
+
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file    test_combo.c
+ * @brief   Combos found through the sorted index.
+ *
+ * Keys 0 ~ 3 make up combos that share keys:
+ *
+ *   CB_PAIR    0 + 1       simultaneous
+ *   CB_TRIPLE  0 + 1 + 2   simultaneous, superset of CB_PAIR
+ *   CB_MID     1 + 2       simultaneous
+ *   CB_ORDER   2 then 3    sequential
+ *   CB_BOTH    2 + 3       simultaneous, same keys as CB_ORDER
+ *   CB_QUAD    0 ~ 3       simultaneous, with BTN_COMBO_KEY_MAX 4 or more
+ *
+ * They are registered out of order, and again the other way round every
+ * other run. Only the combo whose keys are held, no subset or superset of
+ * it, may fire; of the two with the same keys the lower id is tried first
+ * and the other only when it does not match.
+ * In stats mode two keys of no combo held for long must search the index
+ * once, when the held set changed, and stop at the first other mask.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define CB_RUNS             (4)
+#define CB_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+#define CB_HOLD_MS          (400)
+
+#define CB_PAIR             ((key_combo_id_e)0)
+#define CB_TRIPLE           ((key_combo_id_e)1)
+#define CB_MID              ((key_combo_id_e)2)
+#define CB_ORDER            ((key_combo_id_e)3)
+#define CB_BOTH             ((key_combo_id_e)4)
+#if BTN_COMBO_KEY_NUM >= 4
+#define CB_QUAD             ((key_combo_id_e)5)
+#define CB_NUM              (6)
+#else
+#define CB_NUM              (5)
+#endif
+
+typedef struct {
+    key_combo_id_e id;
+    btn_combo_cfg_t cfg;
+} cb_combo_t;
+
+static uint32_t g_phase = 0;    /* ms the presses are shifted by, per run */
+
+/* registration order, not by id or by keys */
+static const cb_combo_t g_combo[CB_NUM] = {
+    {CB_ORDER,  {{(key_id_e)2, (key_id_e)3}, BTN_DOUBLE_KEY_CNT, BTN_COMBO_SEQUENTIAL}},
+    {CB_TRIPLE, {{(key_id_e)0, (key_id_e)1, (key_id_e)2}, BTN_TRIPLE_KEY_CNT, BTN_COMBO_SIMULTANEOUS}},
+    {CB_MID,    {{(key_id_e)1, (key_id_e)2}, BTN_DOUBLE_KEY_CNT, BTN_COMBO_SIMULTANEOUS}},
+    {CB_BOTH,   {{(key_id_e)2, (key_id_e)3}, BTN_DOUBLE_KEY_CNT, BTN_COMBO_SIMULTANEOUS}},
+    {CB_PAIR,   {{(key_id_e)0, (key_id_e)1}, BTN_DOUBLE_KEY_CNT, BTN_COMBO_SIMULTANEOUS}},
+#if BTN_COMBO_KEY_NUM >= 4
+    {CB_QUAD,   {{(key_id_e)3, (key_id_e)2, (key_id_e)1, (key_id_e)0}, 4, BTN_COMBO_SIMULTANEOUS}},
+#endif
+};
+
+/* press the keys at the given offsets (ms), hold, release them together */
+static uint64_t cb_press(const key_id_e *keys, const uint32_t *at, size_t num, uint32_t hold_ms)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(CB_IDLE_MS) + SIM_MS(g_phase);
+
+    for (size_t k = 0; k < num; k++) {
+        btn_sim_edge(keys[k], t + SIM_MS(at[k]), true, 0);
+        btn_sim_edge(keys[k], t + SIM_MS(hold_ms), false, 0);
+    }
+    btn_sim_run(t + SIM_MS(hold_ms + CB_IDLE_MS));
+
+    return t;
+}
+
+/* only combo id fired since t, once */
+static void cb_expect_only(const char *name, uint64_t t, key_combo_id_e id)
+{
+    for (size_t c = 0; c < CB_NUM; c++) {
+        btn_sim_expect(name, BTN_SIM_COMBO_ID(c), BTN_EVT_COMBO, t, (c == (size_t)id) ? 1 : 0);
+    }
+}
+
+static void cb_scn_subset(void)
+{
+    static const key_id_e pair[] = {(key_id_e)0, (key_id_e)1};
+    static const key_id_e triple[] = {(key_id_e)0, (key_id_e)1, (key_id_e)2};
+    static const key_id_e mid[] = {(key_id_e)2, (key_id_e)1};
+#if BTN_COMBO_KEY_NUM >= 4
+    static const key_id_e quad[] = {(key_id_e)0, (key_id_e)1, (key_id_e)2, (key_id_e)3};
+#endif
+    static const uint32_t now[] = {0, 0, 0, 0};
+    static const uint32_t apart[] = {0, BTN_COMBO_GAP_MS / 2};
+
+    cb_expect_only("pair", cb_press(pair, apart, 2, CB_HOLD_MS), CB_PAIR);
+    // all three switch in the same poll, the held set is the superset
+    cb_expect_only("triple", cb_press(triple, now, 3, CB_HOLD_MS), CB_TRIPLE);
+    cb_expect_only("mid", cb_press(mid, apart, 2, CB_HOLD_MS), CB_MID);
+#if BTN_COMBO_KEY_NUM >= 4
+    // more keys than the default limit, a superset of every other combo
+    cb_expect_only("quad", cb_press(quad, now, 4, CB_HOLD_MS), CB_QUAD);
+#endif
+}
+
+static void cb_scn_same_keys(void)
+{
+    static const key_id_e order[] = {(key_id_e)2, (key_id_e)3};
+    static const key_id_e reverse[] = {(key_id_e)3, (key_id_e)2};
+    static const uint32_t apart[] = {0, BTN_COMBO_GAP_MS / 2};
+
+    // in order both match, the lower id wins
+    cb_expect_only("in order", cb_press(order, apart, 2, CB_HOLD_MS), CB_ORDER);
+    // out of order only the simultaneous one is left
+    cb_expect_only("reversed", cb_press(reverse, apart, 2, CB_HOLD_MS), CB_BOTH);
+}
+
+#if BTN_STATS_FUN_ENABLE
+/* two keys of no combo held long, the index is searched for the press only */
+static void cb_scn_lookups(void)
+{
+    static const key_id_e none[] = {(key_id_e)0, (key_id_e)3};
+    static const uint32_t apart[] = {0, BTN_COMBO_GAP_MS / 2};
+    btn_stats_t st = {0};
+    uint64_t t = 0;
+
+    lite_button_stats_reset();
+    t = cb_press(none, apart, 2, 2000);
+    lite_button_stats_get(&st);
+    for (size_t c = 0; c < CB_NUM; c++) {
+        btn_sim_expect("no combo", BTN_SIM_COMBO_ID(c), BTN_EVT_COMBO, t, 0);
+    }
+    // the second press is the only change with two keys held, its search ends at the next mask
+    if (st.combo_lookup != 1 || st.combo_scan > 1) {
+        printf("FAIL lookups %" PRIu32 ", entries tried %" PRIu32 "\n", st.combo_lookup, st.combo_scan);
+        btn_sim_fail();
+    }
+}
+#endif
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = 1000,
+        .longpress_repeat_ms = 0,
+    };
+
+    btn_sim_init(&cfg);
+
+    printf("poll %d ms, combo gap %d ms, exti %d, stats %d\n",
+           BTN_POLL_PERIOD_MS, BTN_COMBO_GAP_MS, BTN_EXTI_FUN_ENABLE, BTN_STATS_FUN_ENABLE);
+
+    for (uint32_t n = 0; n < CB_RUNS; n++) {
+        g_phase = n * 7;
+        // registered again every run, every other time the other way round
+        for (size_t c = 0; c < CB_NUM; c++) {
+            btn_sim_register_combo(g_combo[(n & 1) ? CB_NUM - 1 - c : c].id,
+                                   &g_combo[(n & 1) ? CB_NUM - 1 - c : c].cfg);
+        }
+        cb_scn_subset();
+        cb_scn_same_keys();
+#if BTN_STATS_FUN_ENABLE
+        cb_scn_lookups();
+#endif
+    }
+
+    return btn_sim_result();
+}
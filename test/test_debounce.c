@@ -0,0 +1,120 @@
+/**
+ * @file    test_debounce.c
+ * @brief   Adaptive debounce learning the bounce profile of each key.
+ *
+ * KEY_UP is a clean switch, KEY_DOWN bounces for several milliseconds on
+ * every edge. Repeated clicks must take the window of the clean key down
+ * to BTN_DEBOUNCE_MIN_MS, with its press latency, and keep the noisy one
+ * over its bounce, without a single extra event. Then the clean key wears
+ * out and drops out for a while right after making contact: after at most
+ * one chattering click its window must cover the dropout.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define DEB_CLICKS          (30)
+#define DEB_HOLD_MS         (150)
+#define DEB_NOISY_BOUNCE    (12)            /* up to ~10 ms of contact bounce */
+#define DEB_CONTACT_MS      (BTN_DEBOUNCE_MIN_MS + 2)
+#define DEB_DROPOUT_MS      (BTN_DEBOUNCE_MIN_MS * 2)
+#define DEB_WORN_CLICKS     (8)
+#define DEB_IDLE_MS         (BTN_MULTI_GAP_MS + 100)
+
+/* one click, press latency returned */
+static uint64_t deb_click(key_id_e key, uint32_t bounce)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(DEB_IDLE_MS);
+    uint64_t end = 0;
+
+    btn_sim_edge(key, t, true, bounce);
+    end = btn_sim_edge(key, t + SIM_MS(DEB_HOLD_MS), false, bounce);
+    btn_sim_run(end + SIM_MS(DEB_IDLE_MS));
+
+    return btn_sim_find(key, BTN_EVT_PRESS, t) - t;
+}
+
+/* worn contact: makes, drops out, then makes for good */
+static void deb_worn_click(key_id_e key)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(DEB_IDLE_MS);
+    uint64_t end = 0;
+
+    btn_sim_edge(key, t, true, 0);
+    btn_sim_edge(key, t + SIM_MS(DEB_CONTACT_MS), false, 0);
+    btn_sim_edge(key, t + SIM_MS(DEB_CONTACT_MS + DEB_DROPOUT_MS), true, 0);
+    end = btn_sim_edge(key, t + SIM_MS(DEB_HOLD_MS), false, 0);
+    btn_sim_run(end + SIM_MS(DEB_IDLE_MS));
+}
+
+static uint32_t deb_expect(const char *name, uint32_t id, btn_evt_e evt, uint64_t from, size_t num)
+{
+    size_t cnt = btn_sim_count(id, evt, from, btn_sim_now());
+
+    printf("%-14s %zu\n", name, cnt);
+    if (cnt == num) return 0;
+    printf("FAIL %s: %zu events, expected %zu\n", name, cnt, num);
+    return 1;
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = 0,
+        .longpress_repeat_ms = 0,
+    };
+    uint64_t lat_first = 0;
+    uint64_t lat_last = 0;
+    uint64_t from = 0;
+    uint32_t fail = 0;
+
+    btn_sim_init(&cfg);
+    printf("poll %d ms, debounce %d ms (%d ~ %d), exti %d, timestamp %d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_DEBOUNCE_MIN_MS, BTN_DEBOUNCE_MAX_MS,
+           BTN_EXTI_FUN_ENABLE, BTN_TIMESTAMP_FUN_ENABLE);
+
+    for (uint32_t n = 0; n < DEB_CLICKS; n++) {
+        lat_last = deb_click(KEY_UP, 0);
+        if (n == 0) lat_first = lat_last;
+        deb_click(KEY_DOWN, DEB_NOISY_BOUNCE);
+    }
+    printf("clean %u ms, press latency %" PRIu64 " -> %" PRIu64 " us\n",
+           lite_button_debounce_get(KEY_UP), lat_first, lat_last);
+    printf("noisy %u ms\n", lite_button_debounce_get(KEY_DOWN));
+
+    fail += deb_expect("clean press", KEY_UP, BTN_EVT_PRESS, 0, DEB_CLICKS);
+    fail += deb_expect("clean release", KEY_UP, BTN_EVT_RELEASE, 0, DEB_CLICKS);
+    fail += deb_expect("noisy press", KEY_DOWN, BTN_EVT_PRESS, 0, DEB_CLICKS);
+    fail += deb_expect("noisy release", KEY_DOWN, BTN_EVT_RELEASE, 0, DEB_CLICKS);
+    if (lite_button_debounce_get(KEY_UP) > BTN_DEBOUNCE_MIN_MS) {
+        printf("FAIL clean key window not at its minimum\n");
+        fail++;
+    }
+    if (lite_button_debounce_get(KEY_DOWN) <= lite_button_debounce_get(KEY_UP)) {
+        printf("FAIL noisy key window not above the clean one\n");
+        fail++;
+    }
+    if (lat_last >= lat_first) {
+        printf("FAIL clean key press latency did not drop\n");
+        fail++;
+    }
+
+    // the first worn click may chatter, the window must then cover the dropout
+    deb_worn_click(KEY_UP);
+    deb_worn_click(KEY_UP);
+    from = btn_sim_now();
+    for (uint32_t n = 0; n < DEB_WORN_CLICKS; n++) {
+        deb_worn_click(KEY_UP);
+    }
+    printf("worn %u ms\n", lite_button_debounce_get(KEY_UP));
+    fail += deb_expect("worn press", KEY_UP, BTN_EVT_PRESS, from, DEB_WORN_CLICKS);
+    fail += deb_expect("worn release", KEY_UP, BTN_EVT_RELEASE, from, DEB_WORN_CLICKS);
+    if (lite_button_debounce_get(KEY_UP) < DEB_DROPOUT_MS) {
+        printf("FAIL worn key window below its dropout\n");
+        fail++;
+    }
+
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,307 @@
+/**
+ * @file    test_latency.c
+ * @brief   Event detection latency on scripted bouncing waveforms.
+ *
+ * Every scenario is replayed at one phase per millisecond of the poll
+ * period. Latency is measured from the first edge of the action that
+ * completes the event (the press for press/combo, the release for
+ * release/double/triple, press + long press time for long) to the moment
+ * the callback runs. A missing event, a glitch reported as a press or a
+ * latency over the bound fails the run. In stats mode the library counters
+ * must match the simulation and stay within the same bound. In event mask
+ * mode keys subscribed to press and long press only must report nothing
+ * else.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define SIM_BOUNCE          (3)             /* up to ~5 ms of contact bounce */
+#define SIM_LONGPRESS_MS    (800)
+#define SIM_IDLE_MS         (BTN_MULTI_GAP_MS + 500)
+/* debounce, up to two polls of sampling delay and the bounce itself */
+#define SIM_LATENCY_MAX     SIM_MS(BTN_DEBOUNCE_MS + 2 * BTN_POLL_PERIOD_MS + 5)
+
+typedef struct {
+    uint32_t id;
+    btn_evt_e evt;
+    uint64_t ref;       /* time the event is due at the earliest */
+    uint64_t end;       /* time the scenario is over */
+} sim_expect_t;
+
+typedef struct {
+    const char *name;
+    void (*script)(uint64_t t, sim_expect_t *exp);
+    uint32_t runs;
+    uint32_t fail;
+    uint64_t lat_min;
+    uint64_t lat_max;
+    uint64_t lat_sum;
+} sim_case_t;
+
+static uint64_t sim_click(key_id_e key, uint64_t t, uint32_t hold_ms)
+{
+    btn_sim_edge(key, t, true, SIM_BOUNCE);
+    return btn_sim_edge(key, t + SIM_MS(hold_ms), false, SIM_BOUNCE);
+}
+
+static void scn_press(uint64_t t, sim_expect_t *exp)
+{
+    exp->id = KEY_OK;
+    exp->evt = BTN_EVT_PRESS;
+    exp->ref = t;
+    exp->end = sim_click(KEY_OK, t, 200);
+}
+
+static void scn_release(uint64_t t, sim_expect_t *exp)
+{
+    exp->id = KEY_OK;
+    exp->evt = BTN_EVT_RELEASE;
+    exp->ref = t + SIM_MS(200);
+    exp->end = sim_click(KEY_OK, t, 200);
+}
+
+static void scn_long(uint64_t t, sim_expect_t *exp)
+{
+    exp->id = KEY_UP;
+    exp->evt = BTN_EVT_LONG;
+    exp->ref = t + SIM_MS(SIM_LONGPRESS_MS);
+    exp->end = sim_click(KEY_UP, t, SIM_LONGPRESS_MS + 300);
+}
+
+static void scn_double(uint64_t t, sim_expect_t *exp)
+{
+    sim_click(KEY_DOWN, t, 80);
+    exp->id = KEY_DOWN;
+    exp->evt = BTN_EVT_DOUBLE;
+    exp->ref = t + SIM_MS(200 + 80);
+    exp->end = sim_click(KEY_DOWN, t + SIM_MS(200), 80);
+}
+
+static void scn_triple(uint64_t t, sim_expect_t *exp)
+{
+    sim_click(KEY_DOWN, t, 80);
+    sim_click(KEY_DOWN, t + SIM_MS(200), 80);
+    exp->id = KEY_DOWN;
+    exp->evt = BTN_EVT_TRIPLE;
+    exp->ref = t + SIM_MS(400 + 80);
+    exp->end = sim_click(KEY_DOWN, t + SIM_MS(400), 80);
+}
+
+#if BTN_COMBO_FUN_ENABLE
+static void scn_combo(uint64_t t, sim_expect_t *exp)
+{
+    sim_click(KEY_UP, t, 300);
+    sim_click(KEY_DOWN, t + SIM_MS(30), 270);
+    exp->id = BTN_SIM_COMBO_ID(KEY_COMBO_SCREENSHOT);
+    exp->evt = BTN_EVT_COMBO;
+    exp->ref = t + SIM_MS(60);
+    exp->end = sim_click(KEY_OK, t + SIM_MS(60), 240);
+}
+#endif
+
+#define SIM_CASE(name, script)  {name, script, 0, 0, 0, 0, 0}
+
+static sim_case_t g_cases[] = {
+    SIM_CASE("press", scn_press),
+    SIM_CASE("release", scn_release),
+    SIM_CASE("long", scn_long),
+    SIM_CASE("double", scn_double),
+    SIM_CASE("triple", scn_triple),
+#if BTN_COMBO_FUN_ENABLE
+    SIM_CASE("combo", scn_combo),
+#endif
+};
+
+static void sim_case_run(sim_case_t *c, uint64_t phase)
+{
+    sim_expect_t exp = {0};
+    uint64_t t = btn_sim_now() + SIM_MS(SIM_IDLE_MS) + phase;
+    uint64_t at = 0;
+    uint64_t lat = 0;
+
+    btn_sim_log_clear();
+    c->script(t, &exp);
+    btn_sim_run(exp.end + SIM_MS(SIM_IDLE_MS));
+
+    at = btn_sim_find(exp.id, exp.evt, t);
+    c->runs++;
+    if (at == UINT64_MAX || at < exp.ref || at - exp.ref > SIM_LATENCY_MAX) {
+        printf("FAIL %-8s phase %" PRIu64 " us: event at %" PRIu64 ", due %" PRIu64 "\n",
+               c->name, phase, at, exp.ref);
+        c->fail++;
+        return;
+    }
+
+    lat = at - exp.ref;
+    if (c->runs - c->fail == 1 || lat < c->lat_min) c->lat_min = lat;
+    if (lat > c->lat_max) c->lat_max = lat;
+    c->lat_sum += lat;
+}
+
+/* a pulse shorter than both the debounce time and the poll period */
+static uint32_t sim_glitch_run(uint64_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(SIM_IDLE_MS) + phase;
+    uint64_t end = 0;
+
+    btn_sim_log_clear();
+    btn_sim_edge(KEY_OK, t, true, 0);
+    end = btn_sim_edge(KEY_OK, t + SIM_MS(MIN(BTN_DEBOUNCE_MS, BTN_POLL_PERIOD_MS)) / 2, false, 0);
+    btn_sim_run(end + SIM_MS(SIM_IDLE_MS));
+
+    return (uint32_t)btn_sim_count(KEY_OK, BTN_EVT_PRESS, t, btn_sim_now());
+}
+
+#if BTN_STATS_FUN_ENABLE
+static uint32_t sim_stats_check(void)
+{
+    const btn_sim_stat_t *st = btn_sim_stat_get();
+    const btn_key_stats_t *ks = NULL;
+    btn_stats_t stats;
+    uint32_t lat_max_ms = (uint32_t)(SIM_LATENCY_MAX / 1000U);
+    uint32_t fail = 0;
+    uint32_t det = 0;
+
+    if (!lite_button_stats_get(&stats)) {
+        printf("FAIL stats snapshot\n");
+        return 1;
+    }
+    printf("stats polls %u, poll time min %u avg %.1f max %u ns, timer %u/%u, combo %u/%u\n",
+           stats.poll_cnt, stats.poll_min,
+           stats.poll_cnt ? (double)stats.poll_sum / stats.poll_cnt : 0.0, stats.poll_max,
+           stats.tmr_start, stats.tmr_stop, stats.combo_lookup, stats.combo_scan);
+    if (stats.poll_cnt != st->polls) {
+        printf("FAIL stats polls %u, simulated %" PRIu64 "\n", stats.poll_cnt, st->polls);
+        fail++;
+    }
+#if BTN_EXTI_FUN_ENABLE
+    if (stats.tmr_start == 0) {
+        printf("FAIL stats no timer start\n");
+        fail++;
+    }
+#endif
+
+    for (size_t i = 0; i < BTN_NUM; i++) {
+        ks = &stats.key[i];
+        det = 0;
+        printf("key %zu bounce %u, cb %u max %u ns, latency", i, ks->bounce, ks->cb_cnt, ks->cb_max);
+        for (size_t n = 0; n < BTN_STATS_LAT_BINS; n++) {
+            printf(" %u", ks->lat_hist[n]);
+            det += ks->lat_hist[n];
+            // bin n starts at 2^(n-1) ms
+            if (n != 0 && ks->lat_hist[n] != 0 && BIT(n - 1) > lat_max_ms) fail++;
+        }
+        printf("\n");
+        if (det == 0 || ks->cb_cnt < det) {
+            printf("FAIL stats key %zu: %u switches, %u callbacks\n", i, det, ks->cb_cnt);
+            fail++;
+        }
+    }
+
+    return fail;
+}
+#endif
+
+#if BTN_EVT_MASK_FUN_ENABLE
+static uint32_t sim_mask_check(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = SIM_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+        .evt_mask = BTN_EVT_BIT(BTN_EVT_PRESS) | BTN_EVT_BIT(BTN_EVT_LONG),
+    };
+    uint64_t t = btn_sim_now() + SIM_MS(SIM_IDLE_MS);
+    uint64_t end = 0;
+    size_t num = 0;
+    uint32_t fail = 0;
+
+    btn_sim_init(&cfg);
+    btn_sim_log_clear();
+    sim_click(KEY_DOWN, t, 80);
+    end = sim_click(KEY_DOWN, t + SIM_MS(200), 80);
+    end = sim_click(KEY_UP, end + SIM_MS(SIM_IDLE_MS), SIM_LONGPRESS_MS + 300);
+    btn_sim_run(end + SIM_MS(SIM_IDLE_MS));
+
+    // two presses and one long press, no release or double click
+    btn_sim_log_get(&num);
+    if (btn_sim_count(KEY_DOWN, BTN_EVT_PRESS, t, btn_sim_now()) != 2 ||
+        btn_sim_count(KEY_UP, BTN_EVT_PRESS, t, btn_sim_now()) != 1 ||
+        btn_sim_count(KEY_UP, BTN_EVT_LONG, t, btn_sim_now()) != 1 || num != 4) {
+        printf("FAIL mask: %zu events\n", num);
+        fail++;
+    }
+    printf("mask     %5zu events\n", num);
+
+    return fail;
+}
+#endif
+
+int main(void)
+{
+    const btn_sim_stat_t *st = NULL;
+    btn_cfg_t cfg = {
+        .longpress_ms = SIM_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+    };
+    btn_combo_cfg_t combo = {
+        .keys = {KEY_UP, KEY_DOWN, KEY_OK},
+        .num = BTN_TRIPLE_KEY_CNT,
+        .type = BTN_COMBO_SIMULTANEOUS,
+    };
+    uint32_t glitch = 0;
+    uint32_t fail = 0;
+    sim_case_t *c = NULL;
+
+    btn_sim_init(&cfg);
+    btn_sim_register_combo(KEY_COMBO_SCREENSHOT, &combo);
+
+    printf("poll %d ms, debounce %d ms, exti %d, tickless %d, timestamp %d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_EXTI_FUN_ENABLE,
+           BTN_TICKLESS_FUN_ENABLE, BTN_TIMESTAMP_FUN_ENABLE);
+    printf("%-8s %5s %5s %9s %9s %9s\n", "event", "runs", "fail", "min(ms)", "avg(ms)", "max(ms)");
+
+    for (size_t n = 0; n < sizeof(g_cases) / sizeof(g_cases[0]); n++) {
+        c = &g_cases[n];
+        // one run per ms of poll phase, off the ms grid
+        for (uint32_t p = 0; p < BTN_POLL_PERIOD_MS; p++) {
+            sim_case_run(c, SIM_MS(p) + 137U);
+        }
+        fail += c->fail;
+        if (c->runs == c->fail) {
+            printf("%-8s %5u %5u %9s %9s %9s\n", c->name, c->runs, c->fail, "-", "-", "-");
+            continue;
+        }
+        printf("%-8s %5u %5u %9.3f %9.3f %9.3f\n", c->name, c->runs, c->fail,
+               c->lat_min / 1000.0, c->lat_sum / 1000.0 / (c->runs - c->fail), c->lat_max / 1000.0);
+    }
+
+#if (BTN_DEBOUNCE_MS >= BTN_POLL_PERIOD_MS)
+    for (uint32_t p = 0; p < BTN_POLL_PERIOD_MS; p++) {
+        glitch += sim_glitch_run(SIM_MS(p) + 137U);
+    }
+    printf("glitch   %5d %5u\n", BTN_POLL_PERIOD_MS, glitch);
+    fail += glitch;
+#endif
+
+#if BTN_STATS_FUN_ENABLE
+    fail += sim_stats_check();
+#endif
+#if BTN_EVT_MASK_FUN_ENABLE
+    fail += sim_mask_check();
+#endif
+
+    st = btn_sim_stat_get();
+#if BTN_EVT_BATCH_FUN_ENABLE
+    // a poll detects a handful of events at most, one call takes them all
+    printf("batches %" PRIu64 ", split %" PRIu64 "\n", st->batches, st->batch_split);
+    if (st->batches == 0 || st->batch_split != 0) fail++;
+#endif
+    printf("polls %" PRIu64 ", wakeups %" PRIu64 ", exti %" PRIu64 ", poll time avg %.1f ns max %" PRIu64 " ns\n",
+           st->polls, st->wakeups, st->exti,
+           st->polls ? (double)st->poll_ns / (double)st->polls : 0.0, st->poll_ns_max);
+
+    return fail ? 1 : 0;
+}
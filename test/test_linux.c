@@ -0,0 +1,260 @@
+/**
+ * @file    test_linux.c
+ * @brief   Linux backend fed from pipes and a socketpair.
+ *
+ * Recorded evdev, GPIO v1 and GPIO v2 event streams are written in real
+ * time by the same thread that runs btn_linux_wait(), with contact bounce,
+ * key autorepeats and records split across writes. Every key must report
+ * its gesture exactly once. In tickless mode the backend must sleep
+ * through an idle second, and a closed writer must drop its source.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "lite_button_linux.h"
+/* after lite_button_cfg.h, evdev key codes share names with its key ids */
+#include <linux/input.h>
+#include <linux/gpio.h>
+
+#define LX_LOG_MAX          (64)
+#define LX_LONGPRESS_MS     (300)
+#define LX_IDLE_MS          (BTN_MULTI_GAP_MS + 200)
+
+#define LX_EVDEV_ENTER      (28)    /* KEY_ENTER */
+#define LX_GPIO_V1_LINE     (5)
+#define LX_GPIO_V2_LINE     (17)
+
+/* key ids by number, the cfg names are taken over by linux/input.h */
+#define LX_KEY_V2           ((key_id_e)0)   /* KEY_UP */
+#define LX_KEY_V1           ((key_id_e)1)   /* KEY_DOWN */
+#define LX_KEY_EVDEV        ((key_id_e)2)   /* KEY_OK */
+
+typedef struct {
+    key_id_e key;
+    btn_evt_e evt;
+} lx_evt_t;
+
+static lite_button_ctx_t g_ctx;
+static btn_linux_t g_lx;
+static lx_evt_t g_log[LX_LOG_MAX];
+static size_t g_log_num = 0;
+
+static const btn_linux_map_t g_map_evdev[] = {
+    {LX_EVDEV_ENTER, LX_KEY_EVDEV},
+};
+static const btn_linux_map_t g_map_v1[] = {
+    {LX_GPIO_V1_LINE, LX_KEY_V1},
+};
+static const btn_linux_map_t g_map_v2[] = {
+    {LX_GPIO_V2_LINE, LX_KEY_V2},
+};
+
+static void lx_key_cb(btn_evt_e evt, void *para)
+{
+    if (g_log_num >= LX_LOG_MAX) return;
+    g_log[g_log_num].key = (key_id_e)(uintptr_t)para;
+    g_log[g_log_num].evt = evt;
+    g_log_num++;
+}
+
+static uint64_t lx_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000U + (uint64_t)ts.tv_nsec / 1000000U;
+}
+
+/* serve the backend for the given time */
+static void lx_run(uint32_t ms)
+{
+    uint64_t end = lx_now_ms() + ms;
+    uint64_t now = 0;
+
+    while ((now = lx_now_ms()) < end) {
+        btn_linux_wait(&g_lx, (int)(end - now));
+#if BTN_EVT_QUEUE_FUN_ENABLE
+        lite_button_dispatch_ctx(&g_ctx);
+#endif
+    }
+}
+
+static void lx_write(int fd, const void *rec, size_t len)
+{
+    if (write(fd, rec, len) != (ssize_t)len) perror("write");
+}
+
+static void lx_evdev(int fd, uint16_t type, uint16_t code, int32_t value)
+{
+    struct input_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    lx_write(fd, &ev, sizeof(ev));
+}
+
+static void lx_key(int fd, int32_t value)
+{
+    lx_evdev(fd, EV_KEY, LX_EVDEV_ENTER, value);
+    lx_evdev(fd, EV_SYN, SYN_REPORT, 0);
+}
+
+static void lx_gpio_v1(int fd, bool pressed)
+{
+    struct gpioevent_data ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.id = pressed ? GPIOEVENT_EVENT_FALLING_EDGE : GPIOEVENT_EVENT_RISING_EDGE;
+    lx_write(fd, &ev, sizeof(ev));
+}
+
+/* the record goes out in two writes, the backend must join them */
+static void lx_gpio_v2(int fd, bool pressed)
+{
+    struct gpio_v2_line_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.id = pressed ? GPIO_V2_LINE_EVENT_FALLING_EDGE : GPIO_V2_LINE_EVENT_RISING_EDGE;
+    ev.offset = LX_GPIO_V2_LINE;
+    lx_write(fd, &ev, 10);
+    lx_run(1);
+    lx_write(fd, (const uint8_t *)&ev + 10, sizeof(ev) - 10);
+}
+
+static size_t lx_count(key_id_e key, btn_evt_e evt)
+{
+    size_t cnt = 0;
+
+    for (size_t n = 0; n < g_log_num; n++) {
+        if (g_log[n].key == key && g_log[n].evt == evt) cnt++;
+    }
+
+    return cnt;
+}
+
+static uint32_t lx_expect(const char *name, key_id_e key, btn_evt_e evt, size_t num)
+{
+    size_t cnt = lx_count(key, evt);
+
+    printf("%-8s %zu\n", name, cnt);
+    if (cnt == num) return 0;
+    printf("FAIL %s: %zu events, expected %zu\n", name, cnt, num);
+    return 1;
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = LX_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+    };
+    int evdev[2] = {-1, -1};
+    int v1[2] = {-1, -1};
+    int v2[2] = {-1, -1};
+    int tfd = -1;
+    uint32_t fail = 0;
+
+    lite_button_ctx_init(&g_ctx, 0);
+    for (size_t i = 0; i < 3; i++) {
+        lite_button_init_input_ctx(&g_ctx, (key_id_e)i, &cfg, lx_key_cb, (void *)(uintptr_t)i);
+    }
+    if (pipe(evdev) != 0 || pipe(v1) != 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, v2) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    if (btn_linux_init(&g_lx, &g_ctx) != 0 ||
+        btn_linux_add(&g_lx, evdev[0], BTN_LINUX_EVDEV, g_map_evdev, 1) != 0 ||
+        btn_linux_add(&g_lx, v1[0], BTN_LINUX_GPIO_V1, g_map_v1, 1) != 0 ||
+        btn_linux_add(&g_lx, v2[0], BTN_LINUX_GPIO_V2, g_map_v2, 1) != 0) {
+        perror("btn_linux");
+        return 1;
+    }
+    if (btn_linux_init(&g_lx, &g_ctx) == 0) {
+        printf("FAIL second backend\n");
+        fail++;
+    }
+
+    printf("exti %d, tickless %d, timestamp %d\n",
+           BTN_EXTI_FUN_ENABLE, BTN_TICKLESS_FUN_ENABLE, BTN_TIMESTAMP_FUN_ENABLE);
+
+    // evdev: bouncing click with autorepeats while held
+    lx_key(evdev[1], 1);
+    lx_run(1);
+    lx_key(evdev[1], 0);
+    lx_run(1);
+    lx_key(evdev[1], 1);
+    lx_run(100);
+    lx_key(evdev[1], 2);
+    lx_run(50);
+    lx_key(evdev[1], 0);
+    lx_run(LX_IDLE_MS);
+
+    // GPIO v2: double click, records split across writes
+    lx_gpio_v2(v2[1], true);
+    lx_run(80);
+    lx_gpio_v2(v2[1], false);
+    lx_run(120);
+    lx_gpio_v2(v2[1], true);
+    lx_run(80);
+    lx_gpio_v2(v2[1], false);
+    lx_run(LX_IDLE_MS);
+
+    // GPIO v1: long press
+    lx_gpio_v1(v1[1], true);
+    lx_run(LX_LONGPRESS_MS + 200);
+    lx_gpio_v1(v1[1], false);
+    lx_run(LX_IDLE_MS);
+
+    fail += lx_expect("press", LX_KEY_EVDEV, BTN_EVT_PRESS, 1);
+    fail += lx_expect("release", LX_KEY_EVDEV, BTN_EVT_RELEASE, 1);
+    fail += lx_expect("double", LX_KEY_V2, BTN_EVT_DOUBLE, 1);
+    fail += lx_expect("long", LX_KEY_V1, BTN_EVT_LONG, 1);
+
+#if BTN_TICKLESS_FUN_ENABLE
+    // all keys idle, nothing may wake the thread
+    if (btn_linux_wait(&g_lx, 1000) != 0) {
+        printf("FAIL idle wakeup\n");
+        fail++;
+    }
+#endif
+
+    close(v1[1]);
+    for (int n = 0; n < 10 && g_lx.src[1].fd >= 0; n++) {
+        btn_linux_wait(&g_lx, 100);
+    }
+    if (g_lx.src[1].fd >= 0) {
+        printf("FAIL closed source kept\n");
+        fail++;
+    }
+
+#if BTN_EXTI_FUN_ENABLE
+    // the edge arms the timer, a timerfd that cannot take it must be reported
+    tfd = g_lx.tfd;
+    g_lx.tfd = -1;
+    lx_key(evdev[1], 1);
+    errno = 0;
+    if (btn_linux_wait(&g_lx, 100) != -1 || errno != EBADF) {
+        printf("FAIL timer error not reported\n");
+        fail++;
+    }
+    g_lx.tfd = tfd;
+#else
+    (void)tfd;
+#endif
+
+    btn_linux_deinit(&g_lx);
+    close(evdev[0]);
+    close(evdev[1]);
+    close(v1[0]);
+    close(v2[0]);
+    close(v2[1]);
+
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file    test_lockout.c
+ * @brief   Zero latency press of lockout keys next to integrated ones.
+ *
+ * KEY_UP is set up in lockout mode, KEY_DOWN debounces as usual and gets
+ * the same waveforms at the same time, at a range of poll phases. The
+ * lockout key must report its press within one poll of the contact
+ * settling, ahead of the integrated one, and its long press one long press
+ * time after the contact. Bouncing clicks, a tap shorter than the lockout
+ * and a double click must be reported exactly once each.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define LK_RUNS             (BTN_POLL_PERIOD_MS)    /* one poll phase per ms */
+#define LK_BOUNCE           (8)                     /* up to ~6 ms of contact bounce */
+#define LK_LONGPRESS_MS     (600)
+#define LK_TAP_MS           (BTN_POLL_PERIOD_MS + 5)
+#define LK_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+
+static uint64_t g_lat_max[2] = {0};
+
+/* both keys pressed at t, released after hold_ms; returns when it settles */
+static uint64_t lk_click(uint64_t t, uint32_t hold_ms, uint32_t bounce)
+{
+    uint64_t end = 0;
+
+    btn_sim_edge(KEY_UP, t, true, bounce);
+    btn_sim_edge(KEY_DOWN, t, true, bounce);
+    btn_sim_edge(KEY_UP, t + SIM_MS(hold_ms), false, bounce);
+    end = btn_sim_edge(KEY_DOWN, t + SIM_MS(hold_ms), false, bounce);
+
+    return end;
+}
+
+static void lk_scn_click(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(LK_IDLE_MS) + SIM_MS(phase);
+    uint64_t settle = btn_sim_edge(KEY_UP, t, true, LK_BOUNCE);
+    uint64_t lat[2] = {0};
+
+    btn_sim_edge(KEY_DOWN, t, true, LK_BOUNCE);
+    btn_sim_edge(KEY_UP, t + SIM_MS(100), false, LK_BOUNCE);
+    btn_sim_run(btn_sim_edge(KEY_DOWN, t + SIM_MS(100), false, LK_BOUNCE) + SIM_MS(LK_IDLE_MS));
+
+    btn_sim_expect("click press", KEY_UP, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("click release", KEY_UP, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("click press", KEY_DOWN, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("click release", KEY_DOWN, BTN_EVT_RELEASE, t, 1);
+
+    lat[0] = btn_sim_find(KEY_UP, BTN_EVT_PRESS, t) - t;
+    lat[1] = btn_sim_find(KEY_DOWN, BTN_EVT_PRESS, t) - t;
+    g_lat_max[0] = MAX(g_lat_max[0], lat[0]);
+    g_lat_max[1] = MAX(g_lat_max[1], lat[1]);
+    // the first active sample, one poll after the bounce at the latest
+    if (lat[0] > settle - t + SIM_MS(BTN_POLL_PERIOD_MS)) {
+        printf("FAIL phase %u: press after %" PRIu64 " us\n", phase, lat[0]);
+        btn_sim_fail();
+    }
+}
+
+static void lk_scn_long(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(LK_IDLE_MS) + SIM_MS(phase);
+    uint64_t settle = btn_sim_edge(KEY_UP, t, true, LK_BOUNCE);
+    uint64_t lp = 0;
+
+    btn_sim_edge(KEY_DOWN, t, true, LK_BOUNCE);
+    btn_sim_edge(KEY_UP, t + SIM_MS(LK_LONGPRESS_MS + 300), false, LK_BOUNCE);
+    btn_sim_run(btn_sim_edge(KEY_DOWN, t + SIM_MS(LK_LONGPRESS_MS + 300), false, LK_BOUNCE) +
+                SIM_MS(LK_IDLE_MS));
+
+    btn_sim_expect("long", KEY_UP, BTN_EVT_LONG, t, 1);
+    btn_sim_expect("long", KEY_DOWN, BTN_EVT_LONG, t, 1);
+
+    // timed from the press, which came with the contact
+    lp = btn_sim_find(KEY_UP, BTN_EVT_LONG, t) - t;
+    if (lp > SIM_MS(LK_LONGPRESS_MS + BTN_POLL_PERIOD_MS) + settle - t) {
+        printf("FAIL phase %u: long press after %" PRIu64 " us\n", phase, lp);
+        btn_sim_fail();
+    }
+}
+
+/* released while still locked out, the release waits for the window to end */
+static void lk_scn_tap(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(LK_IDLE_MS) + SIM_MS(phase);
+
+    btn_sim_run(lk_click(t, LK_TAP_MS, 2) + SIM_MS(LK_IDLE_MS));
+    btn_sim_expect("tap press", KEY_UP, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("tap release", KEY_UP, BTN_EVT_RELEASE, t, 1);
+}
+
+static void lk_scn_double(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(LK_IDLE_MS) + SIM_MS(phase);
+
+    lk_click(t, 80, LK_BOUNCE);
+    btn_sim_run(lk_click(t + SIM_MS(200), 80, LK_BOUNCE) + SIM_MS(LK_IDLE_MS));
+    btn_sim_expect("double press", KEY_UP, BTN_EVT_PRESS, t, 2);
+    btn_sim_expect("double", KEY_UP, BTN_EVT_DOUBLE, t, 1);
+    btn_sim_expect("double", KEY_DOWN, BTN_EVT_DOUBLE, t, 1);
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = LK_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+    };
+
+    btn_sim_init(&cfg);
+    cfg.deb_mode = BTN_DEB_LOCKOUT;
+    btn_sim_key_cfg(KEY_UP, &cfg);
+
+    printf("poll %d ms, debounce %d ms, lockout %d ms, exti %d, timestamp %d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_LOCKOUT_MS,
+           BTN_EXTI_FUN_ENABLE, BTN_TIMESTAMP_FUN_ENABLE);
+
+    for (uint32_t n = 0; n < LK_RUNS; n++) {
+        lk_scn_click(n);
+        lk_scn_long(n);
+        lk_scn_tap(n);
+        lk_scn_double(n);
+    }
+
+    printf("press latency max: lockout %" PRIu64 " us, integrated %" PRIu64 " us\n",
+           g_lat_max[0], g_lat_max[1]);
+    if (g_lat_max[0] >= g_lat_max[1]) {
+        printf("FAIL lockout press not ahead of the integrated one\n");
+        btn_sim_fail();
+    }
+    return btn_sim_result();
+}
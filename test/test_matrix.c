@@ -0,0 +1,152 @@
+/**
+ * @file    test_matrix.c
+ * @brief   Keys on a virtual matrix without diodes, with ghost blocking.
+ *
+ * Five keys sit on the top left corner of the matrix:
+ *
+ *            col 0   col 1   col 2
+ *    row 0   MX_A    MX_B    MX_X
+ *    row 1   MX_C    MX_D
+ *
+ * Each key must report its own press and release once through bounce,
+ * with long press and double click, scanned at once or split over polls.
+ * Pressing MX_C while MX_A and MX_B are held makes MX_D look pressed:
+ * neither MX_C nor MX_D may be reported, while MX_X, held in the
+ * ambiguous row, must still release. A pulse shorter than one poll,
+ * caught by a single scan, must never be reported.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define MX_RUNS             (8)
+#define MX_BOUNCE           (6)             /* up to ~5 ms of contact bounce */
+#define MX_LONGPRESS_MS     (600)
+#define MX_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+/* a full scan spans this many polls */
+#define MX_SCAN_MS          (BTN_POLL_PERIOD_MS * \
+        ((BTN_MATRIX_ROWS + BTN_MATRIX_ROWS_PER_POLL - 1) / BTN_MATRIX_ROWS_PER_POLL))
+
+#define MX_A                ((key_id_e)0)
+#define MX_B                ((key_id_e)1)
+#define MX_C                ((key_id_e)2)
+#define MX_D                ((key_id_e)3)
+#define MX_X                ((key_id_e)4)
+#define MX_KEYS             (5)
+
+static const uint8_t g_cross[MX_KEYS][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}, {0, 2}};
+
+/* keys on both rows click over each other, each with bounce of its own */
+static void mx_scn_click(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(MX_IDLE_MS) + SIM_MS(phase);
+
+    btn_sim_edge(MX_A, t, true, MX_BOUNCE);
+    btn_sim_edge(MX_D, t + SIM_MS(3), true, MX_BOUNCE);
+    btn_sim_edge(MX_A, t + SIM_MS(120), false, MX_BOUNCE);
+    btn_sim_edge(MX_D, t + SIM_MS(150), false, MX_BOUNCE);
+    btn_sim_run(t + SIM_MS(150 + MX_IDLE_MS));
+
+    btn_sim_expect("click press", MX_A, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("click release", MX_A, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("click press", MX_D, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("click release", MX_D, BTN_EVT_RELEASE, t, 1);
+}
+
+/* MX_A held into its long press while MX_X on the same row double clicks */
+static void mx_scn_long_double(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(MX_IDLE_MS) + SIM_MS(phase);
+
+    btn_sim_edge(MX_A, t, true, MX_BOUNCE);
+    btn_sim_edge(MX_X, t + SIM_MS(100), true, MX_BOUNCE);
+    btn_sim_edge(MX_X, t + SIM_MS(180), false, MX_BOUNCE);
+    btn_sim_edge(MX_X, t + SIM_MS(300), true, MX_BOUNCE);
+    btn_sim_edge(MX_X, t + SIM_MS(380), false, MX_BOUNCE);
+    btn_sim_edge(MX_A, t + SIM_MS(MX_LONGPRESS_MS + 200), false, MX_BOUNCE);
+    btn_sim_run(t + SIM_MS(MX_LONGPRESS_MS + 200 + MX_IDLE_MS));
+
+    btn_sim_expect("long", MX_A, BTN_EVT_LONG, t, 1);
+    btn_sim_expect("long release", MX_A, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("double press", MX_X, BTN_EVT_PRESS, t, 2);
+    btn_sim_expect("double", MX_X, BTN_EVT_DOUBLE, t, 1);
+}
+
+/* three corners of a rectangle held, MX_X let go while the rows are ambiguous */
+static void mx_scn_ghost(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(MX_IDLE_MS) + SIM_MS(phase);
+    bool ghost = false;
+
+    btn_sim_edge(MX_A, t, true, MX_BOUNCE);
+    btn_sim_edge(MX_B, t + SIM_MS(50), true, MX_BOUNCE);
+    btn_sim_edge(MX_X, t + SIM_MS(100), true, MX_BOUNCE);
+    btn_sim_edge(MX_C, t + SIM_MS(150), true, MX_BOUNCE);
+    btn_sim_run(t + SIM_MS(250));
+    ghost = lite_button_matrix_ghost_get();
+    btn_sim_edge(MX_X, t + SIM_MS(300), false, MX_BOUNCE);
+    btn_sim_edge(MX_C, t + SIM_MS(400), false, MX_BOUNCE);
+    btn_sim_edge(MX_A, t + SIM_MS(450), false, MX_BOUNCE);
+    btn_sim_edge(MX_B, t + SIM_MS(450), false, MX_BOUNCE);
+    btn_sim_run(t + SIM_MS(450 + MX_IDLE_MS));
+
+    if (!ghost) {
+        printf("FAIL phase %u: ghost not seen\n", phase);
+        btn_sim_fail();
+    }
+    btn_sim_expect("ghost", MX_D, BTN_EVT_PRESS, t, 0);
+    btn_sim_expect("ambiguous press", MX_C, BTN_EVT_PRESS, t, 0);
+    btn_sim_expect("ambiguous release", MX_X, BTN_EVT_RELEASE, t, 1);
+    if (btn_sim_find(MX_X, BTN_EVT_RELEASE, t) > t + SIM_MS(300 + 10 + BTN_DEBOUNCE_MS + 3 * MX_SCAN_MS)) {
+        printf("FAIL phase %u: ambiguous release late\n", phase);
+        btn_sim_fail();
+    }
+    btn_sim_expect("held press", MX_A, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("held press", MX_B, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("held release", MX_A, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("held release", MX_B, BTN_EVT_RELEASE, t, 1);
+}
+
+/* a pulse shorter than one poll, at every ms of a scan */
+static void mx_scn_glitch(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(MX_IDLE_MS) + SIM_MS(phase);
+    uint32_t width = (BTN_POLL_PERIOD_MS > 1) ? BTN_POLL_PERIOD_MS - 1 : 1;
+
+    // pulses a few scans apart, each one ms later within the scan
+    for (uint32_t ms = 0; ms < MX_SCAN_MS; ms++) {
+        btn_sim_edge(MX_C, t + SIM_MS(ms * (MX_SCAN_MS * 3 + 1)), true, 0);
+        btn_sim_edge(MX_C, t + SIM_MS(ms * (MX_SCAN_MS * 3 + 1) + width), false, 0);
+    }
+    btn_sim_run(t + SIM_MS(MX_SCAN_MS * (MX_SCAN_MS * 3 + 1) + MX_IDLE_MS));
+
+    btn_sim_expect("glitch", MX_C, BTN_EVT_PRESS, t, 0);
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = MX_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+    };
+
+    btn_sim_init(&cfg);
+    for (size_t k = 0; k < MX_KEYS; k++) {
+        btn_sim_matrix_key((key_id_e)k, g_cross[k][0], g_cross[k][1], &cfg);
+    }
+
+    printf("poll %d ms, debounce %d ms, rows per poll %d of %d, exti %d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_MATRIX_ROWS_PER_POLL, BTN_MATRIX_ROWS,
+           BTN_EXTI_FUN_ENABLE);
+
+    for (uint32_t n = 0; n < MX_RUNS; n++) {
+        mx_scn_click(n * 3);
+        mx_scn_long_double(n * 3);
+        mx_scn_ghost(n * 3);
+        mx_scn_glitch(n);
+    }
+
+    return btn_sim_result();
+}
@@ -0,0 +1,225 @@
+/**
+ * @file    test_pool.c
+ * @brief   Keys and combos taken from the pool at run time and given back.
+ *
+ * The fixed keys keep the low slots, expander keys are taken after them as
+ * if found at boot, until the pool is full. A slot given back must be the
+ * next one handed out, so the keys in use stay packed. Keys and combos on
+ * taken slots must report like fixed ones. A key given back mid press must
+ * fall silent and take its combos with it, a key later set up in the same
+ * slot must not complete them. With the rest of its mask word given back,
+ * the top key freed mid press must not keep the poll awake past the words
+ * still in use, and must report again once its slot is taken back.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define PL_SIM_KEYS         (8)             /* keys with a virtual GPIO */
+#define PL_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+
+static const btn_cfg_t g_cfg = {
+    .longpress_ms = 1000,
+    .longpress_repeat_ms = 0,
+};
+
+/* a virtual GPIO while there are any left, its level pushed past them */
+static void pl_key_cfg(key_id_e id)
+{
+    if (id < PL_SIM_KEYS) {
+        btn_sim_key_cfg(id, &g_cfg);
+    } else {
+        btn_sim_input_key(id, &g_cfg);
+    }
+}
+
+/* keys pressed at t, 30 ms apart, and released together after hold_ms */
+static void pl_chord(uint64_t t, key_id_e a, key_id_e b, uint32_t hold_ms)
+{
+    btn_sim_edge(a, t, true, 2);
+    btn_sim_edge(b, t + SIM_MS(30), true, 2);
+    btn_sim_edge(a, t + SIM_MS(hold_ms), false, 2);
+    btn_sim_edge(b, t + SIM_MS(hold_ms), false, 2);
+}
+
+/* the slots past the fixed keys are free, take them all */
+static void pl_scn_fill(key_id_e *ext, size_t *num)
+{
+    key_id_e id = BTN_KEY_INVALID;
+
+    for (size_t i = KEY_MAX; i < BTN_NUM; i++) {
+        lite_button_key_free((key_id_e)i);
+    }
+
+    *num = 0;
+    while ((id = lite_button_key_alloc()) != BTN_KEY_INVALID) {
+        if (id != (key_id_e)(KEY_MAX + *num)) {
+            printf("FAIL slot %d handed out, expected %d\n", (int)id, (int)(KEY_MAX + *num));
+            btn_sim_fail();
+        }
+        ext[(*num)++] = id;
+        pl_key_cfg(id);
+    }
+    printf("%zu expander keys after %d fixed ones\n", *num, KEY_MAX);
+    if (*num != BTN_NUM - KEY_MAX) {
+        printf("FAIL pool of %d slots gave %zu\n", BTN_NUM, *num);
+        btn_sim_fail();
+    }
+
+    // a hole is filled first
+    lite_button_key_free(ext[1]);
+    id = lite_button_key_alloc();
+    if (id != ext[1] || lite_button_key_alloc() != BTN_KEY_INVALID) {
+        printf("FAIL slot %d handed out for the hole at %d\n", (int)id, (int)ext[1]);
+        btn_sim_fail();
+    }
+    pl_key_cfg(id);
+}
+
+static void pl_scn_click(const key_id_e *ext, size_t num)
+{
+    uint64_t t = 0;
+    size_t end = 0;
+
+    // a group at a time, the edge queue holds a few keys' bounces
+    for (size_t k = 0; k < num; k = end) {
+        t = btn_sim_now() + SIM_MS(PL_IDLE_MS);
+        end = MIN(k + PL_SIM_KEYS, num);
+        for (size_t n = k; n < end; n++) {
+            btn_sim_edge(ext[n], t + SIM_MS((n - k) * 10), true, 2);
+            btn_sim_edge(ext[n], t + SIM_MS((n - k) * 10 + 100), false, 2);
+        }
+        btn_sim_run(t + SIM_MS(PL_SIM_KEYS * 10 + 100 + PL_IDLE_MS));
+        for (size_t n = k; n < end; n++) {
+            btn_sim_expect("click press", ext[n], BTN_EVT_PRESS, t, 1);
+            btn_sim_expect("click release", ext[n], BTN_EVT_RELEASE, t, 1);
+        }
+    }
+}
+
+/* the top word emptied, its last key given back mid press, then all taken back */
+static void pl_scn_top(key_id_e key)
+{
+    size_t low = MAX(BTN_MASK_WORD(key) * BTN_MASK_WORD_BITS, (size_t)KEY_MAX);
+    uint64_t t = btn_sim_now() + SIM_MS(PL_IDLE_MS);
+#if BTN_EXTI_FUN_ENABLE
+    uint64_t polls = 0;
+#endif
+
+    // the walks then end a word lower, or after the fixed keys
+    for (size_t i = low; i < (size_t)key; i++) {
+        lite_button_key_free((key_id_e)i);
+    }
+    btn_sim_edge(key, t, true, 2);
+    btn_sim_run(t + SIM_MS(100));
+    lite_button_key_free(key);
+    btn_sim_edge(key, t + SIM_MS(300), false, 2);
+    btn_sim_run(t + SIM_MS(300 + PL_IDLE_MS));
+    btn_sim_expect("top freed release", key, BTN_EVT_RELEASE, t, 0);
+#if BTN_EXTI_FUN_ENABLE
+    // a one-shot armed for its long press still runs out in tickless mode
+    btn_sim_run(btn_sim_now() + SIM_MS(g_cfg.longpress_ms));
+    polls = btn_sim_stat_get()->polls;
+    btn_sim_run(btn_sim_now() + SIM_MS(2000));
+    if (btn_sim_stat_get()->polls != polls) {
+        printf("FAIL still polling: %" PRIu64 " polls after key %d was given back\n",
+               btn_sim_stat_get()->polls - polls, (int)key);
+        btn_sim_fail();
+    }
+#endif
+
+    // lowest first, the top slot last
+    for (size_t i = low; i <= (size_t)key; i++) {
+        if (lite_button_key_alloc() != (key_id_e)i) {
+            printf("FAIL slot %d not handed out again\n", (int)i);
+            btn_sim_fail();
+            return;
+        }
+        pl_key_cfg((key_id_e)i);
+    }
+    t = btn_sim_now() + SIM_MS(PL_IDLE_MS);
+    btn_sim_edge(key, t, true, 2);
+    btn_sim_edge(key, t + SIM_MS(100), false, 2);
+    btn_sim_run(t + SIM_MS(100 + PL_IDLE_MS));
+    btn_sim_expect("top again press", key, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("top again release", key, BTN_EVT_RELEASE, t, 1);
+}
+
+#if BTN_COMBO_FUN_ENABLE
+static void pl_scn_combo(key_id_e key)
+{
+    btn_combo_cfg_t combo = {
+        .keys = {KEY_UP, key},
+        .num = BTN_DOUBLE_KEY_CNT,
+        .type = BTN_COMBO_SIMULTANEOUS,
+    };
+    key_combo_id_e id = lite_button_combo_alloc();
+    uint64_t t = btn_sim_now() + SIM_MS(PL_IDLE_MS);
+
+    // no fixed combo registered, the first slot is free
+    if (id != (key_combo_id_e)0) {
+        printf("FAIL combo slot %d handed out, expected 0\n", (int)id);
+        btn_sim_fail();
+        return;
+    }
+    btn_sim_register_combo(id, &combo);
+    pl_chord(t, KEY_UP, key, 200);
+    btn_sim_run(t + SIM_MS(200 + PL_IDLE_MS));
+    btn_sim_expect("combo", BTN_SIM_COMBO_ID(id), BTN_EVT_COMBO, t, 1);
+
+    // given back mid press: silent, its combo gone
+    t = btn_sim_now() + SIM_MS(PL_IDLE_MS);
+    btn_sim_edge(key, t, true, 2);
+    btn_sim_run(t + SIM_MS(100));
+    lite_button_key_free(key);
+    btn_sim_edge(key, t + SIM_MS(300), false, 2);
+    btn_sim_run(t + SIM_MS(300 + PL_IDLE_MS));
+    btn_sim_expect("freed press", key, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("freed release", key, BTN_EVT_RELEASE, t, 0);
+
+    // a new key in the slot reports, the old combo does not
+    if (lite_button_key_alloc() != key) {
+        printf("FAIL freed slot %d not handed out again\n", (int)key);
+        btn_sim_fail();
+    }
+    pl_key_cfg(key);
+    t = btn_sim_now() + SIM_MS(PL_IDLE_MS);
+    pl_chord(t, KEY_UP, key, 200);
+    btn_sim_run(t + SIM_MS(200 + PL_IDLE_MS));
+    btn_sim_expect("new key press", key, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("old combo", BTN_SIM_COMBO_ID(id), BTN_EVT_COMBO, t, 0);
+
+    // the combo slot is still taken until it is given back
+    if (lite_button_combo_alloc() == id) {
+        printf("FAIL combo slot %d handed out twice\n", (int)id);
+        btn_sim_fail();
+    }
+    lite_button_combo_free(id);
+    if (lite_button_combo_alloc() != id) {
+        printf("FAIL combo slot %d not given back\n", (int)id);
+        btn_sim_fail();
+    }
+}
+#endif
+
+int main(void)
+{
+    key_id_e ext[BTN_NUM];
+    size_t num = 0;
+
+    btn_sim_init(&g_cfg);
+
+    printf("poll %d ms, debounce %d ms, exti %d, pool %d keys %d combos\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_EXTI_FUN_ENABLE, BTN_NUM, BTN_COMBO_NUM);
+
+    pl_scn_fill(ext, &num);
+    pl_scn_click(ext, num);
+    pl_scn_top(ext[num - 1]);
+#if BTN_COMBO_FUN_ENABLE
+    pl_scn_combo(ext[0]);
+#endif
+
+    return btn_sim_result();
+}
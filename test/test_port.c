@@ -0,0 +1,109 @@
+/**
+ * @file    test_port.c
+ * @brief   Keys sharing one port word, debounced bit-parallel.
+ *
+ * KEY_UP, KEY_DOWN and KEY_OK sit on pins 2, 3 and 9 of port 0 and are
+ * sampled as one word. Bursts of bounce on one pin must not hold back or
+ * leak into the keys beside it: each key must report its own press and
+ * release exactly once, a long press on one key must come while another
+ * double clicks, and a pulse shorter than the debounce time must not be
+ * reported at all.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define PT_RUNS             (8)
+#define PT_BOUNCE           (6)             /* up to ~5 ms of contact bounce */
+#define PT_LONGPRESS_MS     (600)
+#define PT_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+
+static const uint8_t g_pin[] = {2, 3, 9};  /* by key id */
+
+/* the three keys click over each other, each with bounce of its own */
+static void pt_scn_overlap(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(PT_IDLE_MS) + SIM_MS(phase);
+
+    btn_sim_edge(KEY_UP, t, true, PT_BOUNCE);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(2), true, 0);
+    btn_sim_edge(KEY_OK, t + SIM_MS(3), true, PT_BOUNCE);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(60), false, PT_BOUNCE);
+    btn_sim_edge(KEY_UP, t + SIM_MS(62), false, 0);
+    btn_sim_edge(KEY_OK, t + SIM_MS(120), false, PT_BOUNCE);
+    btn_sim_run(t + SIM_MS(120 + PT_IDLE_MS));
+
+    for (size_t k = 0; k < 3; k++) {
+        btn_sim_expect("overlap press", (key_id_e)k, BTN_EVT_PRESS, t, 1);
+        btn_sim_expect("overlap release", (key_id_e)k, BTN_EVT_RELEASE, t, 1);
+    }
+}
+
+/* KEY_UP held into its long press while KEY_DOWN double clicks */
+static void pt_scn_long_double(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(PT_IDLE_MS) + SIM_MS(phase);
+
+    btn_sim_edge(KEY_UP, t, true, PT_BOUNCE);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(100), true, PT_BOUNCE);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(180), false, PT_BOUNCE);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(300), true, PT_BOUNCE);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(380), false, PT_BOUNCE);
+    btn_sim_edge(KEY_UP, t + SIM_MS(PT_LONGPRESS_MS + 200), false, PT_BOUNCE);
+    btn_sim_run(t + SIM_MS(PT_LONGPRESS_MS + 200 + PT_IDLE_MS));
+
+    btn_sim_expect("long press", KEY_UP, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("long", KEY_UP, BTN_EVT_LONG, t, 1);
+    btn_sim_expect("long release", KEY_UP, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("double press", KEY_DOWN, BTN_EVT_PRESS, t, 2);
+    btn_sim_expect("double", KEY_DOWN, BTN_EVT_DOUBLE, t, 1);
+    btn_sim_expect("double release", KEY_DOWN, BTN_EVT_RELEASE, t, 1);
+    if (btn_sim_find(KEY_UP, BTN_EVT_LONG, t) < t + SIM_MS(PT_LONGPRESS_MS)) {
+        printf("FAIL phase %u: long press early\n", phase);
+        btn_sim_fail();
+    }
+}
+
+/* a pulse shorter than the debounce time on a pin between two held keys */
+static void pt_scn_glitch(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(PT_IDLE_MS) + SIM_MS(phase);
+
+    btn_sim_edge(KEY_UP, t, true, 0);
+    btn_sim_edge(KEY_OK, t, true, 0);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(50), true, 0);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(50) + SIM_MS(BTN_DEBOUNCE_MS) / 4, false, 0);
+    btn_sim_edge(KEY_UP, t + SIM_MS(100), false, 0);
+    btn_sim_edge(KEY_OK, t + SIM_MS(100), false, 0);
+    btn_sim_run(t + SIM_MS(100 + PT_IDLE_MS));
+
+    btn_sim_expect("glitch", KEY_DOWN, BTN_EVT_PRESS, t, 0);
+    btn_sim_expect("held press", KEY_UP, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("held press", KEY_OK, BTN_EVT_PRESS, t, 1);
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = PT_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+    };
+
+    btn_sim_init(&cfg);
+    for (size_t k = 0; k < 3; k++) {
+        btn_sim_port_key((key_id_e)k, 0, g_pin[k], &cfg);
+    }
+
+    printf("poll %d ms, debounce %d ms, exti %d, wheel %d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_EXTI_FUN_ENABLE, BTN_WHEEL_FUN_ENABLE);
+
+    for (uint32_t n = 0; n < PT_RUNS; n++) {
+        pt_scn_overlap(n * 3);
+        pt_scn_long_double(n * 3);
+        pt_scn_glitch(n * 3);
+    }
+
+    return btn_sim_result();
+}
@@ -0,0 +1,109 @@
+/**
+ * @file    test_seq.c
+ * @brief   Key sequences matched by the press automaton.
+ *
+ * KEY_SEQ_SERVICE is UP UP DOWN and KEY_SEQ_UNLOCK is OK DOWN OK DOWN OK.
+ * UP UP UP DOWN must still match through the failure link of the third
+ * UP, a gap longer than BTN_SEQ_STEP_MS between two presses must start
+ * matching over, and with BTN_SEQ_NODE_MAX too small for both sequences
+ * the second one must be dropped while the first keeps working.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define SQ_RUNS             (4)
+#define SQ_BOUNCE           (3)
+#define SQ_STEP_MS          (150)           /* press to press, well within a step */
+#define SQ_IDLE_MS          (BTN_SEQ_STEP_MS + BTN_MULTI_GAP_MS + 100)
+/* states the two sequences need together, root included */
+#define SQ_NODES            (1 + 3 + 5)
+
+static const btn_seq_cfg_t g_service = {{KEY_UP, KEY_UP, KEY_DOWN}, 3};
+static const btn_seq_cfg_t g_unlock = {{KEY_OK, KEY_DOWN, KEY_OK, KEY_DOWN, KEY_OK}, 5};
+
+/* click the keys one after another from t on, return the time after the last */
+static uint64_t sq_clicks(uint64_t t, const key_id_e *keys, size_t num)
+{
+    for (size_t k = 0; k < num; k++) {
+        btn_sim_edge(keys[k], t, true, SQ_BOUNCE);
+        btn_sim_edge(keys[k], t + SIM_MS(60), false, SQ_BOUNCE);
+        t += SIM_MS(SQ_STEP_MS);
+    }
+
+    return t;
+}
+
+/* one UP too many in front of the sequence */
+static void sq_scn_overlap(uint32_t phase)
+{
+    static const key_id_e keys[] = {KEY_UP, KEY_UP, KEY_UP, KEY_DOWN};
+    uint64_t t = btn_sim_now() + SIM_MS(SQ_IDLE_MS) + SIM_MS(phase);
+    uint64_t end = sq_clicks(t, keys, sizeof(keys) / sizeof(keys[0]));
+
+    btn_sim_run(end + SIM_MS(SQ_IDLE_MS));
+
+    btn_sim_expect("overlap", BTN_SIM_SEQ_ID(KEY_SEQ_SERVICE), BTN_EVT_SEQUENCE, t, 1);
+    // reported on the DOWN press, not before
+    if (btn_sim_find(BTN_SIM_SEQ_ID(KEY_SEQ_SERVICE), BTN_EVT_SEQUENCE, t) < t + SIM_MS(3 * SQ_STEP_MS)) {
+        printf("FAIL phase %u: sequence early\n", phase);
+        btn_sim_fail();
+    }
+}
+
+/* the sequence with a pause too long in the middle, then in time again */
+static void sq_scn_gap(uint32_t phase)
+{
+    static const key_id_e head[] = {KEY_UP, KEY_UP};
+    static const key_id_e tail[] = {KEY_DOWN};
+    uint64_t t = btn_sim_now() + SIM_MS(SQ_IDLE_MS) + SIM_MS(phase);
+    uint64_t end = sq_clicks(t, head, 2);
+
+    end = sq_clicks(end + SIM_MS(BTN_SEQ_STEP_MS), tail, 1);
+    btn_sim_run(end + SIM_MS(SQ_IDLE_MS));
+    btn_sim_expect("gap", BTN_SIM_SEQ_ID(KEY_SEQ_SERVICE), BTN_EVT_SEQUENCE, t, 0);
+
+    t = btn_sim_now();
+    end = sq_clicks(t, head, 2);
+    end = sq_clicks(end + SIM_MS(BTN_SEQ_STEP_MS) / 2, tail, 1);
+    btn_sim_run(end + SIM_MS(SQ_IDLE_MS));
+    btn_sim_expect("within step", BTN_SIM_SEQ_ID(KEY_SEQ_SERVICE), BTN_EVT_SEQUENCE, t, 1);
+}
+
+/* the long sequence, there only when both fit in the automaton */
+static void sq_scn_unlock(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(SQ_IDLE_MS) + SIM_MS(phase);
+    uint64_t end = sq_clicks(t, g_unlock.keys, g_unlock.num);
+
+    btn_sim_run(end + SIM_MS(SQ_IDLE_MS));
+
+    btn_sim_expect("unlock", BTN_SIM_SEQ_ID(KEY_SEQ_UNLOCK), BTN_EVT_SEQUENCE, t,
+                   (BTN_SEQ_NODE_MAX >= SQ_NODES) ? 1 : 0);
+    btn_sim_expect("unlock service", BTN_SIM_SEQ_ID(KEY_SEQ_SERVICE), BTN_EVT_SEQUENCE, t, 0);
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = 1000,
+        .longpress_repeat_ms = 0,
+    };
+
+    btn_sim_init(&cfg);
+    btn_sim_register_seq(KEY_SEQ_SERVICE, &g_service);
+    btn_sim_register_seq(KEY_SEQ_UNLOCK, &g_unlock);
+
+    printf("poll %d ms, exti %d, tickless %d, states %d of %d\n",
+           BTN_POLL_PERIOD_MS, BTN_EXTI_FUN_ENABLE, BTN_TICKLESS_FUN_ENABLE, SQ_NODES, BTN_SEQ_NODE_MAX);
+
+    for (uint32_t n = 0; n < SQ_RUNS; n++) {
+        sq_scn_overlap(n * 7);
+        sq_scn_gap(n * 7);
+        sq_scn_unlock(n * 7);
+    }
+
+    return btn_sim_result();
+}
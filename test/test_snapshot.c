@@ -0,0 +1,204 @@
+/**
+ * @file    test_snapshot.c
+ * @brief   Key state saved before deep sleep and resumed after it.
+ *
+ * The keys are set up again from scratch after each snapshot, as a device
+ * waking from standby does. An idle set must fit in a few bytes. A press
+ * held over the sleep must not be reported again and its long press must
+ * come one long press time after the original press, less the time slept;
+ * a click before the sleep and one after it must make a double click. The
+ * key that woke the device must report its press at once, a tap shorter
+ * than the wake up as one press and one release. Snapshots of another
+ * setup, or cut short, must be refused.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define SN_LONGPRESS_MS     (1000)
+#define SN_SLEPT_MS         (50)
+#define SN_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+#define SN_IDLE_SIZE        (3 + BTN_MASK_WORDS)
+
+static const btn_cfg_t g_cfg = {
+    .longpress_ms = SN_LONGPRESS_MS,
+    .longpress_repeat_ms = 0,
+};
+static uint8_t g_snap[BTN_SNAPSHOT_MAX];
+
+/* all key state lost, the keys are set up again */
+static void sn_reboot(const btn_cfg_t *cfg)
+{
+    btn_sim_init(cfg);
+}
+
+static void sn_scn_idle(void)
+{
+    size_t len = 0;
+
+    btn_sim_run(btn_sim_now() + SIM_MS(SN_IDLE_MS));
+    len = lite_button_snapshot(g_snap, sizeof(g_snap));
+    printf("idle snapshot: %zu bytes\n", len);
+    if (len == 0 || len > SN_IDLE_SIZE) {
+        printf("FAIL idle snapshot of %zu bytes\n", len);
+        btn_sim_fail();
+    }
+    sn_reboot(&g_cfg);
+    if (!lite_button_restore(g_snap, len, 1000)) {
+        printf("FAIL idle snapshot refused\n");
+        btn_sim_fail();
+    }
+}
+
+static void sn_scn_resume(void)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(SN_IDLE_MS);
+    uint64_t snap = t + SIM_MS(300);
+    uint64_t held = snap - t;
+    size_t len = 0;
+
+    btn_sim_edge(KEY_UP, t, true, 4);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(100), true, 4);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(180), false, 4);
+    btn_sim_run(snap);
+
+    len = lite_button_snapshot(g_snap, sizeof(g_snap));
+    printf("snapshot mid press: %zu bytes\n", len);
+    sn_reboot(&g_cfg);
+    if (!lite_button_restore(g_snap, len, SN_SLEPT_MS)) {
+        printf("FAIL snapshot refused\n");
+        btn_sim_fail();
+        return;
+    }
+    // the levels the keys woke up with, KEY_UP still held
+    t = btn_sim_now();
+    btn_sim_edge(KEY_UP, t, true, 0);
+    btn_sim_edge(KEY_UP, t + SIM_MS(SN_LONGPRESS_MS), false, 4);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(50), true, 4);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(130), false, 4);
+    btn_sim_run(t + SIM_MS(SN_LONGPRESS_MS + SN_IDLE_MS));
+
+    btn_sim_expect("held press", KEY_UP, BTN_EVT_PRESS, t, 0);
+    btn_sim_expect("held long", KEY_UP, BTN_EVT_LONG, t, 1);
+    btn_sim_expect("held release", KEY_UP, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("double", KEY_DOWN, BTN_EVT_DOUBLE, t, 1);
+    btn_sim_expect("double release", KEY_DOWN, BTN_EVT_RELEASE, t, 0);
+
+    // as if awake all along: held up to the snapshot, asleep, then up to the long press
+    held += SIM_MS(SN_SLEPT_MS) + btn_sim_find(KEY_UP, BTN_EVT_LONG, t) - t;
+    printf("long press after %" PRIu64 " us held\n", held);
+    if (held + SIM_MS(BTN_POLL_PERIOD_MS) < SIM_MS(SN_LONGPRESS_MS) ||
+        held > SIM_MS(SN_LONGPRESS_MS + BTN_DEBOUNCE_MS + 2 * BTN_POLL_PERIOD_MS)) {
+        printf("FAIL long press after %" PRIu64 " us held\n", held);
+        btn_sim_fail();
+    }
+}
+
+static void sn_scn_wake(void)
+{
+    uint64_t t = 0;
+    size_t len = 0;
+
+    btn_sim_run(btn_sim_now() + SIM_MS(SN_IDLE_MS));
+    len = lite_button_snapshot(g_snap, sizeof(g_snap));
+
+    // held: the press comes with the wake up, before any poll
+    sn_reboot(&g_cfg);
+    t = btn_sim_now();
+    btn_sim_edge(KEY_OK, t, true, 0);
+    btn_sim_edge(KEY_OK, t + SIM_MS(200), false, 4);
+    btn_sim_run(t);
+    lite_button_restore(g_snap, len, 1000);
+    lite_button_wake(KEY_OK);
+    if (btn_sim_find(KEY_OK, BTN_EVT_PRESS, t) != t) {
+        printf("FAIL wake press not reported at once\n");
+        btn_sim_fail();
+    }
+    btn_sim_run(t + SIM_MS(200 + SN_IDLE_MS));
+    btn_sim_expect("wake press", KEY_OK, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("wake release", KEY_OK, BTN_EVT_RELEASE, t, 1);
+
+    // a tap over before the keys were set up again
+    sn_reboot(&g_cfg);
+    t = btn_sim_now();
+    btn_sim_edge(KEY_OK, t, true, 0);
+    btn_sim_edge(KEY_OK, t + SIM_MS(2), false, 0);
+    btn_sim_run(t + SIM_MS(3));
+    lite_button_restore(g_snap, len, 1000);
+    lite_button_wake(KEY_OK);
+    btn_sim_run(t + SIM_MS(SN_IDLE_MS));
+    btn_sim_expect("tap press", KEY_OK, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("tap release", KEY_OK, BTN_EVT_RELEASE, t, 1);
+}
+
+static void sn_scn_refuse(void)
+{
+    btn_cfg_t cfg = g_cfg;
+    size_t len = 0;
+
+    btn_sim_run(btn_sim_now() + SIM_MS(SN_IDLE_MS));
+    len = lite_button_snapshot(g_snap, sizeof(g_snap));
+    if (lite_button_snapshot(g_snap, len - 1) != 0) {
+        printf("FAIL snapshot into a short buffer\n");
+        btn_sim_fail();
+    }
+
+    cfg.longpress_ms = SN_LONGPRESS_MS * 2;
+    sn_reboot(&cfg);
+    if (lite_button_restore(g_snap, len, 0)) {
+        printf("FAIL snapshot of another setup taken\n");
+        btn_sim_fail();
+    }
+    sn_reboot(&g_cfg);
+    if (lite_button_restore(g_snap, len - 1, 0) || lite_button_restore(g_snap, 0, 0)) {
+        printf("FAIL cut snapshot taken\n");
+        btn_sim_fail();
+    }
+}
+
+#if BTN_DEB_ADAPT_FUN_ENABLE
+static void sn_scn_learned(void)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(SN_IDLE_MS);
+    uint32_t learned = 0;
+    size_t len = 0;
+
+    // clean clicks shrink the window of KEY_OK
+    for (uint32_t n = 0; n < 3 * BTN_DEBOUNCE_LEARN_CNT; n++) {
+        btn_sim_edge(KEY_OK, t + SIM_MS(n * 600), true, 0);
+        btn_sim_edge(KEY_OK, t + SIM_MS(n * 600 + 100), false, 0);
+    }
+    btn_sim_run(t + SIM_MS(3 * BTN_DEBOUNCE_LEARN_CNT * 600 + SN_IDLE_MS));
+    learned = lite_button_debounce_get(KEY_OK);
+
+    len = lite_button_snapshot(g_snap, sizeof(g_snap));
+    sn_reboot(&g_cfg);
+    lite_button_restore(g_snap, len, 1000);
+    printf("learned debounce %u ms, %u ms after the restore\n", learned, lite_button_debounce_get(KEY_OK));
+    if (learned == BTN_DEBOUNCE_MS || lite_button_debounce_get(KEY_OK) != learned) {
+        printf("FAIL learned debounce not kept\n");
+        btn_sim_fail();
+    }
+}
+#endif
+
+int main(void)
+{
+    btn_sim_init(&g_cfg);
+
+    printf("poll %d ms, debounce %d ms, exti %d, tickless %d, timestamp %d, compact %d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_EXTI_FUN_ENABLE, BTN_TICKLESS_FUN_ENABLE,
+           BTN_TIMESTAMP_FUN_ENABLE, BTN_COMPACT_FUN_ENABLE);
+
+    sn_scn_idle();
+    sn_scn_resume();
+    sn_scn_wake();
+    sn_scn_refuse();
+#if BTN_DEB_ADAPT_FUN_ENABLE
+    sn_scn_learned();
+#endif
+
+    return btn_sim_result();
+}
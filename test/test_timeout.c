@@ -0,0 +1,139 @@
+/**
+ * @file    test_timeout.c
+ * @brief   EXTI keys parked on the timeout wheel between their timeouts.
+ *
+ * KEY_UP is held through a long press and its repeats while KEY_DOWN is
+ * clicked, KEY_OK double clicked and then held for a long press beyond the
+ * lower wheel levels, at a range of poll phases. Every event must be
+ * reported exactly once and on time. A released key waiting out its
+ * multi-click gap must not be read by the polls in between, nor a held
+ * key between its long press and repeats.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define TO_RUNS             (5)
+#define TO_PHASE_MS         (3)
+#define TO_BOUNCE           (4)
+#define TO_LONGPRESS_MS     (600)
+#define TO_REPEAT_MS        (100)
+#define TO_REPEAT_NUM       (9)
+#define TO_HOLD_MS          (TO_LONGPRESS_MS + TO_REPEAT_NUM * TO_REPEAT_MS + 50)
+#define TO_FAR_MS           (9000)          /* KEY_OK long press */
+#define TO_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+/* a gap longer than the wheel comes round once per turn of the top level */
+#define TO_GAP_READS        (1 + BTN_MULTI_GAP_MS / (BTN_POLL_PERIOD_MS << (BTN_TMO_BITS * BTN_TMO_LEVELS)))
+
+
+/* reads of key while the simulation runs on to until */
+static uint64_t to_reads(key_id_e key, uint64_t until)
+{
+    uint64_t reads = btn_sim_stat_get()->reads[key];
+
+    btn_sim_run(until);
+    return btn_sim_stat_get()->reads[key] - reads;
+}
+
+static void to_scn_hold(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(TO_IDLE_MS) + SIM_MS(phase);
+    uint64_t settle = btn_sim_edge(KEY_UP, t, true, TO_BOUNCE);
+    uint64_t rel = 0;
+    uint64_t reads = 0;
+    uint64_t lp = 0;
+
+    btn_sim_edge(KEY_UP, t + SIM_MS(TO_HOLD_MS), false, TO_BOUNCE);
+    btn_sim_edge(KEY_DOWN, t + SIM_MS(100), true, TO_BOUNCE);
+    rel = btn_sim_edge(KEY_DOWN, t + SIM_MS(180), false, TO_BOUNCE);
+
+    // the released key sits out its gap parked, the held one keeps the polls going
+    btn_sim_run(rel + SIM_MS(BTN_DEBOUNCE_MS + 3 * BTN_POLL_PERIOD_MS));
+    reads = to_reads(KEY_DOWN, rel + SIM_MS(BTN_MULTI_GAP_MS - BTN_POLL_PERIOD_MS));
+    if (reads > TO_GAP_READS) {
+        printf("FAIL phase %u: %" PRIu64 " reads in the multi-click gap\n", phase, reads);
+        btn_sim_fail();
+    }
+    // both edges fire, a held key is only read at its timeouts
+    reads = to_reads(KEY_UP, t + SIM_MS(TO_HOLD_MS - BTN_POLL_PERIOD_MS));
+    if (reads > TO_REPEAT_NUM + 2) {
+        printf("FAIL phase %u: %" PRIu64 " reads while held\n", phase, reads);
+        btn_sim_fail();
+    }
+    btn_sim_run(t + SIM_MS(TO_HOLD_MS + TO_IDLE_MS) + SIM_MS(200));
+
+    btn_sim_expect("hold press", KEY_UP, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("hold long", KEY_UP, BTN_EVT_LONG, t, 1 + TO_REPEAT_NUM);
+    btn_sim_expect("hold release", KEY_UP, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("click press", KEY_DOWN, BTN_EVT_PRESS, t, 1);
+    btn_sim_expect("click release", KEY_DOWN, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("click double", KEY_DOWN, BTN_EVT_DOUBLE, t, 0);
+
+    lp = btn_sim_find(KEY_UP, BTN_EVT_LONG, t);
+    if (lp - t < SIM_MS(TO_LONGPRESS_MS) ||
+        lp - settle > SIM_MS(TO_LONGPRESS_MS + BTN_DEBOUNCE_MS + 2 * BTN_POLL_PERIOD_MS)) {
+        printf("FAIL phase %u: long press %" PRIu64 " us after the press\n", phase, lp - t);
+        btn_sim_fail();
+    }
+}
+
+static void to_scn_double(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(TO_IDLE_MS) + SIM_MS(phase);
+
+    btn_sim_edge(KEY_OK, t, true, TO_BOUNCE);
+    btn_sim_edge(KEY_OK, t + SIM_MS(80), false, TO_BOUNCE);
+    btn_sim_edge(KEY_OK, t + SIM_MS(250), true, TO_BOUNCE);
+    btn_sim_edge(KEY_OK, t + SIM_MS(330), false, TO_BOUNCE);
+    btn_sim_run(t + SIM_MS(330 + TO_IDLE_MS) + SIM_MS(200));
+
+    btn_sim_expect("double press", KEY_OK, BTN_EVT_PRESS, t, 2);
+    btn_sim_expect("double", KEY_OK, BTN_EVT_DOUBLE, t, 1);
+}
+
+static void to_scn_far(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(TO_IDLE_MS) + SIM_MS(phase);
+    uint64_t settle = btn_sim_edge(KEY_OK, t, true, TO_BOUNCE);
+    uint64_t lp = 0;
+
+    btn_sim_edge(KEY_OK, t + SIM_MS(TO_FAR_MS + 500), false, TO_BOUNCE);
+    btn_sim_run(t + SIM_MS(TO_FAR_MS + 500 + TO_IDLE_MS));
+
+    btn_sim_expect("far long", KEY_OK, BTN_EVT_LONG, t, 1);
+    btn_sim_expect("far release", KEY_OK, BTN_EVT_RELEASE, t, 1);
+    lp = btn_sim_find(KEY_OK, BTN_EVT_LONG, t);
+    if (lp - t < SIM_MS(TO_FAR_MS) ||
+        lp - settle > SIM_MS(TO_FAR_MS + BTN_DEBOUNCE_MS + 2 * BTN_POLL_PERIOD_MS)) {
+        printf("FAIL phase %u: far long press %" PRIu64 " us after the press\n", phase, lp - t);
+        btn_sim_fail();
+    }
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = TO_LONGPRESS_MS,
+        .longpress_repeat_ms = TO_REPEAT_MS,
+    };
+
+    btn_sim_init(&cfg);
+    cfg.longpress_ms = TO_FAR_MS;
+    cfg.longpress_repeat_ms = 0;
+    btn_sim_key_cfg(KEY_OK, &cfg);
+
+    printf("poll %d ms, debounce %d ms, wheel %d levels, tickless %d, compact %d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_TMO_LEVELS,
+           BTN_TICKLESS_FUN_ENABLE, BTN_COMPACT_FUN_ENABLE);
+
+    for (uint32_t n = 0; n < TO_RUNS; n++) {
+        to_scn_hold(n * TO_PHASE_MS);
+        to_scn_double(n * TO_PHASE_MS);
+        to_scn_far(n * TO_PHASE_MS);
+    }
+
+    printf("%" PRIu64 " polls\n", btn_sim_stat_get()->polls);
+    return btn_sim_result();
+}
@@ -0,0 +1,141 @@
+/**
+ * @file    test_trace.c
+ * @brief   Trace recording and replay round trip.
+ *
+ * A random bouncing workload runs on the default context with the trace
+ * on, the trace is then replayed into a second context with the same keys
+ * and combo. The replay must yield the very event stream of the run. A
+ * second, longer run overflows the ring and must still decode.
+ */
+
+#include <stdio.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define SIM_ACTIONS         (60)
+
+static lite_button_ctx_t g_rp;
+static btn_sim_evt_t g_rp_log[BTN_SIM_LOG_MAX];
+static size_t g_rp_num = 0;
+static uint8_t g_blob[BTN_TRACE_BLOB_MAX];
+static uint32_t g_seed = 7;
+
+static uint32_t sim_rand(uint32_t range)
+{
+    g_seed = g_seed * 1103515245U + 12345U;
+    return ((g_seed >> 16) & 0x7FFF) % range;
+}
+
+static void rp_log(uint32_t id, btn_evt_e evt)
+{
+    if (g_rp_num >= BTN_SIM_LOG_MAX) return;
+    g_rp_log[g_rp_num].id = id;
+    g_rp_log[g_rp_num].evt = evt;
+    g_rp_num++;
+}
+
+static void rp_key_cb(btn_evt_e evt, void *para)
+{
+    rp_log((uint32_t)(uintptr_t)para, evt);
+}
+
+#if BTN_COMBO_FUN_ENABLE
+static void rp_combo_cb(key_combo_id_e id, void *para)
+{
+    (void)para;
+    rp_log(BTN_SIM_COMBO_ID(id), BTN_EVT_COMBO);
+}
+#endif
+
+/* never read during a replay */
+static btn_level_e rp_gpio(void)
+{
+    return BTN_IDLE_LEVEL;
+}
+
+/* random presses on random keys, overlapping ones make combos */
+static void sim_workload(size_t actions)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(100);
+    uint64_t end = 0;
+    key_id_e key = KEY_UP;
+
+    for (size_t n = 0; n < actions; n++) {
+        key = (key_id_e)sim_rand(KEY_MAX);
+        btn_sim_edge(key, t, true, sim_rand(4));
+        end = btn_sim_edge(key, t + SIM_MS(30 + sim_rand(1200)), false, sim_rand(4));
+        t += SIM_MS(10 + sim_rand(500));
+        btn_sim_run(t);
+    }
+    btn_sim_run(end + SIM_MS(2000));
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = 800,
+        .longpress_repeat_ms = 200,
+    };
+    btn_combo_cfg_t combo = {
+        .keys = {KEY_UP, KEY_DOWN},
+        .num = BTN_DOUBLE_KEY_CNT,
+        .type = BTN_COMBO_SIMULTANEOUS,
+    };
+    const btn_sim_evt_t *log = NULL;
+    size_t num = 0;
+    size_t len = 0;
+    size_t diff = 0;
+    bool ok = false;
+
+    btn_sim_init(&cfg);
+    btn_sim_register_combo(KEY_COMBO_COPY, &combo);
+
+    lite_button_ctx_init(&g_rp, BTN_POLL_PERIOD_MS);
+    for (size_t i = 0; i < KEY_MAX; i++) {
+        lite_button_init_ctx(&g_rp, (key_id_e)i, rp_gpio, &cfg, rp_key_cb, (void *)(uintptr_t)i);
+    }
+#if BTN_COMBO_FUN_ENABLE
+    lite_button_register_combos_ctx(&g_rp, KEY_COMBO_COPY, &combo, rp_combo_cb, NULL);
+#endif
+
+    // round trip
+    lite_button_trace_start();
+    sim_workload(SIM_ACTIONS);
+    lite_button_trace_stop();
+
+    len = lite_button_trace_read(g_blob, sizeof(g_blob));
+    ok = lite_button_replay_ctx(&g_rp, g_blob, len);
+    log = btn_sim_log_get(&num);
+    for (size_t n = 0; n < num || n < g_rp_num; n++) {
+        if (n >= num || n >= g_rp_num || log[n].id != g_rp_log[n].id || log[n].evt != g_rp_log[n].evt) {
+            diff++;
+        }
+    }
+    printf("trace %zu bytes, %llu polls, %u dropped, %zu events, replay %zu events, %zu differ\n",
+           len, (unsigned long long)btn_sim_stat_get()->polls, lite_button_trace_dropped_get(),
+           num, g_rp_num, diff);
+    if (!ok || len == 0 || num == 0 || diff != 0 || lite_button_trace_dropped_get() != 0) {
+        printf("FAIL round trip\n");
+        return 1;
+    }
+
+    // overflow, the oldest records are folded away
+    lite_button_trace_start();
+    for (size_t n = 0; n < 100 && lite_button_trace_dropped_get() == 0; n++) {
+        btn_sim_log_clear();
+        sim_workload(SIM_ACTIONS);
+    }
+    lite_button_trace_stop();
+
+    len = lite_button_trace_read(g_blob, sizeof(g_blob));
+    g_rp_num = 0;
+    ok = lite_button_replay_ctx(&g_rp, g_blob, len);
+    printf("overflow: trace %zu bytes, %u dropped, replay %s, %zu events\n",
+           len, lite_button_trace_dropped_get(), ok ? "ok" : "failed", g_rp_num);
+    if (!ok || lite_button_trace_dropped_get() == 0 || g_rp_num == 0) {
+        printf("FAIL overflow\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file    test_wheel.c
+ * @brief   Keys sampled at periods of their own from the timer wheel.
+ *
+ * KEY_UP is sampled every poll, KEY_OK every 10 ms and KEY_DOWN every
+ * 100 ms, a period longer than the wheel. While idle each key must be read
+ * once per period and no more. Clicks and long presses at a range of poll
+ * phases must be reported exactly once, the press within two periods and
+ * the debounce time of the contact settling, the long press no earlier
+ * than one long press time after the contact and within a period of one
+ * long press time after the press. The faster keys must also report a
+ * double click.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define WH_RUNS             (10)
+#define WH_PHASE_MS         (7)
+#define WH_BOUNCE           (3)             /* up to ~2 ms of contact bounce */
+#define WH_LONGPRESS_MS     (600)
+#define WH_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+#define WH_READ_MS          (1000)
+
+static const uint32_t g_period_ms[] = {BTN_POLL_PERIOD_MS, 100, 10};  /* by key id */
+static uint64_t g_lat_max[3] = {0};
+
+/* all keys pressed at t and released hold_ms later, returns when the press settles */
+static uint64_t wh_click(uint64_t t, uint32_t hold_ms)
+{
+    uint64_t settle = 0;
+
+    for (size_t k = 0; k < 3; k++) {
+        settle = MAX(settle, btn_sim_edge((key_id_e)k, t, true, WH_BOUNCE));
+        btn_sim_edge((key_id_e)k, t + SIM_MS(hold_ms), false, WH_BOUNCE);
+    }
+
+    return settle;
+}
+
+static void wh_idle_reads(void)
+{
+    uint64_t reads[3] = {0};
+    uint64_t want = 0;
+
+    for (size_t k = 0; k < 3; k++) {
+        reads[k] = btn_sim_stat_get()->reads[k];
+    }
+    btn_sim_run(btn_sim_now() + SIM_MS(WH_READ_MS));
+    for (size_t k = 0; k < 3; k++) {
+        reads[k] = btn_sim_stat_get()->reads[k] - reads[k];
+        want = WH_READ_MS / g_period_ms[k];
+        printf("key %zu every %u ms: %" PRIu64 " reads\n", k, g_period_ms[k], reads[k]);
+        if (reads[k] + 1 < want || reads[k] > want + 1) {
+            printf("FAIL key %zu: %" PRIu64 " reads, expected %" PRIu64 "\n", k, reads[k], want);
+            btn_sim_fail();
+        }
+    }
+}
+
+static void wh_scn_click(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(WH_IDLE_MS) + SIM_MS(phase);
+    uint64_t settle = wh_click(t, WH_LONGPRESS_MS + 300);
+    uint64_t prs = 0;
+    uint64_t lp = 0;
+
+    btn_sim_run(t + SIM_MS(WH_LONGPRESS_MS + 300 + WH_IDLE_MS) + SIM_MS(200));
+    for (size_t k = 0; k < 3; k++) {
+        btn_sim_expect("press", (key_id_e)k, BTN_EVT_PRESS, t, 1);
+        btn_sim_expect("long", (key_id_e)k, BTN_EVT_LONG, t, 1);
+        btn_sim_expect("release", (key_id_e)k, BTN_EVT_RELEASE, t, 1);
+
+        prs = btn_sim_find((uint32_t)k, BTN_EVT_PRESS, t);
+        lp = btn_sim_find((uint32_t)k, BTN_EVT_LONG, t);
+        g_lat_max[k] = MAX(g_lat_max[k], prs - t);
+        if (prs - t > settle - t + SIM_MS(2 * g_period_ms[k] + BTN_DEBOUNCE_MS)) {
+            printf("FAIL phase %u key %zu: press after %" PRIu64 " us\n", phase, k, prs - t);
+            btn_sim_fail();
+        }
+        // long press resolved to the period of the key, timestamp mode times it from the contact
+        if (lp - t < SIM_MS(WH_LONGPRESS_MS) ||
+            lp - prs > SIM_MS(WH_LONGPRESS_MS + g_period_ms[k])) {
+            printf("FAIL phase %u key %zu: long press %" PRIu64 " us after the press\n", phase, k, lp - prs);
+            btn_sim_fail();
+        }
+    }
+}
+
+static void wh_scn_double(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(WH_IDLE_MS) + SIM_MS(phase);
+
+    wh_click(t, 80);
+    wh_click(t + SIM_MS(200), 80);
+    btn_sim_run(t + SIM_MS(200 + 80 + WH_IDLE_MS) + SIM_MS(200));
+    btn_sim_expect("double", KEY_UP, BTN_EVT_DOUBLE, t, 1);
+    btn_sim_expect("double", KEY_OK, BTN_EVT_DOUBLE, t, 1);
+}
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = WH_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+    };
+
+    btn_sim_init(&cfg);
+    for (size_t k = 0; k < 3; k++) {
+        cfg.poll_ms = g_period_ms[k];
+        btn_sim_key_cfg((key_id_e)k, &cfg);
+    }
+
+    printf("poll %d ms, debounce %d ms, wheel %d slots, timestamp %d\n",
+           BTN_POLL_PERIOD_MS, BTN_DEBOUNCE_MS, BTN_WHEEL_SLOTS, BTN_TIMESTAMP_FUN_ENABLE);
+
+    wh_idle_reads();
+    for (uint32_t n = 0; n < WH_RUNS; n++) {
+        wh_scn_click(n * WH_PHASE_MS);
+        wh_scn_double(n * WH_PHASE_MS);
+    }
+    wh_idle_reads();
+
+    printf("press latency max: %" PRIu64 " / %" PRIu64 " / %" PRIu64 " us\n",
+           g_lat_max[0], g_lat_max[2], g_lat_max[1]);
+    if (g_lat_max[0] >= g_lat_max[2] || g_lat_max[2] >= g_lat_max[1]) {
+        printf("FAIL press latency not ordered by period\n");
+        btn_sim_fail();
+    }
+    return btn_sim_result();
+}
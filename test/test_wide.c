@@ -0,0 +1,148 @@
+/**
+ * @file    test_wide.c
+ * @brief   Keys and combos spread over several mask words.
+ *
+ * Keys 31, 32 and 65 sit on the last bit of word 0, the first of word 1
+ * and the second of word 2. Each must be visited from the active set or
+ * EXTI mask it sits in: clicks, a long press next to a double click on
+ * another word, and combos whose keys span the word boundaries. In EXTI
+ * mode the keys must also leave the EXTI mask again, so the timer stops
+ * once every word is idle.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "btn_sim.h"
+
+#define SIM_MS(ms)          ((uint64_t)(ms) * 1000U)
+#define WD_RUNS             (4)
+#define WD_BOUNCE           (4)
+#define WD_LONGPRESS_MS     (600)
+#define WD_IDLE_MS          (BTN_MULTI_GAP_MS + 100)
+
+#define WD_K31              ((key_id_e)31)
+#define WD_K32              ((key_id_e)32)
+#define WD_K65              ((key_id_e)65)
+
+#define WD_COMBO_ALL        ((key_combo_id_e)0)     /* 31 + 32 + 65 */
+#define WD_COMBO_PAIR       ((key_combo_id_e)1)     /* 31 + 32 */
+#define WD_COMBO_EDGE       ((key_combo_id_e)2)     /* 32 + 65 */
+
+static const key_id_e g_keys[] = {WD_K31, WD_K32, WD_K65};
+
+/* each key alone, one after another */
+static void wd_scn_click(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(WD_IDLE_MS) + SIM_MS(phase);
+
+    for (size_t k = 0; k < 3; k++) {
+        btn_sim_edge(g_keys[k], t + SIM_MS(k * 200), true, WD_BOUNCE);
+        btn_sim_edge(g_keys[k], t + SIM_MS(k * 200 + 80), false, WD_BOUNCE);
+    }
+    btn_sim_run(t + SIM_MS(400 + WD_IDLE_MS));
+
+    for (size_t k = 0; k < 3; k++) {
+        btn_sim_expect("click press", g_keys[k], BTN_EVT_PRESS, t, 1);
+        btn_sim_expect("click release", g_keys[k], BTN_EVT_RELEASE, t, 1);
+    }
+}
+
+/* key 65 held into its long press while key 31 double clicks */
+static void wd_scn_long_double(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(WD_IDLE_MS) + SIM_MS(phase);
+
+    btn_sim_edge(WD_K65, t, true, WD_BOUNCE);
+    btn_sim_edge(WD_K31, t + SIM_MS(300), true, WD_BOUNCE);
+    btn_sim_edge(WD_K31, t + SIM_MS(380), false, WD_BOUNCE);
+    btn_sim_edge(WD_K31, t + SIM_MS(480), true, WD_BOUNCE);
+    btn_sim_edge(WD_K31, t + SIM_MS(560), false, WD_BOUNCE);
+    btn_sim_edge(WD_K65, t + SIM_MS(WD_LONGPRESS_MS + 200), false, WD_BOUNCE);
+    btn_sim_run(t + SIM_MS(WD_LONGPRESS_MS + 200 + WD_IDLE_MS));
+
+    btn_sim_expect("long", WD_K65, BTN_EVT_LONG, t, 1);
+    btn_sim_expect("long release", WD_K65, BTN_EVT_RELEASE, t, 1);
+    btn_sim_expect("double", WD_K31, BTN_EVT_DOUBLE, t, 1);
+    btn_sim_expect("double quiet", WD_K32, BTN_EVT_PRESS, t, 0);
+}
+
+/* the three keys at once, then two of them, then the other two */
+static void wd_scn_combo(uint32_t phase)
+{
+    uint64_t t = btn_sim_now() + SIM_MS(WD_IDLE_MS) + SIM_MS(phase);
+
+    for (size_t k = 0; k < 3; k++) {
+        btn_sim_edge(g_keys[k], t, true, 0);
+        btn_sim_edge(g_keys[k], t + SIM_MS(150), false, 0);
+    }
+    btn_sim_run(t + SIM_MS(150 + WD_IDLE_MS));
+    btn_sim_expect("combo all", BTN_SIM_COMBO_ID(WD_COMBO_ALL), BTN_EVT_COMBO, t, 1);
+    btn_sim_expect("combo all pair", BTN_SIM_COMBO_ID(WD_COMBO_PAIR), BTN_EVT_COMBO, t, 0);
+    btn_sim_expect("combo all edge", BTN_SIM_COMBO_ID(WD_COMBO_EDGE), BTN_EVT_COMBO, t, 0);
+
+    t = btn_sim_now();
+    btn_sim_edge(WD_K31, t, true, 0);
+    btn_sim_edge(WD_K32, t + SIM_MS(BTN_COMBO_GAP_MS) / 2, true, 0);
+    btn_sim_edge(WD_K31, t + SIM_MS(200), false, 0);
+    btn_sim_edge(WD_K32, t + SIM_MS(200), false, 0);
+    btn_sim_run(t + SIM_MS(200 + WD_IDLE_MS));
+    btn_sim_expect("combo pair", BTN_SIM_COMBO_ID(WD_COMBO_PAIR), BTN_EVT_COMBO, t, 1);
+
+    t = btn_sim_now();
+    btn_sim_edge(WD_K65, t, true, 0);
+    btn_sim_edge(WD_K32, t + SIM_MS(BTN_COMBO_GAP_MS) / 2, true, 0);
+    btn_sim_edge(WD_K65, t + SIM_MS(200), false, 0);
+    btn_sim_edge(WD_K32, t + SIM_MS(200), false, 0);
+    btn_sim_run(t + SIM_MS(200 + WD_IDLE_MS));
+    btn_sim_expect("combo edge", BTN_SIM_COMBO_ID(WD_COMBO_EDGE), BTN_EVT_COMBO, t, 1);
+    btn_sim_expect("combo edge all", BTN_SIM_COMBO_ID(WD_COMBO_ALL), BTN_EVT_COMBO, t, 0);
+}
+
+#if BTN_EXTI_FUN_ENABLE
+/* no key of any word left awake once everything is idle */
+static void wd_scn_sleep(void)
+{
+    uint64_t polls = 0;
+
+    btn_sim_run(btn_sim_now() + SIM_MS(WD_IDLE_MS));
+    polls = btn_sim_stat_get()->polls;
+    btn_sim_run(btn_sim_now() + SIM_MS(2000));
+    if (btn_sim_stat_get()->polls != polls) {
+        printf("FAIL still polling: %" PRIu64 " polls while idle\n", btn_sim_stat_get()->polls - polls);
+        btn_sim_fail();
+    }
+}
+#endif
+
+int main(void)
+{
+    btn_cfg_t cfg = {
+        .longpress_ms = WD_LONGPRESS_MS,
+        .longpress_repeat_ms = 0,
+    };
+    btn_combo_cfg_t all = {{WD_K31, WD_K32, WD_K65}, BTN_TRIPLE_KEY_CNT, BTN_COMBO_SIMULTANEOUS};
+    btn_combo_cfg_t pair = {{WD_K31, WD_K32}, BTN_DOUBLE_KEY_CNT, BTN_COMBO_SIMULTANEOUS};
+    btn_combo_cfg_t edge = {{WD_K65, WD_K32}, BTN_DOUBLE_KEY_CNT, BTN_COMBO_SEQUENTIAL};
+
+    btn_sim_init(&cfg);
+    for (size_t k = 0; k < 3; k++) {
+        btn_sim_input_key(g_keys[k], &cfg);
+    }
+    btn_sim_register_combo(WD_COMBO_ALL, &all);
+    btn_sim_register_combo(WD_COMBO_PAIR, &pair);
+    btn_sim_register_combo(WD_COMBO_EDGE, &edge);
+
+    printf("%d keys in %d words, poll %d ms, exti %d\n",
+           BTN_NUM, (int)BTN_MASK_WORDS, BTN_POLL_PERIOD_MS, BTN_EXTI_FUN_ENABLE);
+
+    for (uint32_t n = 0; n < WD_RUNS; n++) {
+        wd_scn_click(n * 5);
+        wd_scn_long_double(n * 5);
+        wd_scn_combo(n * 5);
+#if BTN_EXTI_FUN_ENABLE
+        wd_scn_sleep();
+#endif
+    }
+
+    return btn_sim_result();
+}